@@ -0,0 +1,679 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-background.h"
+#include "lisasim-tdinoise.h"
+#include "lisasim-tdisignal.h"
+#include "lisasim-wave.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <math.h>
+
+// number of samples generated at once for all the pixel streams
+
+static const long backgroundblock = 64;
+
+// refresh interval (s) of the per-link projection tables
+
+static const double backgroundtableupdate = 60.0;
+
+
+// --- BackgroundSky ---
+
+BackgroundSky::BackgroundSky(int nl,int nm,double *weights,double dt,double pbt,long len,
+                             double density,double exponent,unsigned long seed)
+    : nlat(nl), nlon(nm), deltat(dt), prebuffer(pbt), length(len), current(-1) {
+
+    if(nlat < 1 || nlon < 1) {
+        std::cerr << "BackgroundSky::BackgroundSky(...): invalid pixelization "
+                  << nlat << "x" << nlon << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    pixels = nlat * nlon;
+
+    // same normalizations as PowerLawNoise
+
+    double nyquistf = 0.5 / deltat;
+    double normalize;
+
+    if (exponent == 0.00) {
+        filtertype = 0;
+        normalize = sqrt(density) * sqrt(nyquistf);
+    } else if (exponent == 2.00) {
+        filtertype = 2;
+        normalize = sqrt(density) * sqrt(nyquistf) / (2.00 * M_PI * deltat);
+    } else if (exponent == -2.00) {
+        filtertype = -2;
+        normalize = sqrt(density) * sqrt(nyquistf) * (2.00 * M_PI * deltat);
+    } else {
+        std::cerr << "BackgroundSky::BackgroundSky(...): undefined PowerLaw exponent "
+                  << exponent << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionUndefined e;
+        throw e;
+    }
+
+    // split the total PSD among the pixels according to the weights
+
+    double wsum = 0.0;
+
+    for(int pix=0;pix<pixels;pix++) {
+        double w = weights ? weights[pix] : 1.0;
+
+        if(w < 0.0) {
+            std::cerr << "BackgroundSky::BackgroundSky(...): negative weight " << w
+                      << " for pixel " << pix << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+
+        wsum += w;
+    }
+
+    amp = new double[2*pixels];
+    last = new double[2*pixels];
+
+    kx = new double[pixels]; ky = new double[pixels]; kz = new double[pixels];
+    ep = new double[6*pixels]; ec = new double[6*pixels];
+
+    for(int pix=0;pix<pixels;pix++) {
+        double w = weights ? weights[pix] : 1.0;
+
+        amp[2*pix] = amp[2*pix+1] = (wsum > 0.0) ? normalize * sqrt(w / wsum) : 0.0;
+
+        double b = pixelbeta(pix), l = pixellambda(pix);
+
+        // as in Wave::Wave; the polarization angle is immaterial for
+        // unpolarized backgrounds, so we take it to be zero
+
+        kx[pix] = -cos(l)*cos(b);
+        ky[pix] = -sin(l)*cos(b);
+        kz[pix] = -sin(b);
+
+        Tensor tp, tc;
+
+        Wave::putep(tp,b,l,0.0);
+        Wave::putec(tc,b,l,0.0);
+
+        double *p = &ep[6*pix], *c = &ec[6*pix];
+
+        p[0] = tp[0][0]; p[1] = tp[1][1]; p[2] = tp[2][2];
+        p[3] = 2.0*tp[0][1]; p[4] = 2.0*tp[0][2]; p[5] = 2.0*tp[1][2];
+
+        c[0] = tc[0][0]; c[1] = tc[1][1]; c[2] = tc[2][2];
+        c[3] = 2.0*tc[0][1]; c[4] = 2.0*tc[0][2]; c[5] = 2.0*tc[1][2];
+    }
+
+    data = new double[2*pixels*length];
+
+    whitenoise = new WhiteNoiseSource(1,seed);
+
+    reset(seed);
+}
+
+BackgroundSky::~BackgroundSky() {
+    delete whitenoise;
+
+    delete [] data;
+
+    delete [] ec; delete [] ep;
+    delete [] kz; delete [] ky; delete [] kx;
+
+    delete [] last;
+    delete [] amp;
+}
+
+void BackgroundSky::reset(unsigned long seed) {
+    if(current >= 0) whitenoise->reset(seed);
+
+    for(long i=0;i<2*pixels*length;i++) data[i] = 0.0;
+    for(int s=0;s<2*pixels;s++) last[s] = 0.0;
+
+    current = -1;
+}
+
+void BackgroundSky::writestate(FILE *file) {
+    whitenoise->writestate(file);
+
+    long size = 2*pixels*length;
+
+    statewrite(file,&size,sizeof(long));
+    statewrite(file,data,size*sizeof(double));
+    statewrite(file,last,2*pixels*sizeof(double));
+    statewrite(file,&current,sizeof(long));
+}
+
+void BackgroundSky::readstate(FILE *file) {
+    whitenoise->readstate(file);
+
+    statecheck(file,2*pixels*length,"BackgroundSky buffer size");
+    stateread(file,data,2*pixels*length*sizeof(double));
+    stateread(file,last,2*pixels*sizeof(double));
+    stateread(file,&current,sizeof(long));
+}
+
+double BackgroundSky::pixelbeta(int pix) {
+    if(pix < 0 || pix >= pixels) {
+        std::cerr << "BackgroundSky::pixelbeta(...): invalid pixel " << pix
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionOutOfBounds e;
+        throw e;
+    }
+
+    return asin(-1.0 + (2.0*(pix / nlon) + 1.0) / nlat);
+}
+
+double BackgroundSky::pixellambda(int pix) {
+    if(pix < 0 || pix >= pixels) {
+        std::cerr << "BackgroundSky::pixellambda(...): invalid pixel " << pix
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionOutOfBounds e;
+        throw e;
+    }
+
+    return 2.0 * M_PI * ((pix % nlon) + 0.5) / nlon;
+}
+
+// generate at least up to pos, a full block at a time; the filters are
+// applied to the scaled deviates (they are linear), with state in last[]
+
+void BackgroundSky::generate(long pos) {
+    long upto = current + backgroundblock > pos ? current + backgroundblock : pos;
+
+    for(long i=current+1;i<=upto;i++) {
+        long ind = i % length;
+
+        for(int s=0;s<2*pixels;s++) {
+            double w = amp[s] * whitenoise->getvalue(i);
+            double v;
+
+            switch(filtertype) {
+            case -2:
+                v = 0.9999 * last[s] + w;   // as IntFilter
+                last[s] = v;
+                break;
+            case 2:
+                v = w - last[s];            // as DiffFilter
+                last[s] = w;
+                break;
+            default:
+                v = w;
+                break;
+            }
+
+            data[s*length + ind] = v;
+        }
+    }
+
+    current = upto;
+}
+
+
+// --- BackgroundLinkSource ---
+
+BackgroundLinkSource::BackgroundLinkSource(long len,double dt,double pbt,BackgroundSky *s,LISA *l,int lk,int sendterm)
+    : BufferedSignalSource(len), sky(s), lisa(l), link(lk), deltat(dt), prebuffer(pbt), tabletime(0.0) {
+
+    craft = sendterm ? getSend(link) : getRecv(link);
+
+    gp = new double[sky->pixels];
+    gc = new double[sky->pixels];
+
+    settable(-prebuffer);
+}
+
+BackgroundLinkSource::~BackgroundLinkSource() {
+    delete [] gc;
+    delete [] gp;
+}
+
+void BackgroundLinkSource::reset(unsigned long seed) {
+    settable(-prebuffer);
+
+    BufferedSignalSource::reset(seed);
+}
+
+// the projection tables are recomputed from the time they were made at
+
+void BackgroundLinkSource::writestate(FILE *file) {
+    BufferedSignalSource::writestate(file);
+
+    statewrite(file,&tabletime,sizeof(double));
+}
+
+void BackgroundLinkSource::readstate(FILE *file) {
+    BufferedSignalSource::readstate(file);
+
+    double t;
+    stateread(file,&t,sizeof(double));
+
+    settable(t);
+}
+
+void BackgroundLinkSource::settable(double t) {
+    Vector n;
+    lisa->putn(n,link,t);
+
+    double nn[6] = {n[0]*n[0], n[1]*n[1], n[2]*n[2], n[0]*n[1], n[0]*n[2], n[1]*n[2]};
+
+    for(int pix=0;pix<sky->pixels;pix++) {
+        double *p = &sky->ep[6*pix], *c = &sky->ec[6*pix];
+
+        double denom = 1.0 - (n[0]*sky->kx[pix] + n[1]*sky->ky[pix] + n[2]*sky->kz[pix]);
+
+        // as in TDIsignal, skip the (measure-zero) direction along the link
+
+        if(denom > 1.0e-12) {
+            gp[pix] = 0.5 * (p[0]*nn[0] + p[1]*nn[1] + p[2]*nn[2] + p[3]*nn[3] + p[4]*nn[4] + p[5]*nn[5]) / denom;
+            gc[pix] = 0.5 * (c[0]*nn[0] + c[1]*nn[1] + c[2]*nn[2] + c[3]*nn[3] + c[4]*nn[4] + c[5]*nn[5]) / denom;
+        } else {
+            gp[pix] = 0.0;
+            gc[pix] = 0.0;
+        }
+    }
+
+    tabletime = t;
+}
+
+double BackgroundLinkSource::getvalue(long pos) {
+    double t = pos*deltat - prebuffer;
+
+    if(fabs(t - tabletime) > backgroundtableupdate) settable(t);
+
+    Vector p;
+    lisa->putp(p,craft,t);
+
+    double acc = 0.0;
+
+    for(int pix=0;pix<sky->pixels;pix++) {
+        double hp, hc;
+
+        sky->getpixel(pix,t - (p[0]*sky->kx[pix] + p[1]*sky->ky[pix] + p[2]*sky->kz[pix]),hp,hc);
+
+        acc += gp[pix] * hp + gc[pix] * hc;
+    }
+
+    return acc;
+}
+
+
+// --- TDIbackground ---
+
+TDIbackground::TDIbackground(LISA *mylisa,int nlat,int nlon,double deltat,double density,double exponent,int interplen,unsigned long seed)
+    : lisa(mylisa), phlisa(mylisa->physlisa()) {
+
+    initialize(nlat,nlon,0,deltat,density,exponent,interplen,seed);
+}
+
+TDIbackground::TDIbackground(LISA *mylisa,int nlat,int nlon,double *weights,long wlength,double deltat,double density,double exponent,int interplen,unsigned long seed)
+    : lisa(mylisa), phlisa(mylisa->physlisa()) {
+
+    if(wlength != nlat * nlon) {
+        std::cerr << "TDIbackground::TDIbackground(...): need " << nlat * nlon
+                  << " pixel weights, got " << wlength << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    initialize(nlat,nlon,weights,deltat,density,exponent,interplen,seed);
+}
+
+void TDIbackground::initialize(int nlat,int nlon,double *weights,double deltat,double density,double exponent,int interplen,unsigned long seed) {
+    try {
+        interp = getInterpolator(interplen);
+    } catch (ExceptionUndefined &e) {
+        std::cerr << "TDIbackground::TDIbackground(...): undefined interpolator length "
+                  << interplen << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        throw e;
+    }
+
+    // the link streams need octuple retardations (as stdproofnoise), plus
+    // the interpolation window; the pixel streams need in addition the
+    // light travel time across the SSB-centered positions of the spacecraft
+
+    double window = (interplen > 0 ? interplen : 1) + 2.0;
+
+    double pbtlink = 8.0 * lighttime(phlisa) + window * deltat;
+
+    double radius = 0.0;
+
+    for(int craft=1;craft<4;craft++) {
+        Vector p;
+        phlisa->putp(p,craft,0.0);
+
+        double r = sqrt(p.dotproduct());
+        if(r > radius) radius = r;
+    }
+
+    radius = 1.01 * radius + 2.0 * deltat;
+
+    long linklength = long(pbtlink/deltat + 32);
+    long skylength = long((pbtlink + 2.0*radius)/deltat) + 2*backgroundblock + 32;
+
+    sky = new BackgroundSky(nlat,nlon,weights,deltat,pbtlink + radius,skylength,density,exponent,seed);
+
+    for(int term=0;term<2;term++) {
+        sources[term][0] = 0;
+        linksignals[term][0] = 0;
+
+        for(int ind=1;ind<7;ind++) {
+            int link = (ind < 4) ? ind : 3 - ind;
+
+            sources[term][ind] = new BackgroundLinkSource(linklength,deltat,pbtlink,sky,phlisa,link,term);
+            linksignals[term][ind] = new InterpolatedSignal(sources[term][ind],interp,deltat,pbtlink);
+        }
+    }
+}
+
+TDIbackground::~TDIbackground() {
+    for(int term=0;term<2;term++) {
+        for(int ind=1;ind<7;ind++) {
+            delete linksignals[term][ind];
+            delete sources[term][ind];
+        }
+    }
+
+    delete sky;
+    delete interp;
+}
+
+void TDIbackground::reset(unsigned long seed) {
+    lisa->reset();
+    if(phlisa != lisa) phlisa->reset();
+
+    sky->reset(seed);
+
+    for(int term=0;term<2;term++)
+        for(int ind=1;ind<7;ind++)
+            sources[term][ind]->reset();
+}
+
+void TDIbackground::writestate(FILE *file) {
+    sky->writestate(file);
+
+    for(int term=0;term<2;term++)
+        for(int ind=1;ind<7;ind++)
+            sources[term][ind]->writestate(file);
+}
+
+void TDIbackground::readstate(FILE *file) {
+    sky->readstate(file);
+
+    for(int term=0;term<2;term++)
+        for(int ind=1;ind<7;ind++)
+            sources[term][ind]->readstate(file);
+}
+
+// same retardation and link conventions as TDIsignal::y
+
+double TDIbackground::y(int send, int slink, int recv, const DelayChain &ret, double t) {
+    lisa->newretardtime(t);
+    lisa->retard(ret);
+
+    double retardedtime = lisa->retardedtime();
+
+    int link = abs(slink);
+
+    if( (link == 3 && recv == 2) || (link == 1 && recv == 3) || (link == 2 && recv == 1) )
+	link = -link;
+
+    lisa->retard(phlisa,link);
+    double retardsignal = lisa->retardedtime();
+
+    int ind = (link > 0) ? link : 3 - link;
+
+    return linksignals[1][ind]->value(retardsignal) - linksignals[0][ind]->value(retardedtime);
+}
+
+
+// --- GalacticConfusion ---
+
+GalacticConfusion::GalacticConfusion(LISA *lisa,char *observablenames,double *psdarray,long psdlength,double *sky,long skylength,
+                                     double st,double it,double per,long nn,double fref,long blocklength,unsigned long seed)
+    : BlockColoredNoise(blocklength), stime(st), inittime(it), period(per), nodes(nn) {
+
+    const TDIcombination *combs[64];
+
+    observables = parsetdicombinations(observablenames,combs,64);
+
+    if(observables <= 0 || psdlength % 2 != 0 || psdlength < 4 || skylength % 3 != 0 || skylength < 3 ||
+       nodes < 2 || !(period > 0.0) || !(stime > 0.0) || blocklength < 16 || (blocklength & (blocklength - 1)) != 0) {
+        std::cerr << "GalacticConfusion::GalacticConfusion(...): need known observables ('" << observablenames
+                  << "'), a two-column PSD array, a three-column sky array, at least two nodes, positive period"
+                  << " and stime, and a blocklength that is a power of two (at least 16)"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    const int n = observables;
+
+    psdrows = psdlength / 2;
+    psdf = new double[psdrows];
+    psds = new double[psdrows];
+
+    for(long i=0;i<psdrows;i++) {
+        psdf[i] = psdarray[2*i];
+        psds[i] = psdarray[2*i+1];
+    }
+
+    modulation = new double[n*n*nodes];
+    factor = new double[n*n*nodes];
+
+    for(long i=0;i<n*n*nodes;i++) modulation[i] = factor[i] = 0.0;
+
+    // complex responses to the heterodyne waves from each source
+    // position, tabulated over one period
+
+    long sources = skylength / 3;
+
+    double *z = new double[2*2*n];
+
+    for(long s=0;s<sources;s++) {
+        double beta = sky[3*s], lambda = sky[3*s+1], weight = sky[3*s+2];
+
+        if(weight == 0.0) continue;
+
+        HeterodyneWave *waves[4];
+        TDIsignal *signals[4];
+
+        for(int w=0;w<4;w++) {
+            waves[w] = new HeterodyneWave(fref,w/2,w%2,beta,lambda);
+            signals[w] = new TDIsignal(lisa,waves[w]);
+        }
+
+        for(long k=0;k<nodes;k++) {
+            double t = inittime + k * period / nodes;
+            double *g = &modulation[n*n*k];
+
+            for(int pol=0;pol<2;pol++)
+                for(int j=0;j<n;j++) {
+                    z[2*(pol*n + j)]     = evaltdicombination(signals[2*pol],combs[j],t);
+                    z[2*(pol*n + j) + 1] = evaltdicombination(signals[2*pol + 1],combs[j],t);
+                }
+
+            for(int pol=0;pol<2;pol++)
+                for(int j=0;j<n;j++)
+                    for(int l=0;l<n;l++)
+                        g[j*n + l] += 0.5 * weight * (z[2*(pol*n + j)] * z[2*(pol*n + l)] +
+                                                      z[2*(pol*n + j) + 1] * z[2*(pol*n + l) + 1]);
+        }
+
+        for(int w=0;w<4;w++) {
+            delete signals[w];
+            delete waves[w];
+        }
+    }
+
+    delete [] z;
+
+    double trace = 0.0;
+
+    for(long k=0;k<nodes;k++)
+        for(int j=0;j<n;j++) trace += modulation[n*n*k + j*n + j];
+
+    if(!(trace > 0.0)) {
+        std::cerr << "GalacticConfusion::GalacticConfusion(...): the sources give no response"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete [] factor; delete [] modulation;
+        delete [] psds; delete [] psdf;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    for(long i=0;i<n*n*nodes;i++) modulation[i] *= n * nodes / trace;
+
+    // Cholesky factors G = L L^T; directions of (numerically) zero
+    // modulation (e.g., Tm, in the long-wavelength limit) get zero columns
+
+    for(long k=0;k<nodes;k++) {
+        double *g = &modulation[n*n*k], *l = &factor[n*n*k];
+
+        for(int j=0;j<n;j++) {
+            double d = g[j*n + j];
+            for(int m=0;m<j;m++) d -= l[j*n + m] * l[j*n + m];
+
+            if(!(d > 1.0e-12 * g[j*n + j])) continue;
+
+            l[j*n + j] = sqrt(d);
+
+            for(int i=j+1;i<n;i++) {
+                double acc = g[i*n + j];
+                for(int m=0;m<j;m++) acc -= l[i*n + m] * l[j*n + m];
+
+                l[i*n + j] = acc / l[j*n + j];
+            }
+        }
+    }
+
+    // a one-sided PSD S gives E|z_k|^2 = S df / 2, so S df / 4 for the
+    // real and imaginary parts
+
+    const long N = 2*half;
+    const double df = 1.0 / (N * stime);
+
+    amplitude = new double[half + 1];
+    for(long k=0;k<=half;k++)
+        amplitude[k] = (k == 0 || k == half) ? 0.0 : sqrt(0.25 * psd(k * df) * df);
+
+    allocateblocks();
+
+    deviates = new WhiteNoiseSource(1024,seed);
+
+    start();
+}
+
+GalacticConfusion::~GalacticConfusion() {
+    release();
+}
+
+void GalacticConfusion::release() {
+    delete deviates;
+
+    delete [] amplitude;
+
+    delete [] factor;
+    delete [] modulation;
+
+    delete [] psds;
+    delete [] psdf;
+}
+
+double GalacticConfusion::psd(double f) {
+    if(f < psdf[0] || f > psdf[psdrows-1]) return 0.0;
+
+    long lo = 0, hi = psdrows - 1;
+
+    while(hi - lo > 1) {
+        long mid = (lo + hi) / 2;
+
+        if(psdf[mid] <= f) lo = mid; else hi = mid;
+    }
+
+    if(psdf[hi] == psdf[lo]) return psds[lo];
+
+    return psds[lo] + (f - psdf[lo]) * (psds[hi] - psds[lo]) / (psdf[hi] - psdf[lo]);
+}
+
+// unmodulated streams with PSD S, one per observable
+
+void GalacticConfusion::color() {
+    const long N = 2*half;
+
+    for(int j=0;j<observables;j++) {
+        double *z = &work[j*2*N];
+
+        for(long k=1;k<half;k++) {
+            z[2*k]     = amplitude[k] * (*deviates)[deviate++];
+            z[2*k + 1] = amplitude[k] * (*deviates)[deviate++];
+        }
+    }
+}
+
+void GalacticConfusion::start() {
+    deviate = 0;
+    sample = 0;
+
+    startblocks();
+}
+
+void GalacticConfusion::reset(unsigned long seed) {
+    deviates->reset(seed);
+
+    start();
+}
+
+void GalacticConfusion::getmodulation(double *buffer,long length,double t) {
+    checkvalues("GalacticConfusion::getmodulation",length,observables*observables);
+
+    double x = (t - inittime) / period * nodes;
+    double k0 = floor(x);
+
+    long i0 = long(k0) % nodes; if(i0 < 0) i0 += nodes;
+    long i1 = (i0 + 1) % nodes;
+
+    for(int i=0;i<observables*observables;i++)
+        buffer[i] = (1.0 - (x - k0)) * modulation[observables*observables*i0 + i] + (x - k0) * modulation[observables*observables*i1 + i];
+}
+
+void GalacticConfusion::getobs(double *buffer,long length,long samples) {
+    checkvalues("GalacticConfusion::getobs",length,samples,observables);
+
+    const int n = observables;
+
+    for(long i=0;i<samples;i++,sample++) {
+        // modulation factor at this time, interpolated between nodes
+
+        double x = (sample * stime) / period * nodes;
+        double k0 = floor(x), frac = x - k0;
+
+        long i0 = long(k0) % nodes, i1 = (i0 + 1) % nodes;
+
+        const double *l0 = &factor[n*n*i0], *l1 = &factor[n*n*i1];
+        const double *u = nextrow();
+
+        for(int j=0;j<n;j++) {
+            double acc = 0.0;
+
+            for(int m=0;m<=j;m++)
+                acc += ((1.0 - frac) * l0[j*n + m] + frac * l1[j*n + m]) * u[m];
+
+            buffer[i*n + j] = acc;
+        }
+    }
+}
@@ -0,0 +1,227 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_BACKGROUND_H_
+#define _LISASIM_BACKGROUND_H_
+
+#include "lisasim-tdi.h"
+#include "lisasim-lisa.h"
+#include "lisasim-signal.h"
+#include "lisasim-delay.h"
+
+/** Pixelized sky for stochastic backgrounds. The sky is divided in
+    nlat bands of equal width in sin(beta), each with nlon pixels of
+    equal width in lambda, so that all pixels subtend the same solid
+    angle. The hp and hc streams of all pixels are generated together,
+    in blocks of samples, from a single pseudorandom generator; they
+    have one-sided PSD density*(f/Hz)^exponent (summed over the sky)
+    with exponent = 0, 2, -2 as for PowerLawNoise, distributed among
+    the pixels in proportion to the weights. The streams are stored
+    pixel-major in a ring buffer, so that interpolating a pixel at two
+    nearby times touches contiguous memory. */
+
+class BackgroundSky {
+ private:
+    int nlat, nlon;
+
+    double deltat, prebuffer;
+
+    // ring buffer of 2*pixels streams (hp, hc for each pixel)
+
+    double *data;
+    long length, current;
+
+    WhiteNoiseSource *whitenoise;
+
+    int filtertype;
+    double *amp, *last;
+
+    void generate(long pos);
+
+ public:
+    int pixels;
+
+    /// Tables of propagation vectors and of the ep and ec tensors (xx,yy,zz,2xy,2xz,2yz).
+    double *kx, *ky, *kz;
+    double *ep, *ec;
+
+    BackgroundSky(int nlat,int nlon,double *weights,double deltat,double prebuffer,long length,
+                  double density,double exponent,unsigned long seed = 0);
+    ~BackgroundSky();
+
+    void reset(unsigned long seed = 0);
+
+    void writestate(FILE *file);
+    void readstate(FILE *file);
+
+    double pixelbeta(int pix);
+    double pixellambda(int pix);
+
+    /// Linearly interpolated hp and hc of pixel pix at time t.
+    inline void getpixel(int pix,double t,double &hp,double &hc);
+};
+
+inline void BackgroundSky::getpixel(int pix,double t,double &hp,double &hc) {
+    double ireal = (t + prebuffer) / deltat;
+    long pos = long(floor(ireal));
+    double frac = ireal - pos;
+
+    if(pos + 1 > current) {
+        generate(pos + 1);
+    } else if(pos <= current - length) {
+        std::cerr << "BackgroundSky::getpixel(...): stale sample access at time "
+                  << t << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionOutOfBounds e;
+        throw e;
+    }
+
+    long i0 = pos % length, i1 = (pos + 1) % length;
+
+    double *dp = data + (2*pix) * length;
+    double *dc = dp + length;
+
+    hp = dp[i0] + frac * (dp[i1] - dp[i0]);
+    hc = dc[i0] + frac * (dc[i1] - dc[i0]);
+}
+
+
+/** Summed response of all the pixels of a BackgroundSky on one link,
+    for the receiving (sendterm = 0) or emitting (sendterm = 1)
+    spacecraft, evaluated on a regular time grid. The per-pixel
+    projection factors 0.5 n.e.n / (1 - n.k) are tabulated and
+    refreshed only every few tens of seconds, since the link
+    directions change slowly. */
+
+class BackgroundLinkSource : public BufferedSignalSource {
+ private:
+    BackgroundSky *sky;
+    LISA *lisa;
+
+    int link, craft;
+
+    double deltat, prebuffer;
+
+    double *gp, *gc;
+    double tabletime;
+
+    void settable(double t);
+
+ public:
+    BackgroundLinkSource(long len,double dt,double pbt,BackgroundSky *s,LISA *l,int link,int sendterm);
+    ~BackgroundLinkSource();
+
+    double getvalue(long pos);
+
+    void reset(unsigned long seed = 0);
+
+    void writestate(FILE *file);
+    void readstate(FILE *file);
+};
+
+
+/** TDI response to a pixelized stochastic background; y(...) follows
+    the same conventions as TDIsignal, but the sums over the sky are
+    read from twelve cached link streams, so every TDI observable
+    reuses them. The background is defined for t >= 0. */
+
+class TDIbackground : public TDI {
+ private:
+    LISA *lisa, *phlisa;
+
+    BackgroundSky *sky;
+
+    // use {1,2,3,-1,-2,-3} = {1,2,3,4,5,6} indexing for links;
+    // [0] is the receiving term, [1] the emitting term
+
+    BackgroundLinkSource *sources[2][7];
+    InterpolatedSignal *linksignals[2][7];
+
+    Interpolator *interp;
+
+    void initialize(int nlat,int nlon,double *weights,double deltat,double density,double exponent,int interplen,unsigned long seed);
+
+ public:
+    TDIbackground(LISA *mylisa,int nlat,int nlon,double deltat,double density,double exponent,int interplen = 4,unsigned long seed = 0);
+    TDIbackground(LISA *mylisa,int nlat,int nlon,double *weights,long wlength,double deltat,double density,double exponent,int interplen = 4,unsigned long seed = 0);
+    ~TDIbackground();
+
+    void reset(unsigned long seed = 0);
+
+    void writestate(FILE *file);
+    void readstate(FILE *file);
+
+    int getpixels() { return sky->pixels; };
+
+    double pixelbeta(int pix) { return sky->pixelbeta(pix); };
+    double pixellambda(int pix) { return sky->pixellambda(pix); };
+
+    using TDI::y;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
+};
+
+
+/** Cyclostationary galactic confusion noise, synthesized in blocks as
+    colored noise with an annual modulation, rather than summing the
+    responses of the binaries. In the long-wavelength limit, the CSD
+    of the observables (any of findtdicombination) factors as S(f)
+    G(t): S is the confusion spectrum, given as rows (f, S(f)) and
+    interpolated linearly (zero outside), and G(t) is the modulation
+    matrix of the observables, from the geometry of lisa and the sky
+    distribution of the sources, given as rows (beta, lambda, weight).
+    G is the weighted sum, over the sources and the two polarizations
+    (which averages over psi), of the products of the complex TDI
+    responses to a wave of frequency fref, tabulated at nodes times
+    over one period (a year, for periodic orbits) and normalized so
+    that the mean of its trace is the number of observables (so S is
+    the orbit-averaged PSD, for symmetric observables such as Xm, Ym,
+    Zm). Independent streams with PSD S are colored as in
+    SpectralTDInoise (by BlockColoredNoise, in blocks of blocklength
+    samples, overlapped by half with sine windows), and mixed by the
+    Cholesky factor of G, interpolated linearly between nodes. */
+
+class GalacticConfusion : public BlockColoredNoise {
+ private:
+    double stime, inittime, period;
+
+    double *psdf, *psds;
+    long psdrows;
+
+    // Cholesky factors of G at the nodes (observables x observables, real)
+
+    long nodes;
+    double *modulation, *factor;
+
+    WhiteNoiseSource *deviates;
+    long deviate;
+
+    double *amplitude;
+    long sample;
+
+    double psd(double f);
+    void color();
+    void start();
+
+    void release();
+
+ public:
+    GalacticConfusion(LISA *lisa,char *observables,double *psd,long psdlength,double *sky,long skylength,double stime,
+                      double inittime = 0.0,double period = 31536000.0,long nodes = 64,double fref = 1.0e-3,
+                      long blocklength = 65536,unsigned long seed = 0);
+    ~GalacticConfusion();
+
+    /// Fill buffer (observables x observables) with the modulation matrix G at time t.
+    void getmodulation(double *buffer,long length,double t);
+
+    /// Fill buffer with the next samples rows of observables.
+    void getobs(double *buffer,long length,long samples);
+
+    /// Restart the stream at inittime, with a new seed (0 for the global seed).
+    void reset(unsigned long seed = 0);
+};
+
+#endif /* _LISASIM_BACKGROUND_H_ */
@@ -0,0 +1,109 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-delay.h"
+#include "lisasim-lisa.h"
+
+#include <iostream>
+
+DelayChain::DelayChain(int ret1,int ret2,int ret3,int ret4,int ret5,int ret6,int ret7,int ret8)
+    : arms(local), length(0), capacity(delaychainlocal) {
+    append(ret1); append(ret2); append(ret3); append(ret4);
+    append(ret5); append(ret6); append(ret7); append(ret8);
+}
+
+DelayChain::DelayChain(int *intarray,int intnum)
+    : arms(local), length(0), capacity(delaychainlocal) {
+    for(int i=0;i<intnum;i++)
+        append(intarray[i]);
+}
+
+DelayChain::DelayChain(const DelayChain &chain)
+    : arms(local), length(0), capacity(delaychainlocal) {
+    *this = chain;
+}
+
+DelayChain &DelayChain::operator=(const DelayChain &chain) {
+    if(this == &chain) return *this;
+
+    while(capacity < chain.length) grow();
+
+    for(int i=0;i<chain.length;i++)
+        arms[i] = chain.arms[i];
+
+    length = chain.length;
+
+    return *this;
+}
+
+void DelayChain::grow() {
+    signed char *newarms = new signed char[2*capacity];
+
+    for(int i=0;i<length;i++)
+        newarms[i] = arms[i];
+
+    if(arms != local) delete [] arms;
+
+    arms = newarms;
+    capacity *= 2;
+}
+
+DelayChain &DelayChain::append(int arm) {
+    if(arm == 0) return *this;
+
+    assertArm(arm);
+
+    if(length == capacity) grow();
+
+    arms[length++] = arm;
+
+    return *this;
+}
+
+DelayChain &DelayChain::prepend(int arm) {
+    if(arm == 0) return *this;
+
+    assertArm(arm);
+
+    if(length == capacity) grow();
+
+    for(int i=length;i>0;i--)
+        arms[i] = arms[i-1];
+
+    arms[0] = arm;
+    length++;
+
+    return *this;
+}
+
+// hash in the order of application (last arm first)
+
+unsigned long long DelayChain::hash() const {
+    unsigned long long key = delaykeyinit;
+
+    for(int i=length-1;i>=0;i--)
+        key = delaykey(key,arms[i]);
+
+    return key;
+}
+
+bool DelayChain::operator==(const DelayChain &chain) const {
+    if(length != chain.length) return false;
+
+    for(int i=0;i<length;i++)
+        if(arms[i] != chain.arms[i]) return false;
+
+    return true;
+}
+
+std::ostream &operator<<(std::ostream &out,const DelayChain &chain) {
+    out << "[";
+
+    for(int i=0;i<chain.size();i++)
+        out << (i ? "," : "") << chain[i];
+
+    return out << "]";
+}
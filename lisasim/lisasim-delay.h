@@ -0,0 +1,82 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_DELAY_H_
+#define _LISASIM_DELAY_H_
+
+#include "lisasim-except.h"
+
+#include <iostream>
+
+/** Rolling key for retardation chains. Each retarding arm
+    (1,2,3,-1,-2,-3) is coded as a 3-bit value, as in the old
+    CacheLISA key, and folded into a 64-bit FNV-1a hash in the order
+    in which the retardations are applied. CacheLISA uses the same
+    function to key its cache, so a DelayChain and a sequence of
+    retard(int) calls hash identically. */
+
+const unsigned long long delaykeyinit = 14695981039346656037ULL;
+
+inline unsigned long long delaykey(unsigned long long key,int arm) {
+    return (key ^ (unsigned long long)(arm > 0 ? arm : (4 - arm))) * 1099511628211ULL;
+}
+
+/// Number of arms stored without heap allocation.
+
+const int delaychainlocal = 16;
+
+/** Arbitrary-length chain of retardations, D_{ret1} D_{ret2} ... D_{retn},
+    as used by TDI::y and TDI::z. As in the fixed-argument versions, the
+    last arm is applied first. Zero arms are dropped on construction, so
+    padded argument lists cost nothing; chains of up to delaychainlocal
+    arms are stored inline. */
+
+class DelayChain {
+ private:
+    signed char local[delaychainlocal];
+    signed char *arms;
+
+    int length, capacity;
+
+    void grow();
+
+ public:
+    DelayChain() : arms(local), length(0), capacity(delaychainlocal) {};
+
+    /// Build from the legacy fixed-length argument lists (zeros are skipped).
+    DelayChain(int ret1,int ret2 = 0,int ret3 = 0,int ret4 = 0,
+               int ret5 = 0,int ret6 = 0,int ret7 = 0,int ret8 = 0);
+
+    /// Build from an array of arms, in the order ret1...retn.
+    DelayChain(int *intarray,int intnum);
+
+    DelayChain(const DelayChain &chain);
+    DelayChain &operator=(const DelayChain &chain);
+
+    ~DelayChain() {
+        if(arms != local) delete [] arms;
+    };
+
+    /// Add a retardation to the right of the chain (i.e., applied before all others).
+    DelayChain &append(int arm);
+
+    /// Add a retardation to the left of the chain (i.e., applied after all others).
+    DelayChain &prepend(int arm);
+
+    int size() const { return length; };
+
+    int operator[](int i) const { return arms[i]; };
+
+    /// Hash of the chain, consistent with CacheLISA keys.
+    unsigned long long hash() const;
+
+    bool operator==(const DelayChain &chain) const;
+    bool operator!=(const DelayChain &chain) const { return !(*this == chain); };
+};
+
+std::ostream &operator<<(std::ostream &out,const DelayChain &chain);
+
+#endif /* _LISASIM_DELAY_H_ */
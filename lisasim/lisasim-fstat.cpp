@@ -0,0 +1,628 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-fstat.h"
+#include "lisasim-tdisignal.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+
+static int fstatcompare(const void *a,const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
+
+
+// --- FStatistic ---
+
+FStatistic::FStatistic(LISA *mylisa,double *d,long length,char *observables,double dt,double t0,double bw)
+    : lisa(mylisa), deltat(dt), inittime(t0), bandwidth(bw) {
+
+    parseobservables(observables);
+
+    if(length % channels != 0 || dt <= 0.0 || bw <= 0.0 || bw >= 0.25/dt) {
+        std::cerr << "FStatistic::FStatistic(...): data length " << length << " is not a multiple of "
+                  << channels << " channels, or invalid deltat " << dt << " or bandwidth " << bw
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    samples = length / channels;
+
+    // decimate to (at least) eight samples per bandwidth, so the
+    // triangular window (response sinc^2) is nearly flat across the band
+
+    decimate = long(floor(1.0 / (8.0 * bandwidth * deltat)));
+    if(decimate < 1) decimate = 1;
+
+    ddeltat = decimate * deltat;
+
+    // decimated samples are centered at indices decimate, 2*decimate, ...
+    // so that their windows lie entirely within the data
+
+    dsamples = (samples - decimate) / decimate;
+
+    if(dsamples < 8) {
+        std::cerr << "FStatistic::FStatistic(...): " << samples << " samples are too few for bandwidth "
+                  << bandwidth << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    // zero-pad by (at least) two, for half-bin frequency resolution
+
+    fftlength = 1;
+    while(fftlength < 2*dsamples) fftlength <<= 1;
+
+    df = 1.0 / (fftlength * ddeltat);
+
+    bandbins = long(floor(bandwidth / df));
+
+    data = new double[length];
+    for(long i=0;i<length;i++) data[i] = d[i];
+
+    newband(own,lisa);
+}
+
+FStatistic::~FStatistic() {
+    deleteband(own);
+
+    delete [] data;
+}
+
+void FStatistic::newband(FStatBand &fb,LISA *l) {
+    fb.lisa = l;
+
+    fb.band = -1;
+    fb.f0 = 0.0;
+
+    fb.het = new double[2 * channels * dsamples];
+    fb.noise = new double[channels];
+
+    fb.env = new double[2 * 2 * channels * dsamples];
+    fb.work = new double[2 * 2 * channels * fftlength];
+}
+
+void FStatistic::deleteband(FStatBand &fb) {
+    delete [] fb.work;
+    delete [] fb.env;
+
+    delete [] fb.noise;
+    delete [] fb.het;
+}
+
+// parse a comma-separated list of channel names (see findtdicombination)
+
+void FStatistic::parseobservables(char *observables) {
+    char *buffer = new char[strlen(observables) + 1];
+    strcpy(buffer,observables);
+
+    channels = 0;
+    bases = 0;
+
+    for(char *tok = strtok(buffer,", ");tok;tok = strtok(0,", ")) {
+        const TDIcombination *ob = findtdicombination(tok);
+
+        if(!ob || channels == fstatchannels) {
+            std::cerr << "FStatistic::FStatistic(...): unknown observable or too many channels at '" << tok
+                      << "' [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            delete [] buffer;
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+
+        for(int b=0;b<fstatchannels;b++) coeff[channels][b] = 0.0;
+
+        for(int i=0;i<3 && ob->obs[i];i++) {
+            int b = 0;
+            while(b < bases && base[b] != ob->obs[i]) b++;
+
+            if(b == bases) {
+                if(bases == fstatchannels) {
+                    std::cerr << "FStatistic::FStatistic(...): too many distinct TDI observables"
+                              << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+                    delete [] buffer;
+
+                    ExceptionWrongArguments e;
+                    throw e;
+                }
+
+                base[bases++] = ob->obs[i];
+            }
+
+            coeff[channels][b] += ob->coeff[i];
+        }
+
+        channels++;
+    }
+
+    delete [] buffer;
+
+    if(channels == 0) {
+        std::cerr << "FStatistic::FStatistic(...): no observables given"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+}
+
+long FStatistic::getbin(double f) {
+    return long(ceil(f / df - 1.0e-9));
+}
+
+// heterodyne all channels to the center of band newband, and estimate
+// their noise PSD from the median of the in-band periodogram
+
+void FStatistic::heterodyne(FStatBand &fb,long newband) {
+    if(newband == fb.band) return;
+
+    fb.band = newband;
+    fb.f0 = (fb.band * bandbins + bandbins/2) * df;
+
+    double *het = fb.het, *noise = fb.noise, *work = fb.work;
+
+    for(long i=0;i<2*channels*dsamples;i++) het[i] = 0.0;
+
+    // each sample contributes to the two triangular windows that straddle it
+
+    const double w0 = 2.0 * M_PI * fb.f0;
+    const double norm = 1.0 / (double(decimate) * decimate);
+
+    long last = (dsamples + 1) * decimate;
+
+    for(long j=1;j<last;j++) {
+        double ph = w0 * (inittime + j * deltat);
+        double cr = cos(ph), ci = -sin(ph);
+
+        long m = j / decimate, r = j - m * decimate;
+
+        double wl = (decimate - r) * norm, wr = r * norm;
+
+        for(int c=0;c<channels;c++) {
+            double dr = data[j*channels + c] * cr, di = data[j*channels + c] * ci;
+
+            if(m >= 1 && m <= dsamples) {
+                double *h = &het[2*(c*dsamples + m - 1)];
+                h[0] += wl * dr; h[1] += wl * di;
+            }
+
+            if(r > 0 && m + 1 <= dsamples) {
+                double *h = &het[2*(c*dsamples + m)];
+                h[0] += wr * dr; h[1] += wr * di;
+            }
+        }
+    }
+
+    // median of an exponential variable is ln 2 times its mean
+
+    double *power = new double[bandbins];
+
+    for(int c=0;c<channels;c++) {
+        for(long i=0;i<2*fftlength;i++) work[i] = 0.0;
+        for(long i=0;i<2*dsamples;i++) work[i] = het[2*c*dsamples + i];
+
+        complexfft(work,fftlength,-1);
+
+        for(long k=0;k<bandbins;k++) {
+            long ind = (k - bandbins/2 + fftlength) % fftlength;
+            power[k] = work[2*ind]*work[2*ind] + work[2*ind+1]*work[2*ind+1];
+        }
+
+        qsort(power,bandbins,sizeof(double),fstatcompare);
+
+        noise[c] = 2.0 * (power[bandbins/2] / log(2.0)) * ddeltat / dsamples;
+    }
+
+    delete [] power;
+}
+
+// complex envelopes of the response to the plus and cross basis waves,
+// for every channel and decimated sample; they are evaluated on a grid
+// coarse enough to follow the annual Doppler and antenna modulations,
+// and Lagrange-interpolated (four points) in between
+
+void FStatistic::envelope(FStatBand &fb,double beta,double lambda) {
+    const double year = 2.0 * M_PI / Omega;
+    const double f0 = fb.f0;
+
+    double *env = fb.env;
+
+    double rate = 2.0 * M_PI * (f0 * 1.0e-4 + 4.0 / year);
+    long stride = long(floor(0.2 / rate / ddeltat));
+    if(stride < 1) stride = 1;
+
+    long coarse = (dsamples - 1) / stride + 2;
+    if(coarse < 4) coarse = 4;
+
+    double t1 = inittime + decimate * deltat;
+    double h = (dsamples - 1) * ddeltat / (coarse - 1);
+
+    HeterodyneWave *waves[4];
+    TDIsignal *signals[4];
+
+    for(int w=0;w<4;w++) {
+        waves[w] = new HeterodyneWave(f0,w/2,w%2,beta,lambda);
+        signals[w] = new TDIsignal(fb.lisa,waves[w]);
+    }
+
+    // cenv[((n*2 + pol)*channels + c)*2 + re/im]
+
+    double *cenv = new double[coarse * 2 * channels * 2];
+
+    for(long n=0;n<coarse;n++) {
+        double t = t1 + n * h;
+
+        double rot_r = cos(2.0 * M_PI * f0 * t), rot_i = -sin(2.0 * M_PI * f0 * t);
+
+        for(int pol=0;pol<2;pol++) {
+            double obs[2][fstatchannels];
+
+            for(int q=0;q<2;q++)
+                for(int b=0;b<bases;b++)
+                    obs[q][b] = (signals[2*pol + q]->*base[b])(t);
+
+            for(int c=0;c<channels;c++) {
+                double zr = 0.0, zi = 0.0;
+
+                for(int b=0;b<bases;b++) {
+                    zr += coeff[c][b] * obs[0][b];
+                    zi += coeff[c][b] * obs[1][b];
+                }
+
+                double *e = &cenv[((n*2 + pol)*channels + c)*2];
+
+                e[0] = zr * rot_r - zi * rot_i;
+                e[1] = zr * rot_i + zi * rot_r;
+            }
+        }
+    }
+
+    for(long m=0;m<dsamples;m++) {
+        double x = m * ddeltat / h;
+
+        long n0 = long(floor(x)) - 1;
+        if(n0 < 0) n0 = 0;
+        if(n0 > coarse - 4) n0 = coarse - 4;
+
+        double s = x - n0, l[4];
+
+        l[0] = -(s-1.0)*(s-2.0)*(s-3.0)/6.0;
+        l[1] =  s*(s-2.0)*(s-3.0)/2.0;
+        l[2] = -s*(s-1.0)*(s-3.0)/2.0;
+        l[3] =  s*(s-1.0)*(s-2.0)/6.0;
+
+        for(int pc=0;pc<2*channels;pc++) {
+            double er = 0.0, ei = 0.0;
+
+            for(int i=0;i<4;i++) {
+                double *e = &cenv[((n0 + i)*2*channels + pc)*2];
+
+                er += l[i] * e[0];
+                ei += l[i] * e[1];
+            }
+
+            env[2*(pc*dsamples + m)]   = er;
+            env[2*(pc*dsamples + m)+1] = ei;
+        }
+    }
+
+    delete [] cenv;
+
+    for(int w=0;w<4;w++) {
+        delete signals[w];
+        delete waves[w];
+    }
+}
+
+// build the 4x4 matrix M_{mu nu} = (h_mu|h_nu) for the basis waveforms
+// Re[R e^{i Phi}], Im[R e^{i Phi}] (R = plus, cross envelopes), and
+// store its Cholesky factor in minv; return 0 if M is singular
+
+int FStatistic::projection(FStatBand &fb,double *minv) {
+    double m[4][4];
+
+    double *env = fb.env, *noise = fb.noise;
+
+    for(int i=0;i<4;i++)
+        for(int j=0;j<4;j++) m[i][j] = 0.0;
+
+    for(int c=0;c<channels;c++) {
+        double pp = 0.0, xx = 0.0, pxr = 0.0, pxi = 0.0;
+
+        double *ep = &env[2*c*dsamples], *ex = &env[2*(channels + c)*dsamples];
+
+        for(long n=0;n<dsamples;n++) {
+            pp  += ep[2*n]*ep[2*n] + ep[2*n+1]*ep[2*n+1];
+            xx  += ex[2*n]*ex[2*n] + ex[2*n+1]*ex[2*n+1];
+            pxr += ep[2*n]*ex[2*n] + ep[2*n+1]*ex[2*n+1];
+            pxi += ep[2*n+1]*ex[2*n] - ep[2*n]*ex[2*n+1];
+        }
+
+        // (2/S) * (1/2) Re sum alpha_mu conj(alpha_nu) deltat, with
+        // alpha = (R+, -i R+, Rx, -i Rx)
+
+        double w = ddeltat / noise[c];
+
+        m[0][0] += w * pp;  m[1][1] += w * pp;
+        m[2][2] += w * xx;  m[3][3] += w * xx;
+        m[0][2] += w * pxr; m[1][3] += w * pxr;
+        m[0][3] += w * pxi; m[1][2] -= w * pxi;
+    }
+
+    for(int i=0;i<4;i++)
+        for(int j=0;j<i;j++) m[i][j] = m[j][i];
+
+    for(int j=0;j<4;j++) {
+        double d = m[j][j];
+        for(int k=0;k<j;k++) d -= minv[4*j+k] * minv[4*j+k];
+
+        if(d <= 1.0e-12 * m[j][j] || d <= 0.0) return 0;
+
+        minv[4*j+j] = sqrt(d);
+
+        for(int i=j+1;i<4;i++) {
+            double s = m[i][j];
+            for(int k=0;k<j;k++) s -= minv[4*i+k] * minv[4*j+k];
+
+            minv[4*i+j] = s / minv[4*j+j];
+        }
+    }
+
+    return 1;
+}
+
+// search the bins first..last of band (in fstat, of nbins = last - first + 1 per row)
+
+void FStatistic::searchband(FStatBand &fb,long band,double *fstat,long first,long last,
+                            double *fdots,long nfdots,double *betas,double *lambdas,long nsky) {
+    heterodyne(fb,band);
+
+    double *het = fb.het, *noise = fb.noise, *work = fb.work, *env = fb.env;
+
+    long nbins = last - first + 1;
+    double t1 = inittime + decimate * deltat;
+
+    long center = band * bandbins + bandbins/2;
+
+    long bfirst = band * bandbins > first ? band * bandbins : first;
+    long blast = (band+1) * bandbins - 1 < last ? (band+1) * bandbins - 1 : last;
+
+    for(long s=0;s<nsky;s++) {
+        envelope(fb,betas[s],lambdas[s]);
+
+        double l[16];
+        int valid = projection(fb,l);
+
+        for(long q=0;q<nfdots;q++) {
+            double *out = &fstat[(s*nfdots + q)*nbins];
+
+            if(!valid) {
+                for(long i=bfirst;i<=blast;i++) out[i - first] = 0.0;
+                continue;
+            }
+
+            // g = conj(D) R exp(i pi fdot t^2) deltat_d, transformed
+            // to exp(2 pi i delta t) for all the in-band offsets delta
+
+            for(int pc=0;pc<2*channels;pc++) {
+                double *g = &work[2*pc*fftlength];
+                double *d = &het[2*(pc % channels)*dsamples];
+                double *e = &env[2*pc*dsamples];
+
+                for(long n=0;n<dsamples;n++) {
+                    double t = t1 + n * ddeltat;
+                    double ph = M_PI * fdots[q] * t * t;
+
+                    double cr = cos(ph) * ddeltat, ci = sin(ph) * ddeltat;
+
+                    double ar = d[2*n]*e[2*n] + d[2*n+1]*e[2*n+1];
+                    double ai = d[2*n]*e[2*n+1] - d[2*n+1]*e[2*n];
+
+                    g[2*n]   = ar*cr - ai*ci;
+                    g[2*n+1] = ar*ci + ai*cr;
+                }
+
+                for(long n=2*dsamples;n<2*fftlength;n++) g[n] = 0.0;
+
+                complexfft(g,fftlength,1);
+            }
+
+            for(long i=bfirst;i<=blast;i++) {
+                long k = i - center;
+                long ind = (k + fftlength) % fftlength;
+
+                double ph = 2.0 * M_PI * (k * df) * t1;
+                double rr = cos(ph), ri = sin(ph);
+
+                double x[4] = {0.0, 0.0, 0.0, 0.0};
+
+                for(int c=0;c<channels;c++) {
+                    double w = 2.0 / noise[c];
+
+                    for(int pol=0;pol<2;pol++) {
+                        double *g = &work[2*(pol*channels + c)*fftlength + 2*ind];
+
+                        x[2*pol]   += w * (g[0]*rr - g[1]*ri);
+                        x[2*pol+1] += w * (g[0]*ri + g[1]*rr);
+                    }
+                }
+
+                // F = x^T M^{-1} x / 2, with M = L L^T
+
+                double f = 0.0;
+
+                for(int j=0;j<4;j++) {
+                    double y = x[j];
+                    for(int k2=0;k2<j;k2++) y -= l[4*j+k2] * x[k2];
+
+                    x[j] = y / l[4*j+j];
+                    f += x[j] * x[j];
+                }
+
+                out[i - first] = 0.5 * f;
+            }
+        }
+    }
+}
+
+/* A search thread takes the bands firstband, firstband + step, ...
+   (up to lastband); failed records the exception that stopped it
+   (1 for ExceptionWrongArguments, 2 for any other). */
+
+struct FStatJob {
+    FStatistic *fs;
+    FStatBand fb;
+
+    long firstband, lastband, step;
+
+    double *fstat, *fdots, *betas, *lambdas;
+    long first, last, nfdots, nsky;
+
+    int failed;
+};
+
+void *FStatistic::worker(void *job) {
+    FStatJob *j = (FStatJob *)job;
+
+    try {
+        for(long band=j->firstband;band<=j->lastband;band+=j->step)
+            j->fs->searchband(j->fb,band,j->fstat,j->first,j->last,j->fdots,j->nfdots,j->betas,j->lambdas,j->nsky);
+    } catch (ExceptionWrongArguments &e) {
+        j->failed = 1;
+    } catch (...) {
+        j->failed = 2;
+    }
+
+    return 0;
+}
+
+void FStatistic::search(double *fstat,long fstatlength,double fmin,double *fdots,long nfdots,double *betas,long nbetas,double *lambdas,long nlambdas,int threads) {
+    long nsky = nbetas;
+
+    if(nbetas != nlambdas || nsky < 1 || nfdots < 1 || fstatlength % (nsky * nfdots) != 0 || fmin <= 0.0 || threads < 1) {
+        std::cerr << "FStatistic::search(...): need equal numbers of betas and lambdas, and an output array of"
+                  << " length nsky*nfdots*nbins, and threads > 0, got " << nbetas << ", " << nlambdas << ", " << fstatlength
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    long nbins = fstatlength / (nsky * nfdots);
+    long first = getbin(fmin), last = first + nbins - 1;
+
+    if((last * df + bandwidth) >= 0.5 / deltat) {
+        std::cerr << "FStatistic::search(...): search band reaches the Nyquist frequency " << 0.5 / deltat
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    long firstband = first / bandbins, lastband = last / bandbins;
+
+    if(threads > lastband - firstband + 1) threads = lastband - firstband + 1;
+
+    // thread 0 is the caller, with its own band; the others get copies
+    // of the LISA object, or are not started if it cannot be copied
+
+    FStatJob *jobs = new FStatJob[threads];
+    pthread_t *thread = new pthread_t[threads];
+    int *started = new int[threads];
+
+    for(int k=0;k<threads;k++) {
+        jobs[k].fs = this;
+
+        jobs[k].firstband = firstband + k;
+        jobs[k].lastband = lastband;
+        jobs[k].step = threads;
+
+        jobs[k].fstat = fstat; jobs[k].fdots = fdots; jobs[k].betas = betas; jobs[k].lambdas = lambdas;
+        jobs[k].first = first; jobs[k].last = last; jobs[k].nfdots = nfdots; jobs[k].nsky = nsky;
+
+        jobs[k].failed = 0;
+        started[k] = 0;
+
+        if(k > 0) {
+            LISA *copy = lisa->copy();
+
+            if(copy) {
+                newband(jobs[k].fb,copy);
+
+                started[k] = (pthread_create(&thread[k],0,worker,&jobs[k]) == 0);
+
+                if(!started[k]) {
+                    deleteband(jobs[k].fb);
+                    delete copy;
+                }
+            }
+        }
+    }
+
+    // bands of threads that did not start are searched by the caller
+
+    for(long band=firstband;band<=lastband;band++) {
+        int k = (band - firstband) % threads;
+
+        if(k == 0 || !started[k]) {
+            try {
+                searchband(own,band,fstat,first,last,fdots,nfdots,betas,lambdas,nsky);
+            } catch (ExceptionWrongArguments &e) {
+                jobs[0].failed = 1;
+                break;
+            } catch (...) {
+                jobs[0].failed = 2;
+                break;
+            }
+        }
+    }
+
+    int failed = 0;
+
+    for(int k=0;k<threads;k++) {
+        if(started[k]) {
+            pthread_join(thread[k],0);
+
+            delete jobs[k].fb.lisa;
+            deleteband(jobs[k].fb);
+        }
+
+        if(jobs[k].failed > failed) failed = jobs[k].failed;
+    }
+
+    delete [] started;
+    delete [] thread;
+    delete [] jobs;
+
+    if(failed == 1) {
+        ExceptionWrongArguments e;
+        throw e;
+    } else if(failed) {
+        std::cerr << "FStatistic::search(...): a search thread failed"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionUndefined e;
+        throw e;
+    }
+}
+
+void FStatistic::fstat(double *fs,long fslength,double fmin,double beta,double lambda,double fdot) {
+    search(fs,fslength,fmin,&fdot,1,&beta,1,&lambda,1);
+}
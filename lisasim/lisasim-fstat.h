@@ -0,0 +1,117 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_FSTAT_H_
+#define _LISASIM_FSTAT_H_
+
+#include "lisasim-tdi.h"
+#include "lisasim-lisa.h"
+#include "lisasim-wave.h"
+
+/// Maximum number of data channels, and of distinct TDI observables they use.
+
+const int fstatchannels = 6;
+
+/** F-statistic search for quasi-monochromatic binaries (as
+    GalacticBinary) over TDI data. The data (channels interleaved, as
+    returned by getobs) are split in frequency bands of width
+    bandwidth; in each band they are heterodyned to the band center,
+    low-passed with a triangular window and decimated. For every sky
+    position the TDI response to the four basis waveforms (plus/cross,
+    cosine/sine) is computed with TDIsignal on a coarse time grid, as
+    complex envelopes; the amplitude-projected data for all the
+    frequency bins of the band are then obtained with one FFT per
+    polarization and channel for every fdot. The envelopes are computed
+    at the band center, so the band must be narrow compared with
+    1/(pi AU/c) for the Doppler phase to be captured.
+
+    The channels are taken to have uncorrelated noise (e.g., Am, Em,
+    Tm), with PSD flat across a band; it is estimated from the median
+    of each band's periodogram. 2F follows a chi^2 distribution with 4
+    degrees of freedom and noncentrality SNR^2.
+
+    The bands of a search are independent, so search can split them
+    among threads, each with its own copy of the LISA object (see
+    LISA::copy) and its own heterodyned data and work arrays; LISA
+    objects that cannot be copied are searched in one thread. */
+
+/// The band a search thread is working on, its heterodyned data and noise estimates, and its work arrays.
+
+struct FStatBand {
+    LISA *lisa;
+
+    long band;
+    double f0;
+
+    double *het, *noise;
+    double *env, *work;
+};
+
+struct FStatJob;
+
+class FStatistic {
+ private:
+    LISA *lisa;
+
+    // channels are linear combinations of the TDI observables in base
+
+    int channels, bases;
+    double (TDI::*base[fstatchannels])(double t);
+    double coeff[fstatchannels][fstatchannels];
+
+    double *data;
+    long samples;
+
+    double deltat, inittime, bandwidth;
+
+    // decimation factor, decimated samples, FFT length, bins per band
+
+    long decimate, dsamples, fftlength, bandbins;
+    double ddeltat, df;
+
+    // the calling thread's band, kept between searches
+
+    FStatBand own;
+
+    void parseobservables(char *observables);
+
+    void newband(FStatBand &fb,LISA *l);
+    void deleteband(FStatBand &fb);
+
+    void heterodyne(FStatBand &fb,long newband);
+    void envelope(FStatBand &fb,double beta,double lambda);
+    int projection(FStatBand &fb,double *minv);
+
+    void searchband(FStatBand &fb,long band,double *fstat,long first,long last,
+                    double *fdots,long nfdots,double *betas,double *lambdas,long nsky);
+
+    // runs on a search thread (job is an FStatJob)
+
+    static void *worker(void *job);
+
+ public:
+    FStatistic(LISA *mylisa,double *data,long length,char *observables,double deltat,double inittime = 0.0,double bandwidth = 5.0e-5);
+    ~FStatistic();
+
+    /// Frequency spacing of the search grid; bin i is at frequency i*df.
+    double getdf() { return df; };
+
+    /// First bin at or above frequency f.
+    long getbin(double f);
+
+    double getfrequency(long bin) { return bin * df; };
+
+    /** Fill fstat (of length nsky*nfdots*nbins, ordered as
+        [sky][fdot][bin]) with F for nbins frequency bins starting at
+        getbin(fmin), for every fdot in fdots, and for the sky
+        positions (betas[i],lambdas[i]), using up to threads threads. */
+    void search(double *fstat,long fstatlength,double fmin,double *fdots,long nfdots,double *betas,long nbetas,double *lambdas,long nlambdas,int threads = 1);
+
+    /// F for a single sky position and fdot.
+    void fstat(double *fstat,long fstatlength,double fmin,double beta,double lambda,double fdot = 0.0);
+};
+
+#endif /* _LISASIM_FSTAT_H_ */
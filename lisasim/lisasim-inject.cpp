@@ -0,0 +1,644 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-inject.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+
+#include <stdio.h>
+#include <string.h>
+#include <typeinfo>
+
+// header of the response files written in directory-backed caches
+
+struct InjectionHeader {
+    char magic[8];
+
+    long samples, observables;
+    double stime, inittime;
+
+    double params[catalogcolumns];
+    double geometry[injectiongeometry];
+};
+
+static const char injectionmagic[8] = "SLINJ02";
+
+InjectionCache::InjectionCache(LISA *l,long len,double st,char *obs,double it,char *dir)
+    : lisa(l), samples(len), stime(st), inittime(it), entries(0), computed(0), loaded(0), rescaled(0) {
+
+    observables = parsetdicombinations(obs,combs,64);
+
+    if(observables <= 0 || samples <= 0) {
+        std::cerr << "InjectionCache::InjectionCache(...): need a positive length and (up to 64 known) observables in '"
+                  << obs << "' [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    fingerprint();
+
+    obsnames = new char[strlen(obs) + 1];
+    strcpy(obsnames,obs);
+
+    if(dir) {
+        directory = new char[strlen(dir) + 1];
+        strcpy(directory,dir);
+    } else {
+        directory = 0;
+    }
+
+    total = new double[samples * observables];
+    for(long i=0;i<samples*observables;i++) total[i] = 0.0;
+
+    tablesize = 1024;
+    table = new InjectionEntry*[tablesize];
+    for(long i=0;i<tablesize;i++) table[i] = 0;
+}
+
+InjectionCache::~InjectionCache() {
+    for(long i=0;i<tablesize;i++) {
+        InjectionEntry *entry = table[i];
+
+        while(entry) {
+            InjectionEntry *next = entry->next;
+
+            delete [] entry->response;
+            delete entry;
+
+            entry = next;
+        }
+    }
+
+    delete [] table;
+    delete [] total;
+
+    delete [] directory;
+    delete [] obsnames;
+}
+
+// sample the geometry of lisa at the first, middle, and last sample
+
+void InjectionCache::fingerprint() {
+    lisaclass = typeid(*lisa).name();
+
+    double *g = geometry;
+
+    for(int k=0;k<3;k++) {
+        double t = inittime + stime * (k * (samples - 1) / 2);
+
+        for(int arm=1;arm<=3;arm++) {
+            *g++ = lisa->armlength(arm,t);
+            *g++ = lisa->armlength(-arm,t);
+        }
+
+        for(int craft=1;craft<=3;craft++) {
+            Vector p;
+            lisa->putp(p,craft,t);
+
+            for(int i=0;i<3;i++) *g++ = p[i];
+        }
+    }
+}
+
+// FNV-1a over the sampling parameters, the observables, the LISA class
+// and geometry, and the source parameters (with -0 normalized to 0, so
+// that equal rows hash equally)
+
+unsigned long long InjectionCache::hashparams(double *params) {
+    unsigned long long hash = 14695981039346656037ULL;
+
+    unsigned char *bytes;
+
+    bytes = (unsigned char *)&samples;
+    for(unsigned int j=0;j<sizeof(long);j++) hash = (hash ^ bytes[j]) * 1099511628211ULL;
+
+    bytes = (unsigned char *)&stime;
+    for(unsigned int j=0;j<sizeof(double);j++) hash = (hash ^ bytes[j]) * 1099511628211ULL;
+
+    bytes = (unsigned char *)&inittime;
+    for(unsigned int j=0;j<sizeof(double);j++) hash = (hash ^ bytes[j]) * 1099511628211ULL;
+
+    for(char *c = obsnames;*c;c++) hash = (hash ^ (unsigned char)(*c)) * 1099511628211ULL;
+
+    for(const char *c = lisaclass;*c;c++) hash = (hash ^ (unsigned char)(*c)) * 1099511628211ULL;
+
+    bytes = (unsigned char *)geometry;
+    for(unsigned int j=0;j<sizeof(geometry);j++) hash = (hash ^ bytes[j]) * 1099511628211ULL;
+
+    for(int i=0;i<catalogcolumns;i++) {
+        double p = params[i] == 0.0 ? 0.0 : params[i];
+
+        bytes = (unsigned char *)&p;
+        for(unsigned int j=0;j<sizeof(double);j++) hash = (hash ^ bytes[j]) * 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+InjectionEntry *InjectionCache::find(double *params) {
+    unsigned long long key = hashparams(params);
+
+    for(InjectionEntry *entry = table[key % tablesize];entry;entry = entry->next) {
+        if(entry->key != key) continue;
+
+        int i = 0;
+        while(i < catalogcolumns && entry->params[i] == params[i]) i++;
+
+        if(i == catalogcolumns) return entry;
+    }
+
+    return 0;
+}
+
+// a new entry, not yet in the table
+
+InjectionEntry *InjectionCache::newentry(double *params) {
+    InjectionEntry *entry = new InjectionEntry;
+
+    for(int i=0;i<catalogcolumns;i++) entry->params[i] = params[i];
+    entry->key = hashparams(params);
+
+    entry->count = 0;
+    entry->wanted = 0;
+    entry->response = 0;
+    entry->next = 0;
+
+    return entry;
+}
+
+void InjectionCache::insert(InjectionEntry *entry) {
+    if(entries >= 2 * tablesize) grow();
+
+    long bucket = entry->key % tablesize;
+
+    entry->next = table[bucket];
+    table[bucket] = entry;
+
+    entries++;
+}
+
+// remove from the table, but do not free
+
+void InjectionCache::unlink(InjectionEntry *entry) {
+    InjectionEntry **link = &table[entry->key % tablesize];
+
+    while(*link != entry) link = &(*link)->next;
+
+    *link = entry->next;
+    entry->next = 0;
+
+    entries--;
+}
+
+void InjectionCache::grow() {
+    long newsize = 2 * tablesize;
+    InjectionEntry **newtable = new InjectionEntry*[newsize];
+
+    for(long i=0;i<newsize;i++) newtable[i] = 0;
+
+    for(long i=0;i<tablesize;i++) {
+        InjectionEntry *entry = table[i];
+
+        while(entry) {
+            InjectionEntry *next = entry->next;
+
+            entry->next = newtable[entry->key % newsize];
+            newtable[entry->key % newsize] = entry;
+
+            entry = next;
+        }
+    }
+
+    delete [] table;
+
+    table = newtable;
+    tablesize = newsize;
+}
+
+void InjectionCache::filename(char *name,unsigned long long key) {
+    sprintf(name,"%s/%016llx.inj",directory,key);
+}
+
+bool InjectionCache::readresponse(InjectionEntry *entry,double *response) {
+    char *name = new char[strlen(directory) + 32];
+    filename(name,entry->key);
+
+    FILE *file = fopen(name,"rb");
+
+    delete [] name;
+
+    if(!file) return false;
+
+    InjectionHeader header;
+
+    bool ok = (fread(&header,sizeof(InjectionHeader),1,file) == 1 &&
+               !memcmp(header.magic,injectionmagic,8) &&
+               header.samples == samples && header.observables == observables &&
+               header.stime == stime && header.inittime == inittime);
+
+    for(int i=0;ok && i<catalogcolumns;i++)
+        if(header.params[i] != entry->params[i]) ok = false;
+
+    for(int i=0;ok && i<injectiongeometry;i++)
+        if(header.geometry[i] != geometry[i]) ok = false;
+
+    if(ok)
+        ok = (fread(response,sizeof(double),samples*observables,file) == (size_t)(samples*observables));
+
+    fclose(file);
+
+    return ok;
+}
+
+void InjectionCache::writeresponse(InjectionEntry *entry,double *response) {
+    char *name = new char[strlen(directory) + 32];
+    filename(name,entry->key);
+
+    FILE *file = fopen(name,"wb");
+
+    InjectionHeader header;
+
+    memcpy(header.magic,injectionmagic,8);
+
+    header.samples = samples;
+    header.observables = observables;
+    header.stime = stime;
+    header.inittime = inittime;
+
+    for(int i=0;i<catalogcolumns;i++) header.params[i] = entry->params[i];
+    for(int i=0;i<injectiongeometry;i++) header.geometry[i] = geometry[i];
+
+    if(!file || fwrite(&header,sizeof(InjectionHeader),1,file) != 1 ||
+       fwrite(response,sizeof(double),samples*observables,file) != (size_t)(samples*observables)) {
+        std::cerr << "InjectionCache::writeresponse(...): cannot write " << name
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        if(file) fclose(file);
+        delete [] name;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    fclose(file);
+    delete [] name;
+}
+
+// with a directory, responses live on disk and are read on demand;
+// otherwise the entry owns its response
+
+double *InjectionCache::getresponse(InjectionEntry *entry) {
+    if(!directory) return entry->response;
+
+    double *response = new double[samples * observables];
+
+    if(!readresponse(entry,response)) {
+        std::cerr << "InjectionCache::getresponse(...): cannot read the stored response of a source from "
+                  << directory << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete [] response;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    return response;
+}
+
+void InjectionCache::releaseresponse(InjectionEntry *entry,double *response) {
+    if(directory) delete [] response;
+}
+
+// hand a new response over to the entry, and add it to the total; if
+// the response cannot be stored, it still belongs to the caller
+
+void InjectionCache::putresponse(InjectionEntry *entry,double *response) {
+    if(directory) {
+        writeresponse(entry,response);
+        accumulate(response,1.0);
+        delete [] response;
+    } else {
+        entry->response = response;
+        accumulate(response,1.0);
+    }
+}
+
+double *InjectionCache::newresponse(double *params) {
+    double *response = new double[samples * observables];
+    for(long i=0;i<samples*observables;i++) response[i] = 0.0;
+
+    try {
+        getcatalogobs(response,samples,stime,lisa,params,0,1,combs,observables,inittime);
+    } catch (...) {
+        delete [] response;
+        throw;
+    }
+
+    computed++;
+
+    return response;
+}
+
+/* Add a source that is not in the table to the total, with response
+   (a rescaled one, handed over) if given, or else from the directory
+   or computed; the entry enters the table only once its response is
+   stored, so a failure (bad parameters, a keyboard interrupt) leaves
+   the table and the total as they were. */
+
+InjectionEntry *InjectionCache::addsource(double *params,double *response) {
+    InjectionEntry *entry = newentry(params);
+
+    try {
+        bool stored = false;
+
+        if(!response && directory) {
+            response = new double[samples * observables];
+
+            stored = readresponse(entry,response);
+
+            if(stored) {
+                loaded++;
+                accumulate(response,1.0);
+            }
+
+            delete [] response;
+            response = 0;
+        }
+
+        if(!stored) {
+            if(!response) response = newresponse(params);
+
+            putresponse(entry,response);
+        }
+    } catch (...) {
+        delete [] response;
+        delete entry;
+
+        throw;
+    }
+
+    entry->count = 1;
+    insert(entry);
+
+    return entry;
+}
+
+void InjectionCache::accumulate(double *response,double factor) {
+    long length = samples * observables;
+
+    if(factor == 1.0) {
+        for(long i=0;i<length;i++) total[i] += response[i];
+    } else if(factor == -1.0) {
+        for(long i=0;i<length;i++) total[i] -= response[i];
+    } else {
+        for(long i=0;i<length;i++) total[i] += factor * response[i];
+    }
+}
+
+void InjectionCache::checkcatalog(const char *method,long length) {
+    if(length % catalogcolumns != 0) {
+        std::cerr << "InjectionCache::" << method << "(...): need a catalog with " << catalogcolumns
+                  << " columns [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+}
+
+void InjectionCache::add(double *catalog,long length) {
+    checkcatalog("add",length);
+
+    for(long r=0;r<length/catalogcolumns;r++) {
+        double *params = &catalog[r * catalogcolumns];
+
+        InjectionEntry *entry = find(params);
+
+        if(entry) {
+            double *response = getresponse(entry);
+            accumulate(response,1.0);
+            releaseresponse(entry,response);
+
+            entry->count++;
+        } else {
+            addsource(params,0);
+        }
+    }
+}
+
+void InjectionCache::remove(double *catalog,long length) {
+    checkcatalog("remove",length);
+
+    long rows = length / catalogcolumns;
+
+    // check everything first, so that a bad catalog leaves the total untouched
+
+    InjectionEntry **found = new InjectionEntry*[rows];
+
+    long r;
+
+    for(r=0;r<rows;r++) {
+        found[r] = find(&catalog[r * catalogcolumns]);
+
+        if(!found[r] || ++found[r]->wanted > found[r]->count) break;
+    }
+
+    for(long q=0;q<rows && q<=r;q++) if(found[q]) found[q]->wanted = 0;
+
+    if(r < rows) {
+        std::cerr << "InjectionCache::remove(...): source " << r << " is not in the cache"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete [] found;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    for(r=0;r<rows;r++) {
+        InjectionEntry *entry = found[r];
+
+        double *response = getresponse(entry);
+        accumulate(response,-1.0);
+        releaseresponse(entry,response);
+
+        // later rows point to this entry only if it has more copies
+
+        if(--entry->count == 0) {
+            unlink(entry);
+
+            delete [] entry->response;
+            delete entry;
+        }
+    }
+
+    delete [] found;
+}
+
+void InjectionCache::update(double *catalog,long length) {
+    checkcatalog("update",length);
+
+    long rows = length / catalogcolumns;
+
+    // count how many copies of each cached source are wanted
+
+    bool *isnew = new bool[rows];
+
+    for(long r=0;r<rows;r++) {
+        InjectionEntry *entry = find(&catalog[r * catalogcolumns]);
+
+        if(entry) entry->wanted++;
+        isnew[r] = !entry;
+    }
+
+    // adjust the copies of the sources that stay; subtract the sources
+    // that go, and set them aside for rescaling. If anything fails, the
+    // total still corresponds to the sources in the table
+
+    InjectionEntry *retired = 0;
+
+    try {
+        for(long i=0;i<tablesize;i++) {
+            InjectionEntry *entry = table[i];
+
+            while(entry) {
+                InjectionEntry *next = entry->next;
+
+                if(entry->wanted != entry->count) {
+                    double *response = getresponse(entry);
+                    accumulate(response,double(entry->wanted - entry->count));
+                    releaseresponse(entry,response);
+
+                    entry->count = entry->wanted;
+                }
+
+                entry->wanted = 0;
+
+                if(entry->count == 0) {
+                    unlink(entry);
+
+                    entry->next = retired;
+                    retired = entry;
+                }
+
+                entry = next;
+            }
+        }
+
+        // add the new sources, rescaling retired ones that differ only in amplitude
+
+        for(long r=0;r<rows;r++) {
+            if(!isnew[r]) continue;
+
+            double *params = &catalog[r * catalogcolumns];
+
+            InjectionEntry *entry = find(params);
+
+            if(entry) {
+                double *response = getresponse(entry);
+                accumulate(response,1.0);
+                releaseresponse(entry,response);
+
+                entry->count++;
+                continue;
+            }
+
+            InjectionEntry **link = &retired;
+
+            while(*link) {
+                int i = 0;
+                while(i < catalogcolumns && (i == 4 || (*link)->params[i] == params[i])) i++;
+
+                if(i == catalogcolumns && (*link)->params[4] != 0.0) break;
+
+                link = &(*link)->next;
+            }
+
+            double *response = 0;
+
+            if(*link) {
+                InjectionEntry *old = *link;
+
+                response = getresponse(old);
+
+                *link = old->next;
+                if(!directory) old->response = 0;
+
+                double factor = params[4] / old->params[4];
+                for(long i=0;i<samples*observables;i++) response[i] *= factor;
+
+                delete [] old->response;
+                delete old;
+
+                rescaled++;
+            }
+
+            addsource(params,response);
+        }
+    } catch (...) {
+        for(long i=0;i<tablesize;i++)
+            for(InjectionEntry *entry = table[i];entry;entry = entry->next) entry->wanted = 0;
+
+        while(retired) {
+            InjectionEntry *next = retired->next;
+
+            delete [] retired->response;
+            delete retired;
+
+            retired = next;
+        }
+
+        delete [] isnew;
+
+        throw;
+    }
+
+    while(retired) {
+        InjectionEntry *next = retired->next;
+
+        delete [] retired->response;
+        delete retired;
+
+        retired = next;
+    }
+
+    delete [] isnew;
+}
+
+void InjectionCache::rebuild() {
+    for(long i=0;i<samples*observables;i++) total[i] = 0.0;
+
+    for(long i=0;i<tablesize;i++) {
+        for(InjectionEntry *entry = table[i];entry;entry = entry->next) {
+            double *response = getresponse(entry);
+            accumulate(response,double(entry->count));
+            releaseresponse(entry,response);
+        }
+    }
+}
+
+void InjectionCache::gettotal(double *buffer,long length) {
+    if(length < samples * observables) {
+        std::cerr << "InjectionCache::gettotal(...): need a buffer of " << samples << "x" << observables
+                  << " doubles [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    for(long i=0;i<samples*observables;i++) buffer[i] = total[i];
+}
+
+long InjectionCache::getsources() {
+    long ret = 0;
+
+    for(long i=0;i<tablesize;i++)
+        for(InjectionEntry *entry = table[i];entry;entry = entry->next)
+            ret += entry->count;
+
+    return ret;
+}
@@ -0,0 +1,124 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_INJECT_H_
+#define _LISASIM_INJECT_H_
+
+#include "lisasim-parallel.h"
+
+/* One cached source response, keyed by its catalog row; count is the
+   number of copies of the source included in the total, and wanted is
+   scratch space for remove and update. If the cache is backed by a
+   directory, response is 0 and the data lives on disk. */
+
+struct InjectionEntry {
+    double params[catalogcolumns];
+    unsigned long long key;
+
+    long count, wanted;
+    double *response;
+
+    InjectionEntry *next;
+};
+
+
+/** Incremental injection of GalacticBinary catalogs (rows as for
+    fastgetobsp). Since TDI responses are linear in the sources, the
+    cache keeps the response of every source, keyed by its parameters,
+    and maintains their running total; adding, removing, or updating
+    sources only computes the responses of sources that are new, and
+    adds or subtracts the stored responses of the others. A source
+    whose parameters change only in amplitude is rescaled rather than
+    recomputed. If directory is given, responses are stored there (one
+    file per source, named by a hash of parameters and sampling) rather
+    than in memory, and are reused across sessions. The file names and
+    headers also carry a fingerprint of the LISA geometry (its class,
+    and its armlengths and spacecraft positions at the start, middle,
+    and end of the series), so that a directory shared by different
+    geometries does not return the responses of another. */
+
+/// Number of doubles in the geometry fingerprint (6 armlengths and 9 position coordinates at 3 times).
+
+const int injectiongeometry = 45;
+
+class InjectionCache {
+ private:
+    LISA *lisa;
+
+    long samples;
+    double stime, inittime;
+
+    char *obsnames;
+    const TDIcombination *combs[64];
+    int observables;
+
+    char *directory;
+
+    const char *lisaclass;
+    double geometry[injectiongeometry];
+
+    double *total;
+
+    InjectionEntry **table;
+    long tablesize, entries;
+
+    long computed, loaded, rescaled;
+
+    void fingerprint();
+    unsigned long long hashparams(double *params);
+
+    InjectionEntry *find(double *params);
+    InjectionEntry *newentry(double *params);
+    void insert(InjectionEntry *entry);
+    void unlink(InjectionEntry *entry);
+    void grow();
+
+    void filename(char *name,unsigned long long key);
+    bool readresponse(InjectionEntry *entry,double *response);
+    void writeresponse(InjectionEntry *entry,double *response);
+
+    double *getresponse(InjectionEntry *entry);
+    void putresponse(InjectionEntry *entry,double *response);
+    void releaseresponse(InjectionEntry *entry,double *response);
+
+    double *newresponse(double *params);
+    InjectionEntry *addsource(double *params,double *response);
+    void accumulate(double *response,double factor);
+
+    void checkcatalog(const char *method,long length);
+
+ public:
+    InjectionCache(LISA *lisa,long samples,double stime,char *observables,double inittime = 0.0,char *directory = 0);
+    ~InjectionCache();
+
+    /** Add the sources in catalog to the total. If a source fails
+        (bad parameters, keyboard interrupt), the total and the cache
+        keep the sources before it (the same holds for update). */
+    void add(double *catalog,long length);
+
+    /// Remove the sources in catalog from the total (they must have been added).
+    void remove(double *catalog,long length);
+
+    /// Make the total correspond to catalog, adding and removing only the differences.
+    void update(double *catalog,long length);
+
+    /// Recompute the total from the stored responses (to clear accumulated roundoff).
+    void rebuild();
+
+    /// Copy the total (samples rows of observables) to buffer.
+    void gettotal(double *buffer,long length);
+
+    long getsources();
+    long getsamples() { return samples; };
+    int getobservables() { return observables; };
+
+    /// Number of responses computed, read from disk, and rescaled so far.
+    long getcomputed() { return computed; };
+    long getloaded() { return loaded; };
+    long getrescaled() { return rescaled; };
+};
+
+#endif /* _LISASIM_INJECT_H_ */
@@ -9,6 +9,12 @@
 #include "lisasim-except.h"
 
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <limits.h>
 
 
 // --- generic LISA class --------------------------------------------------------------
@@ -50,6 +56,55 @@ void LISA::putv(Vector &v, int craft, double t) {
     v.setdifference(pp,pm);
 }
 
+// vectorized forms, looping over times
+
+void LISA::getp(double *buffer,long length,int craft,double *times,long samples) {
+    checkvalues("LISA::getp",length,samples,3);
+
+    Vector p;
+
+    for(long i=0;i<samples;i++) {
+        putp(p,craft,times[i]);
+        for(int j=0;j<3;j++) buffer[3*i+j] = p[j];
+    }
+}
+
+void LISA::getn(double *buffer,long length,int arm,double *times,long samples) {
+    checkvalues("LISA::getn",length,samples,3);
+
+    Vector n;
+
+    for(long i=0;i<samples;i++) {
+        putn(n,arm,times[i]);
+        for(int j=0;j<3;j++) buffer[3*i+j] = n[j];
+    }
+}
+
+void LISA::getv(double *buffer,long length,int craft,double *times,long samples) {
+    checkvalues("LISA::getv",length,samples,3);
+
+    Vector v;
+
+    for(long i=0;i<samples;i++) {
+        putv(v,craft,times[i]);
+        for(int j=0;j<3;j++) buffer[3*i+j] = v[j];
+    }
+}
+
+void LISA::getarmlength(double *buffer,long length,int arm,double *times,long samples) {
+    checkvalues("LISA::getarmlength",length,samples);
+
+    for(long i=0;i<samples;i++)
+        buffer[i] = armlength(arm,times[i]);
+}
+
+void LISA::getdotarmlength(double *buffer,long length,int arm,double *times,long samples) {
+    checkvalues("LISA::getdotarmlength",length,samples);
+
+    for(long i=0;i<samples;i++)
+        buffer[i] = dotarmlength(arm,times[i]);
+}
+
 /** Generic version of armlength. Will use putp iteratively to
     find the delay corresponding to a photon trajectory backward
     from t along "arm" */
@@ -140,6 +195,11 @@ void LISA::retard(LISA *anotherlisa, int ret) {
     }
 }
 
+void LISA::retard(const DelayChain &chain) {
+    for(int i=chain.size()-1;i>=0;i--)
+		retard(chain[i]);
+}
+
 void LISA::setguessL(double t) {
 	Vector pa,pb,n;
 
@@ -675,6 +735,467 @@ void SampledLISA::putp(Vector &p,int craft,double t) {
 }
 
 
+// --- EphemerisLISA ---
+
+static const double ephemerisclight = 299792.458;	// km/s
+static const double ephemerisday = 86400.0;
+
+static const char ephemerismagic[4] = {'S','L','E','2'};
+
+EphemerisLISA::EphemerisLISA(char *filename,char *cachefile)
+    : nodes(0), initjd(0.0), deltat(0.0), derived(0), sourcesize(0) {
+
+    for(int c=0;c<4;c++) { pos[c] = 0; vel[c] = 0; }
+    for(int a=0;a<7;a++) { lt[a] = 0; dlt[a] = 0; }
+
+    source[0] = 0;
+
+    try {
+        int binary = readbinary(filename);
+
+        if(binary < 0) {
+            ExceptionFileError e;
+            throw e;
+        }
+
+        if(!binary) {
+            struct stat ascii, cache;
+
+            if(!cachefile || stat(cachefile,&cache) != 0 || stat(filename,&ascii) != 0 ||
+               cache.st_mtime < ascii.st_mtime || readbinary(cachefile,filename) != 1) {
+                readascii(filename);
+
+                if(cachefile) writecache(cachefile);
+            }
+        }
+
+        solvelighttimes();
+    } catch (ExceptionFileError &e) {
+        release();
+        throw e;
+    }
+
+    for(int arm=1;arm<4;arm++) guessL[arm] = lt[arm][0];
+}
+
+EphemerisLISA::~EphemerisLISA() {
+    release();
+}
+
+void EphemerisLISA::release() {
+    for(int c=1;c<4;c++) {
+        delete [] pos[c]; pos[c] = 0;
+        delete [] vel[c]; vel[c] = 0;
+    }
+
+    for(int a=1;a<7;a++) {
+        delete [] lt[a]; lt[a] = 0;
+        delete [] dlt[a]; dlt[a] = 0;
+    }
+}
+
+void EphemerisLISA::allocate() {
+    if(nodes < 5) {
+        std::cerr << "EphemerisLISA::allocate(): need at least 5 nodes, but found " << nodes
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    for(int c=1;c<4;c++) {
+        pos[c] = new double[3*nodes];
+        vel[c] = new double[3*nodes];
+    }
+
+    for(int a=1;a<7;a++) {
+        lt[a] = new double[nodes];
+        dlt[a] = new double[nodes];
+    }
+}
+
+// count the numbers on a line of text
+
+static int countcolumns(char *line,double *values,int maxvalues) {
+    int count = 0;
+    char *end;
+
+    for(;;) {
+        double val = strtod(line,&end);
+        if(end == line) break;
+
+        if(count < maxvalues) values[count] = val;
+        count++;
+
+        line = end;
+    }
+
+    return count;
+}
+
+// the absolute path and size of filename, in path (pathsize chars); the
+// size is -1, so that no cache matches, if filename cannot be resolved
+// or its path does not fit (path then holds as much of it as fits)
+
+static void ephemerissource(char *filename,char *path,size_t pathsize,long long &size) {
+    char resolved[PATH_MAX];
+    struct stat info;
+
+    const char *name = filename;
+    size = -1;
+
+    if(realpath(filename,resolved) && stat(resolved,&info) == 0) {
+        name = resolved;
+        size = info.st_size;
+    }
+
+    size_t length = strlen(name);
+
+    if(length >= pathsize) {
+        length = pathsize - 1;
+        size = -1;
+    }
+
+    memcpy(path,name,length);
+    path[length] = 0;
+}
+
+void EphemerisLISA::readascii(char *filename) {
+    FILE *file = fopen(filename,"r");
+
+    if(!file) {
+        std::cerr << "EphemerisLISA::readascii(...): cannot open " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    ephemerissource(filename,source,sizeof(source),sourcesize);
+
+    const int linelength = 8192;
+    char line[linelength];
+    double values[19];
+
+    // first pass: count rows and check their format
+
+    int columns = 0;
+    nodes = 0;
+
+    while(fgets(line,linelength,file)) {
+        if(line[0] == '#') continue;
+
+        int count = countcolumns(line,values,19);
+        if(count == 0) continue;
+
+        if((count != 10 && count != 19) || (columns && count != columns)) {
+            std::cerr << "EphemerisLISA::readascii(...): " << filename << " has " << count
+                      << " columns in row " << nodes+1 << " (need 10, or 19 with velocities)"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            fclose(file);
+            ExceptionFileError e;
+            throw e;
+        }
+
+        columns = count;
+        nodes++;
+    }
+
+    try {
+        allocate();
+    } catch (ExceptionFileError &e) {
+        fclose(file);
+        throw e;
+    }
+
+    derived = (columns == 10);
+
+    // second pass: fill in positions (and velocities), converted to seconds
+
+    rewind(file);
+
+    long k = 0;
+
+    while(k < nodes && fgets(line,linelength,file)) {
+        if(line[0] == '#' || countcolumns(line,values,19) == 0) continue;
+
+        double t = values[0] * ephemerisday;
+
+        if(k == 0) {
+            initjd = values[0];
+        } else if(k == 1) {
+            deltat = t - initjd * ephemerisday;
+        }
+
+        if(k > 1 && fabs(t - initjd * ephemerisday - k * deltat) > 1e-6 * deltat) {
+            std::cerr << "EphemerisLISA::readascii(...): " << filename << " is not equally spaced at row "
+                      << k+1 << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            fclose(file);
+            ExceptionFileError e;
+            throw e;
+        }
+
+        for(int c=1;c<4;c++) {
+            for(int i=0;i<3;i++) {
+                pos[c][3*k+i] = values[1 + 3*(c-1) + i] / ephemerisclight;
+                if(!derived) vel[c][3*k+i] = values[10 + 3*(c-1) + i] / ephemerisclight;
+            }
+        }
+
+        k++;
+    }
+
+    fclose(file);
+
+    if(deltat <= 0.0) {
+        std::cerr << "EphemerisLISA::readascii(...): " << filename << " has nonincreasing times"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    if(derived) derivevelocities();
+}
+
+/* Binary form: magic "SLE2", the size (long long) of the ASCII file
+   it was made from, the length (int) and characters of its absolute
+   path (0 and empty if none), the number of nodes (long), the Julian
+   date of the first node, the spacing (s), the derived flag (int),
+   then positions and velocities (s and s/s) for the three craft, as
+   3*nodes doubles each, all in native byte order. Returns 1 if the
+   ephemeris was read; 0 if the file does not start with the magic,
+   or (with asciifile) was not made from the current asciifile; and
+   -1 if it is truncated or corrupt. */
+
+int EphemerisLISA::readbinary(char *filename,char *asciifile) {
+    FILE *file = fopen(filename,"rb");
+    if(!file) return 0;
+
+    char magic[4];
+
+    if(fread(magic,1,4,file) != 4 || memcmp(magic,ephemerismagic,4)) {
+        fclose(file);
+        return 0;
+    }
+
+    try {
+        long long size;
+        int length;
+
+        stateread(file,&size,sizeof(long long));
+        stateread(file,&length,sizeof(int));
+
+        if(length < 0 || length > 4095) {
+            ExceptionFileError e;
+            throw e;
+        }
+
+        stateread(file,source,length);
+        source[length] = 0;
+        sourcesize = size;
+
+        if(asciifile) {
+            char path[4096];
+            long long current;
+
+            ephemerissource(asciifile,path,sizeof(path),current);
+
+            if(current < 0 || size != current || strcmp(path,source)) {
+                fclose(file);
+                return 0;
+            }
+        }
+
+        stateread(file,&nodes,sizeof(long));
+        stateread(file,&initjd,sizeof(double));
+        stateread(file,&deltat,sizeof(double));
+        stateread(file,&derived,sizeof(int));
+
+        // do not trust a node count that the file cannot hold
+
+        struct stat info;
+
+        if(fstat(fileno(file),&info) != 0 || nodes < 5 || !(deltat > 0.0) ||
+           (info.st_size - ftello(file)) / (18 * (off_t)sizeof(double)) < nodes) {
+            ExceptionFileError e;
+            throw e;
+        }
+
+        allocate();
+
+        for(int c=1;c<4;c++) stateread(file,pos[c],3*nodes*sizeof(double));
+        for(int c=1;c<4;c++) stateread(file,vel[c],3*nodes*sizeof(double));
+    } catch (ExceptionFileError &e) {
+        std::cerr << "EphemerisLISA::readbinary(...): " << filename << " is truncated or corrupt"
+                  << (asciifile ? ", parsing the ASCII file instead" : "")
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        fclose(file);
+        release();
+
+        return -1;
+    }
+
+    fclose(file);
+
+    return 1;
+}
+
+void EphemerisLISA::writecache(char *filename) {
+    FILE *file = fopen(filename,"wb");
+
+    if(!file) {
+        std::cerr << "EphemerisLISA::writecache(...): cannot open " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    try {
+        int length = strlen(source);
+
+        statewrite(file,ephemerismagic,4);
+
+        statewrite(file,&sourcesize,sizeof(long long));
+        statewrite(file,&length,sizeof(int));
+        statewrite(file,source,length);
+
+        statewrite(file,&nodes,sizeof(long));
+        statewrite(file,&initjd,sizeof(double));
+        statewrite(file,&deltat,sizeof(double));
+        statewrite(file,&derived,sizeof(int));
+
+        for(int c=1;c<4;c++) statewrite(file,pos[c],3*nodes*sizeof(double));
+        for(int c=1;c<4;c++) statewrite(file,vel[c],3*nodes*sizeof(double));
+    } catch (ExceptionFileError &e) {
+        fclose(file);
+        throw e;
+    }
+
+    fclose(file);
+}
+
+// fourth-order finite differences (one-sided at the ends)
+
+void EphemerisLISA::derivevelocities() {
+    double h12 = 12.0 * deltat;
+
+    for(int c=1;c<4;c++) {
+        for(int i=0;i<3;i++) {
+            double *p = pos[c] + i, *v = vel[c] + i;
+            long n = nodes - 1;
+
+            v[0]     = (-25.0*p[0] + 48.0*p[3] - 36.0*p[6] + 16.0*p[9] - 3.0*p[12]) / h12;
+            v[3]     = ( -3.0*p[0] - 10.0*p[3] + 18.0*p[6] -  6.0*p[9] +     p[12]) / h12;
+
+            for(long k=2;k<n-1;k++)
+                v[3*k] = (p[3*(k-2)] - 8.0*p[3*(k-1)] + 8.0*p[3*(k+1)] - p[3*(k+2)]) / h12;
+
+            v[3*(n-1)] = -( -3.0*p[3*n] - 10.0*p[3*(n-1)] + 18.0*p[3*(n-2)] -  6.0*p[3*(n-3)] +     p[3*(n-4)]) / h12;
+            v[3*n]     = -(-25.0*p[3*n] + 48.0*p[3*(n-1)] - 36.0*p[3*(n-2)] + 16.0*p[3*(n-3)] - 3.0*p[3*(n-4)]) / h12;
+        }
+    }
+}
+
+/* Cubic Hermite interpolation of f (with derivative df) at time t, for
+   samples spaced by stride; also returns the derivative if dval != 0 */
+
+void EphemerisLISA::hermite(double *f,double *df,int stride,double t,double &val,double *dval) {
+    long k = long(floor(t / deltat));
+
+    if(k < 0) k = 0;
+    if(k > nodes - 2) k = nodes - 2;
+
+    double s = t / deltat - k, s2 = s*s, s3 = s2*s;
+
+    double f0 = f[stride*k],  f1 = f[stride*(k+1)];
+    double d0 = df[stride*k], d1 = df[stride*(k+1)];
+
+    val = (2.0*s3 - 3.0*s2 + 1.0) * f0 + (s3 - 2.0*s2 + s) * deltat * d0 +
+          (3.0*s2 - 2.0*s3) * f1 + (s3 - s2) * deltat * d1;
+
+    if(dval)
+        *dval = (6.0*s2 - 6.0*s) * (f0 - f1) / deltat +
+                (3.0*s2 - 4.0*s + 1.0) * d0 + (3.0*s2 - 2.0*s) * d1;
+}
+
+/* Solve L = |p_recv(t) - p_send(t - L)| at each node by iteration;
+   then dL/dt = n.(v_recv - v_send) / (1 - n.v_send). */
+
+void EphemerisLISA::solvelighttimes() {
+    for(int a=1;a<7;a++) {
+        int arm = (a < 4) ? a : 3 - a;
+        int crafta = getRecv(arm), craftb = getSend(arm);
+
+        for(long k=0;k<nodes;k++) {
+            double t = k * deltat;
+
+            Vector pa, pb, va, vb, n;
+
+            putp(pa,crafta,t);
+            putv(va,crafta,t);
+
+            double L = (k > 0) ? lt[a][k-1] : 0.0, oldL;
+            int iter = 0;
+
+            do {
+                oldL = L;
+
+                putp(pb,craftb,t - L);
+                n.setdifference(pa,pb);
+                L = sqrt(n.dotproduct());
+            } while(fabs(L - oldL) > 1e-14 * L && ++iter < 32);
+
+            putv(vb,craftb,t - L);
+            n.setnormalized();
+
+            lt[a][k] = L;
+            dlt[a][k] = (n.dotproduct(va) - n.dotproduct(vb)) / (1.0 - n.dotproduct(vb));
+        }
+    }
+}
+
+void EphemerisLISA::putp(Vector &p,int craft,double t) {
+    assertCraft(craft);
+
+    for(int i=0;i<3;i++) hermite(pos[craft]+i,vel[craft]+i,3,t,p[i],0);
+}
+
+void EphemerisLISA::putv(Vector &v,int craft,double t) {
+    assertCraft(craft);
+
+    double p;
+
+    for(int i=0;i<3;i++) hermite(pos[craft]+i,vel[craft]+i,3,t,p,&v[i]);
+}
+
+double EphemerisLISA::armlength(int arm,double t) {
+    assertArm(arm);
+
+    int a = (arm > 0) ? arm : 3 - arm;
+    double L;
+
+    hermite(lt[a],dlt[a],1,t,L,0);
+
+    return L;
+}
+
+double EphemerisLISA::dotarmlength(int arm,double t) {
+    assertArm(arm);
+
+    int a = (arm > 0) ? arm : 3 - arm;
+    double L, dL;
+
+    hermite(lt[a],dlt[a],1,t,L,&dL);
+
+    return dL;
+}
+
+
 // --- PyLISA ---
 
 void PyLISA::reset() {
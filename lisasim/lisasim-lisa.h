@@ -9,6 +9,7 @@
 
 #include "lisasim-tens.h"
 #include "lisasim-signal.h"
+#include "lisasim-delay.h"
 #include "lisasim-except.h"
 
 #include <iostream>
@@ -118,6 +119,13 @@ class LISA {
 	overridden, returns just "this". */
     virtual LISA *physlisa() { return this; }
 
+    /** Returns a new LISA object (owned by the caller) with the same
+	geometry but its own retardation counters and caches, so that
+	it can be used by another thread at the same time as this one.
+	Unless overridden, returns 0: the class cannot be copied (for
+	instance, because it calls back into Python). */
+    virtual LISA *copy() { return 0; }
+
     /*  Fills n with the photon direction vector along "arm" for
 	reception at time t. */
     virtual void putn(Vector &n, int arm, double t);
@@ -153,6 +161,11 @@ class LISA {
 
     virtual double dotarmlength(int arm, double t);
 
+    /** Returns 1 if the armlengths are constant in time, so that TDI
+	observables are time-invariant filters (used by the block
+	evaluation of TDInoise). Unless overridden, returns 0. */
+    virtual int isstatic() { return 0; }
+
     virtual void newretardtime(double t);
 
     virtual double retardedtime();
@@ -160,6 +173,20 @@ class LISA {
 
     virtual void retard(int ret);
     virtual void retard(LISA *anotherlisa,int ret);
+
+    /** Applies a whole chain of retardations (last arm first) by
+	calling retard(int), so that caching LISAs see every step. */
+    virtual void retard(const DelayChain &chain);
+
+    /** Vectorized putp, putn, putv (three values per time), and
+	armlength, dotarmlength, evaluated at times[i] for i =
+	0..samples-1 (see checkvalues in lisasim-signal.h). */
+    void getp(double *buffer,long length,int craft,double *times,long samples);
+    void getn(double *buffer,long length,int arm,double *times,long samples);
+    void getv(double *buffer,long length,int craft,double *times,long samples);
+
+    void getarmlength(double *buffer,long length,int arm,double *times,long samples);
+    void getdotarmlength(double *buffer,long length,int arm,double *times,long samples);
 };
 
 
@@ -182,12 +209,18 @@ class OriginalLISA : public LISA {
     
     OriginalLISA(double arm1 = Lstd,double arm2 = Lstd,double arm3 = Lstd);
 
+    virtual LISA *copy() { return new OriginalLISA(*this); }
+
     // OriginalLISA defines optimized (look-up) versions of putn and armlength
     
     virtual void putn(Vector &n, int arm, double t);
     virtual void putp(Vector &p, int craft, double t);
 	
     virtual double armlength(int arm, double t);
+
+    // armlengths are constant here and in ModifiedLISA and ZeroLISA
+
+    virtual int isstatic() { return 1; }
 };
 
 
@@ -203,6 +236,8 @@ class ModifiedLISA : public OriginalLISA {
 
     ModifiedLISA(double arm1 = Lstd,double arm2 = Lstd,double arm3 = Lstd);
 
+    LISA *copy() { return new ModifiedLISA(*this); }
+
     // OriginalLISA defines a computed version of armlength
     // however, it uses the base putn
 
@@ -255,6 +290,8 @@ class CircularRotating : public LISA, public ApproxLISA {
     CircularRotating(double eta0 = 0.0,double xi0 = 0.0,double sw = 1.0,double t0 = 0.0);
     CircularRotating(double myL,double e0,double x0,double sw,double t0);
 
+    LISA *copy() { return new CircularRotating(*this); }
+
     // CircularRotating defines a computed (fitted) version of armlength
     // use genarmlength to get the exact armlength,
     // use oldputn to get the nondelayed (rotated-only) n's
@@ -303,6 +340,8 @@ class HaloAnalytic: public LISA {
 
  public:   
     HaloAnalytic(double myL,double t0 = 0.0);
+
+    LISA *copy() { return new HaloAnalytic(*this); }
     
     void putp(Vector &p,int craft,double t);
     
@@ -355,6 +394,8 @@ class EccentricInclined : public LISA, public ApproxLISA {
     EccentricInclined(double eta0 = 0.0,double xi0 = 0.0,double sw = 1.0,double t0 = 0.0);
     EccentricInclined(double myL,double eta0,double xi0,double sw,double t0);
 
+    LISA *copy() { return new EccentricInclined(*this); }
+
     void putp(Vector &p,int craft,double t);
 
     // EccentricInclined defines a computed (leading order) version of armlength
@@ -389,6 +430,74 @@ class SampledLISA : public LISA {
 };
 
 
+// --- EphemerisLISA ---
+
+/** LISA geometry from an orbit ephemeris, read once from an ASCII
+    file (as for getLISApositions: Julian date, then the three SSB
+    positions of each spacecraft in km, optionally followed by the
+    three velocities of each in km/s), or from its binary cache. Times
+    are counted from the first row, and positions are converted to
+    seconds. Missing velocities are derived by fourth-order finite
+    differences. Positions, velocities, light-times and their
+    derivatives are all interpolated by cubic Hermite polynomials
+    between equally spaced nodes (light-times are solved exactly at
+    the nodes), so velocities and armlengths are consistent with
+    positions; outside the ephemeris, the first and last intervals
+    are extrapolated. If cachefile is given, it is used when it is
+    newer than filename and was made from it (the cache records the
+    absolute path and size of its ASCII source), and written otherwise;
+    a cache that cannot be read is ignored. */
+
+class EphemerisLISA : public LISA {
+ private:
+    long nodes;
+    double initjd, deltat;
+    int derived;
+
+    // positions and velocities, by craft (three components per node);
+    // light-times and their derivatives, with {1,2,3,-1,-2,-3} = {1,2,3,4,5,6} indexing
+
+    double *pos[4], *vel[4];
+    double *lt[7], *dlt[7];
+
+    // absolute path and size of the ASCII file read (empty and 0 if none)
+
+    char source[4096];
+    long long sourcesize;
+
+    void allocate();
+    void release();
+
+    void readascii(char *filename);
+    int readbinary(char *filename,char *asciifile = 0);
+    void derivevelocities();
+    void solvelighttimes();
+
+    void hermite(double *f,double *df,int stride,double t,double &val,double *dval);
+
+ public:
+    EphemerisLISA(char *filename,char *cachefile = 0);
+    ~EphemerisLISA();
+
+    /// Writes the ephemeris (positions and velocities) in the binary form read back by the constructor.
+    void writecache(char *filename);
+
+    void putp(Vector &p,int craft,double t);
+    void putv(Vector &v,int craft,double t);
+
+    double armlength(int arm,double t);
+    double dotarmlength(int arm,double t);
+
+    /// Number of nodes and their spacing (s); Julian date of the first node.
+    long getnodes() { return nodes; };
+    double getdeltat() { return deltat; };
+    double getinitjd() { return initjd; };
+
+    /// 1 if the velocities were derived from the positions, 0 if they were read.
+    int getderived() { return derived; };
+};
+
+
 // --- CacheLengthLISA ---
 
 /* Instead of passing LISASource to InterpolatedSignal, It would be
@@ -448,6 +557,8 @@ class ZeroLISA : public OriginalLISA {
     ZeroLISA() {};
     virtual ~ZeroLISA() {};
 
+    LISA *copy() { return new ZeroLISA(*this); }
+
     double armlength(int arm, double t) {return 0.0;};
     double dotarmlength(int arm, double t) {return 0.0;};
 };
@@ -0,0 +1,364 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-narrowband.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <math.h>
+
+NarrowbandObs::NarrowbandObs(Signal **thesignals,int sigs,double st,double *fr,long bs,long dec,
+                             double it,int halfwidth,long ch)
+    : observables(sigs), bands(bs), stime(st), inittime(it), decimate(dec), half(halfwidth * dec), block(0), chunk(ch) {
+
+    if(sigs < 1 || bs < 1 || dec < 1 || halfwidth < 3 || ch < 1 || !(st > 0.0)) {
+        std::cerr << "NarrowbandObs::NarrowbandObs(...): need at least one signal and one band, decimate > 0,"
+                  << " halfwidth > 2, chunk > 0, and stime > 0"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    signals = new Signal*[observables];
+    for(int j=0;j<observables;j++) signals[j] = thesignals[j];
+
+    freqs = new double[bands];
+    for(long b=0;b<bands;b++) freqs[b] = fr[b];
+
+    // Blackman-windowed sinc, with the transition band (about 5.5/L
+    // cycles/sample wide) ending at the output Nyquist frequency
+
+    long length = 2*half + 1;
+    double fc = 0.5 / decimate - 2.75 / length;
+
+    taps = new double[length];
+
+    double norm = 0.0;
+
+    for(long n=0;n<length;n++) {
+        double u = n - half;
+        double sinc = (u == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * u) / (M_PI * u);
+        double w = 0.42 - 0.5 * cos(2.0 * M_PI * n / (length - 1)) + 0.08 * cos(4.0 * M_PI * n / (length - 1));
+
+        taps[n] = w * sinc;
+        norm += taps[n];
+    }
+
+    for(long n=0;n<length;n++) taps[n] /= norm;
+
+    lore = new double[bands];
+    loim = new double[bands];
+    stepre = new double[bands];
+    stepim = new double[bands];
+
+    for(long b=0;b<bands;b++) {
+        stepre[b] = cos(2.0 * M_PI * freqs[b] * stime);
+        stepim[b] = -sin(2.0 * M_PI * freqs[b] * stime);
+    }
+
+    slots = 2*halfwidth + 1;
+
+    accre = new double[slots * observables * bands];
+    accim = new double[slots * observables * bands];
+
+    for(long i=0;i<slots * observables * bands;i++) accre[i] = accim[i] = 0.0;
+
+    mixre = new double[observables * bands];
+    mixim = new double[observables * bands];
+
+    input = new double[chunk * observables];
+    inputfirst = inputcount = 0;
+
+    next = produced = 0;
+
+    try {
+        block = getblockevaluator(signals,observables,stime,inittime);
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+NarrowbandObs::~NarrowbandObs() {
+    release();
+}
+
+void NarrowbandObs::release() {
+    delete block;
+
+    delete [] input;
+
+    delete [] mixim;
+    delete [] mixre;
+
+    delete [] accim;
+    delete [] accre;
+
+    delete [] stepim;
+    delete [] stepre;
+    delete [] loim;
+    delete [] lore;
+
+    delete [] taps;
+    delete [] freqs;
+
+    delete [] signals;
+}
+
+/* evaluate count rows of the signals, from row first at basetime +
+   first*stime (by block if block is not 0), into input */
+
+static void narrowbandfill(TDIblock *block,Signal **signals,int observables,double *input,
+                           long first,long count,double basetime,double stime) {
+    if(block) {
+        block->getobs(input,first,first + count);
+    } else {
+        for(long i=0;i<count;i++) {
+            double t = basetime + stime * (first + i);
+
+            for(int j=0;j<observables;j++)
+                input[i*observables + j] = signals[j]->value(t);
+        }
+    }
+}
+
+// set the oscillators exactly at input row k (phases taken modulo one cycle)
+
+void NarrowbandObs::oscillator(long k) {
+    for(long b=0;b<bands;b++) {
+        double cycles = fmod(freqs[b] * inittime,1.0) + fmod(freqs[b] * stime * (k - half),1.0);
+
+        lore[b] = cos(2.0 * M_PI * cycles);
+        loim[b] = -sin(2.0 * M_PI * cycles);
+    }
+}
+
+/* Input row r (at inittime + (r - half)*stime) falls in the windows of
+   outputs m with m*decimate <= r <= m*decimate + 2*half, with tap
+   r - m*decimate; output m is complete after row m*decimate + 2*half. */
+
+void NarrowbandObs::getbands(double *buffer,long length,long samples) {
+    checkvalues("NarrowbandObs::getbands",length,samples,2 * bands * observables);
+
+    const long n = observables * bands;
+
+    long done = 0;
+
+    while(done < samples) {
+        if(next == inputfirst + inputcount) {
+            inputfirst += inputcount;
+            inputcount = chunk;
+
+            // the rows before inittime are zeros, so the signals are never
+            // read earlier than inittime
+
+            long zeros = inputfirst < half ? (half - inputfirst < chunk ? half - inputfirst : chunk) : 0;
+
+            for(long i=0;i<zeros*observables;i++) input[i] = 0.0;
+
+            if(zeros < chunk)
+                narrowbandfill(block,signals,observables,&input[zeros*observables],inputfirst + zeros - half,chunk - zeros,inittime,stime);
+        }
+
+        const double *x = &input[(next - inputfirst) * observables];
+
+        if(next % narrowbandresync == 0) oscillator(next);
+
+        for(int j=0;j<observables;j++) {
+            double *mr = &mixre[j*bands], *mi = &mixim[j*bands];
+
+            for(long b=0;b<bands;b++) {
+                mr[b] = x[j] * lore[b];
+                mi[b] = x[j] * loim[b];
+            }
+        }
+
+        for(long b=0;b<bands;b++) {
+            double re = lore[b] * stepre[b] - loim[b] * stepim[b];
+
+            loim[b] = lore[b] * stepim[b] + loim[b] * stepre[b];
+            lore[b] = re;
+        }
+
+        long mlo = next >= 2*half ? (next - 2*half + decimate - 1) / decimate : 0;
+        long mhi = next / decimate;
+
+        for(long m=mlo;m<=mhi;m++) {
+            double w = taps[next - m*decimate];
+
+            double *ar = &accre[(m % slots) * n], *ai = &accim[(m % slots) * n];
+
+            for(long i=0;i<n;i++) {
+                ar[i] += w * mixre[i];
+                ai[i] += w * mixim[i];
+            }
+        }
+
+        if(next == produced * decimate + 2*half) {
+            double *ar = &accre[(produced % slots) * n], *ai = &accim[(produced % slots) * n];
+            double *out = &buffer[done * 2 * n];
+
+            for(int j=0;j<observables;j++) {
+                for(long b=0;b<bands;b++) {
+                    out[2*(b*observables + j)]     = 2.0 * ar[j*bands + b];
+                    out[2*(b*observables + j) + 1] = 2.0 * ai[j*bands + b];
+                }
+            }
+
+            for(long i=0;i<n;i++) ar[i] = ai[i] = 0.0;
+
+            produced++;
+            done++;
+        }
+
+        next++;
+    }
+}
+
+// --- LineTracker ---
+
+LineTracker::LineTracker(Signal **thesignals,int sigs,double st,double *fr,long ls,long seg,
+                         double it,int win,long ch)
+    : observables(sigs), lines(ls), stime(st), inittime(it), segment(seg), window(0), block(0), chunk(ch) {
+
+    if(sigs < 1 || ls < 1 || seg < 1 || win < 0 || win > 1 || ch < 1 || !(st > 0.0)) {
+        std::cerr << "LineTracker::LineTracker(...): need at least one signal and one line, segment > 0,"
+                  << " window 0 or 1, chunk > 0, and stime > 0"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    signals = new Signal*[observables];
+    for(int j=0;j<observables;j++) signals[j] = thesignals[j];
+
+    freqs = new double[lines];
+    coeff = new double[lines];
+
+    for(long l=0;l<lines;l++) {
+        freqs[l] = fr[l];
+        coeff[l] = 2.0 * cos(2.0 * M_PI * freqs[l] * stime);
+    }
+
+    if(win) {
+        window = new double[segment];
+        windowsum = 0.0;
+
+        for(long i=0;i<segment;i++) {
+            double sn = sin(M_PI * (i + 0.5) / segment);
+
+            window[i] = sn * sn;
+            windowsum += window[i];
+        }
+    } else {
+        windowsum = segment;
+    }
+
+    s1 = new double[observables * lines];
+    s2 = new double[observables * lines];
+
+    for(long i=0;i<observables * lines;i++) s1[i] = s2[i] = 0.0;
+
+    input = new double[chunk * observables];
+    inputfirst = inputcount = 0;
+
+    next = produced = 0;
+
+    try {
+        block = getblockevaluator(signals,observables,stime,inittime);
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+LineTracker::~LineTracker() {
+    release();
+}
+
+void LineTracker::release() {
+    delete block;
+
+    delete [] input;
+
+    delete [] s2;
+    delete [] s1;
+
+    delete [] window;
+
+    delete [] coeff;
+    delete [] freqs;
+
+    delete [] signals;
+}
+
+/* After the Goertzel recursion s_n = x_n + 2 cos(w) s_(n-1) - s_(n-2)
+   over a segment of N samples, sum_n x_n exp(-i w n) = exp(-i w (N-1))
+   (s_(N-1) - exp(-i w) s_(N-2)); the phase of the segment start is then
+   added exactly (modulo one cycle). */
+
+void LineTracker::getamplitudes(double *buffer,long length,long segments) {
+    checkvalues("LineTracker::getamplitudes",length,segments,2 * lines * observables);
+
+    long done = 0;
+
+    while(done < segments) {
+        if(next == inputfirst + inputcount) {
+            inputfirst += inputcount;
+            inputcount = chunk;
+
+            narrowbandfill(block,signals,observables,input,inputfirst,chunk,inittime,stime);
+        }
+
+        const double *x = &input[(next - inputfirst) * observables];
+        double w = window ? window[next % segment] : 1.0;
+
+        for(int j=0;j<observables;j++) {
+            double xw = w * x[j];
+            double *a = &s1[j*lines], *b = &s2[j*lines];
+
+            for(long l=0;l<lines;l++) {
+                double s = xw + coeff[l] * a[l] - b[l];
+
+                b[l] = a[l];
+                a[l] = s;
+            }
+        }
+
+        next++;
+
+        if(next % segment == 0) {
+            double *out = &buffer[done * 2 * lines * observables];
+            double norm = 2.0 / windowsum;
+
+            for(long l=0;l<lines;l++) {
+                double omega = 2.0 * M_PI * freqs[l] * stime;
+                double cw = cos(omega), sw = sin(omega);
+
+                double cycles = fmod(freqs[l] * inittime,1.0)
+                              + fmod(freqs[l] * stime * (produced * segment),1.0)
+                              + fmod(freqs[l] * stime * (segment - 1),1.0);
+
+                double pr = norm * cos(2.0 * M_PI * cycles), pi = -norm * sin(2.0 * M_PI * cycles);
+
+                for(int j=0;j<observables;j++) {
+                    double a = s1[j*lines + l], b = s2[j*lines + l];
+                    double yr = a - cw * b, yi = sw * b;
+
+                    out[2*(l*observables + j)]     = pr * yr - pi * yi;
+                    out[2*(l*observables + j) + 1] = pr * yi + pi * yr;
+                }
+            }
+
+            for(long i=0;i<observables * lines;i++) s1[i] = s2[i] = 0.0;
+
+            produced++;
+            done++;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_NARROWBAND_H_
+#define _LISASIM_NARROWBAND_H_
+
+#include "lisasim-tdi.h"
+
+/** Narrow-band (complex baseband) output of observables around chosen
+    frequencies. The signals are evaluated at inittime + i*stime (by
+    block, as in fastgetobs, when possible), a chunk at a time; each
+    sample is mixed down with a local oscillator exp(-2 pi i f t) for
+    every band, low-passed, and decimated by decimate, in one streaming
+    pass, so the full-band series is never stored. Output row m is at
+    inittime + m*decimate*stime; within a band, x(t) ~ 2 Re[z(t)
+    exp(2 pi i f t)].
+
+    The low-pass filter is a Blackman-windowed sinc of 2*halfwidth*
+    decimate + 1 taps, centered on the output time (so there is no
+    delay), with its stopband starting at the output Nyquist frequency
+    (so the band is clean within about +-(0.5 - 2.75/(2 halfwidth)) of
+    the output rate around f). The window reaches halfwidth*decimate
+    samples before each output, but the signals are never evaluated
+    before inittime (so noises need only their usual prebuffer): they
+    are taken as zero there, and the first halfwidth output rows are
+    distorted (row 0 sees only half its window). To have full rows
+    from a time T on, start at inittime <= T - halfwidth*decimate*
+    stime. The filter is applied in the scatter form: each input
+    sample is added to the 2*halfwidth + 1 outputs whose windows
+    contain it, so only those accumulators are kept. The oscillators
+    advance by phasor rotation, resynchronized exactly every
+    narrowbandresync samples. The inner loops run over bands. */
+
+const long narrowbandresync = 1024;
+
+class NarrowbandObs {
+ private:
+    Signal **signals;
+    int observables;
+
+    long bands;
+    double *freqs;
+
+    double stime, inittime;
+    long decimate, half;
+
+    TDIblock *block;
+
+    // filter taps, for offsets -half..half from the output sample
+
+    double *taps;
+
+    // oscillator phasors and their steps, per band
+
+    double *lore, *loim, *stepre, *stepim;
+
+    // accumulators for 2*halfwidth + 1 outputs, as
+    // acc[((slot*observables + j)*bands + b)]
+
+    int slots;
+    double *accre, *accim;
+
+    // mixed samples of the current input, per observable and band
+
+    double *mixre, *mixim;
+
+    // the signals, a chunk of rows at a time, from input row 0 at inittime - half*stime
+    // (zeros before inittime)
+
+    long chunk;
+    double *input;
+    long inputfirst, inputcount;
+
+    long next, produced;
+
+    void oscillator(long k);
+    void release();
+
+ public:
+    NarrowbandObs(Signal **thesignals,int signals,double stime,double *freqs,long bands,long decimate,
+                  double inittime = 0.0,int halfwidth = 8,long chunk = 4096);
+    ~NarrowbandObs();
+
+    /** Fill buffer with the next samples output rows, each holding, for
+        every band and then every observable, the real and imaginary
+        parts of the baseband series (samples x bands x observables x 2). */
+    void getbands(double *buffer,long length,long samples);
+
+    int getobservables() { return observables; };
+    long getbandcount() { return bands; };
+
+    /// Sampling time (s) of the output.
+    double getstime() { return decimate * stime; };
+
+    /// Index of the next output row.
+    long getproduced() { return produced; };
+};
+
+
+/** Bank of single-frequency DFTs tracking lines at known frequencies:
+    the signals are evaluated as for NarrowbandObs, and consecutive
+    segments of segment samples are reduced, for every line frequency
+    f and observable, to the complex amplitude
+
+        a = (2 / sum w_n) sum_n w_n x_n exp(-2 pi i f t_n),
+
+    so that a line A cos(2 pi f t + phi) gives a ~ A exp(i phi), with
+    phases referred to t = 0 as for NarrowbandObs. The sums run as
+    Goertzel recursions (one multiply and two adds per sample, line,
+    and observable, with the loops running over lines), and the phase
+    factors are applied once per segment. w is 1 (window = 0) or a Hann
+    window over the segment (window = 1), which lowers the leakage of
+    neighboring lines. */
+
+class LineTracker {
+ private:
+    Signal **signals;
+    int observables;
+
+    long lines;
+    double *freqs, *coeff;
+
+    double stime, inittime;
+    long segment;
+
+    double *window;
+    double windowsum;
+
+    TDIblock *block;
+
+    // Goertzel states of the current segment, as s[j*lines + l]
+
+    double *s1, *s2;
+
+    long chunk;
+    double *input;
+    long inputfirst, inputcount;
+
+    long next, produced;
+
+    void release();
+
+ public:
+    LineTracker(Signal **thesignals,int signals,double stime,double *freqs,long lines,long segment,
+                double inittime = 0.0,int window = 0,long chunk = 4096);
+    ~LineTracker();
+
+    /** Fill buffer with the amplitudes of the next segments segments,
+        each holding, for every line and then every observable, their
+        real and imaginary parts (segments x lines x observables x 2). */
+    void getamplitudes(double *buffer,long length,long segments);
+
+    int getobservables() { return observables; };
+    long getlinecount() { return lines; };
+
+    /// Duration (s) of a segment.
+    double getsegmenttime() { return segment * stime; };
+
+    /// Index of the next segment.
+    long getproduced() { return produced; };
+};
+
+#endif /* _LISASIM_NARROWBAND_H_ */
@@ -0,0 +1,296 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-orbit.h"
+
+#include <iostream>
+
+#include <math.h>
+
+
+// --- planetary perturbers ---
+
+// mass ratio to the Sun, semimajor axis (AU), J2000 mean longitude (deg);
+// the orbits are taken circular and in the ecliptic, which is plenty for
+// the perturbations felt by LISA; Earth (+Moon) sits exactly at Rgc so that
+// it stays at a fixed angle from the LISA guiding center
+
+static const int planetnum = 5;
+
+static const double planetmass[planetnum] = {2.4478383e-6,     // Venus
+                                             3.04043264e-6,    // Earth-Moon
+                                             3.2271514e-7,     // Mars
+                                             9.5479194e-4,     // Jupiter
+                                             2.8588567e-4};    // Saturn
+
+static const double planetaxis[planetnum] = {0.72333199, 1.0, 1.52366231, 5.20336301, 9.53707032};
+
+static const double planetlong[planetnum] = {181.97973, 100.46435, 355.45332, 34.40438, 49.94432};
+
+
+// --- sixth-order Gauss-Legendre coefficients ---
+
+static const double sq15 = sqrt(15.0);
+
+static const double glc[3] = {0.5 - sq15/10.0, 0.5, 0.5 + sq15/10.0};
+
+static const double gla[3][3] = {{5.0/36.0,            2.0/9.0 - sq15/15.0, 5.0/36.0 - sq15/30.0},
+                                 {5.0/36.0 + sq15/24.0, 2.0/9.0,             5.0/36.0 - sq15/24.0},
+                                 {5.0/36.0 + sq15/30.0, 2.0/9.0 + sq15/15.0, 5.0/36.0}};
+
+static const double glb[3] = {5.0/18.0, 4.0/9.0, 5.0/18.0};
+
+
+// --- IntegratedLISA ---
+
+IntegratedLISA::IntegratedLISA(LISA *initlisa,double t0,double t1,double dt,int pl,double lead)
+    : tmin(t0), deltat(dt), coeffs(0), planets(pl), earthlead(lead) {
+
+    if(t1 <= t0 || dt <= 0.0) {
+        std::cerr << "IntegratedLISA::IntegratedLISA(...): invalid time span [" << t0 << "," << t1
+                  << "] or step " << dt << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    segments = (long)ceil((t1 - t0) / deltat);
+    tmax = tmin + segments * deltat;
+
+    coeffs = new double[segments * 3 * 3 * 6];
+
+    // get initial positions and (five-point, centered) velocities from initlisa
+
+    const double h = 100.0;
+
+    double y[4][6];
+    Vector p, pp1, pm1, pp2, pm2, center(0.0);
+
+    for(int craft=1;craft<4;craft++) {
+        initlisa->putp(p,craft,tmin);
+
+        initlisa->putp(pp1,craft,tmin + h);
+        initlisa->putp(pm1,craft,tmin - h);
+        initlisa->putp(pp2,craft,tmin + 2.0*h);
+        initlisa->putp(pm2,craft,tmin - 2.0*h);
+
+        for(int i=0;i<3;i++) {
+            y[craft][i]   = p[i];
+            y[craft][3+i] = (8.0*(pp1[i] - pm1[i]) - (pp2[i] - pm2[i])) / (12.0*h);
+
+            center[i] += p[i] / 3.0;
+        }
+    }
+
+    // place the planets so that Earth leads the guiding center by earthlead
+
+    double earthphase = atan2(center[1],center[0]) + earthlead;
+
+    for(int pn=0;pn<planetnum;pn++)
+        planetphase[pn] = earthphase + (planetlong[pn] - planetlong[1]) * (M_PI/180.0);
+
+    // integrate, storing a quintic Hermite segment for every step
+
+    double a0[3], a1[3];
+
+    for(int craft=1;craft<4;craft++) {
+        acceleration(a0,y[craft],tmin);
+
+        for(long seg=0;seg<segments;seg++) {
+            double t = tmin + seg * deltat;
+
+            double x0[3], v0[3];
+
+            for(int i=0;i<3;i++) {
+                x0[i] = y[craft][i];
+                v0[i] = y[craft][3+i];
+            }
+
+            step(y[craft],t);
+            acceleration(a1,y[craft],t + deltat);
+
+            double *c = &coeffs[((seg*3 + (craft-1))*3)*6];
+
+            for(int i=0;i<3;i++,c+=6) {
+                c[0] = x0[i];
+                c[1] = deltat * v0[i];
+                c[2] = 0.5 * deltat * deltat * a0[i];
+
+                double d = y[craft][i] - (c[0] + c[1] + c[2]);
+                double e = deltat * y[craft][3+i] - (c[1] + 2.0*c[2]);
+                double f = deltat * deltat * a1[i] - 2.0*c[2];
+
+                c[3] =  10.0*d - 4.0*e + 0.5*f;
+                c[4] = -15.0*d + 7.0*e -     f;
+                c[5] =   6.0*d - 3.0*e + 0.5*f;
+
+                a0[i] = a1[i];
+            }
+        }
+    }
+
+    setguessL(tmin);
+}
+
+IntegratedLISA::~IntegratedLISA() {
+    delete [] coeffs;
+}
+
+// heliocentric acceleration: direct solar term, plus direct and
+// indirect (Sun-acceleration) terms for each planet
+
+void IntegratedLISA::acceleration(double *a,double *r,double t) {
+    double r2 = r[0]*r[0] + r[1]*r[1] + r[2]*r[2];
+    double fac = -GMsun / (r2 * sqrt(r2));
+
+    for(int i=0;i<3;i++) a[i] = fac * r[i];
+
+    if(planets) {
+        for(int pl=0;pl<planetnum;pl++) {
+            double ap = planetaxis[pl] * Rgc;
+            double phase = planetphase[pl] + Omega * pow(planetaxis[pl],-1.5) * (t - tmin);
+
+            double rp[3] = {ap * cos(phase), ap * sin(phase), 0.0};
+            double d[3] = {rp[0] - r[0], rp[1] - r[1], rp[2] - r[2]};
+
+            double d2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+
+            double dfac = GMsun * planetmass[pl] / (d2 * sqrt(d2));
+            double pfac = GMsun * planetmass[pl] / (ap * ap * ap);
+
+            for(int i=0;i<3;i++) a[i] += dfac * d[i] - pfac * rp[i];
+        }
+    }
+}
+
+// one Gauss-Legendre step of length deltat for the state y = (r,v);
+// the implicit stage equations are solved by fixed-point iteration,
+// which converges quickly since deltat * Omega << 1
+
+void IntegratedLISA::step(double *y,double t) {
+    double k[3][6], ys[6];
+
+    double acc[3];
+    acceleration(acc,y,t);
+
+    for(int st=0;st<3;st++)
+        for(int i=0;i<3;i++) {
+            k[st][i]   = y[3+i];
+            k[st][3+i] = acc[i];
+        }
+
+    for(int iter=0;iter<50;iter++) {
+        bool converged = true;
+
+        double knew[3][6];
+
+        for(int st=0;st<3;st++) {
+            for(int i=0;i<6;i++)
+                ys[i] = y[i] + deltat * (gla[st][0]*k[0][i] + gla[st][1]*k[1][i] + gla[st][2]*k[2][i]);
+
+            acceleration(acc,ys,t + glc[st]*deltat);
+
+            for(int i=0;i<3;i++) {
+                knew[st][i]   = ys[3+i];
+                knew[st][3+i] = acc[i];
+            }
+        }
+
+        for(int st=0;st<3;st++)
+            for(int i=0;i<6;i++) {
+                if(fabs(knew[st][i] - k[st][i]) > 1.0e-15 * fabs(knew[st][i])) converged = false;
+                k[st][i] = knew[st][i];
+            }
+
+        if(converged) break;
+    }
+
+    for(int i=0;i<6;i++)
+        y[i] += deltat * (glb[0]*k[0][i] + glb[1]*k[1][i] + glb[2]*k[2][i]);
+}
+
+double *IntegratedLISA::segment(int craft,double t,double &s) {
+    assertCraft(craft);
+
+    if(t < tmin || t > tmax) {
+        std::cerr << "IntegratedLISA::segment(...): time " << t << " outside integrated span ["
+                  << tmin << "," << tmax << "] [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionOutOfBounds e;
+        throw e;
+    }
+
+    double x = (t - tmin) / deltat;
+    long seg = (long)floor(x);
+
+    if(seg >= segments) seg = segments - 1;
+
+    s = x - seg;
+
+    return &coeffs[((seg*3 + (craft-1))*3)*6];
+}
+
+void IntegratedLISA::putp(Vector &p,int craft,double t) {
+    double s;
+    double *c = segment(craft,t,s);
+
+    for(int i=0;i<3;i++,c+=6)
+        p[i] = c[0] + s*(c[1] + s*(c[2] + s*(c[3] + s*(c[4] + s*c[5]))));
+}
+
+void IntegratedLISA::putv(Vector &v,int craft,double t) {
+    double s;
+    double *c = segment(craft,t,s);
+
+    for(int i=0;i<3;i++,c+=6)
+        v[i] = (c[1] + s*(2.0*c[2] + s*(3.0*c[3] + s*(4.0*c[4] + s*5.0*c[5])))) / deltat;
+}
+
+// each fixed-point iteration L -> |pa(t) - pb(t - L)| gains a factor
+// |v| ~ 1e-4, so a few iterations from guessL reach double precision
+
+double IntegratedLISA::armlength(int arm,double t) {
+    assertArm(arm);
+
+    Vector pa, pb, n;
+
+    putp(pa,getRecv(arm),t);
+
+    double guess, newguess = guessL[abs(arm)];
+    int iter = 0;
+
+    do {
+        guess = newguess;
+
+        putp(pb,getSend(arm),t - guess);
+
+        n.setdifference(pa,pb);
+        newguess = sqrt(n.dotproduct());
+    } while( fabs(newguess - guess) > 1e-14 && ++iter < 32 );
+
+    return newguess;
+}
+
+// differentiate |pa(t) - pb(t - L(t))| = L(t) using the ephemeris velocities
+
+double IntegratedLISA::dotarmlength(int arm,double t) {
+    double L = armlength(arm,t);
+
+    Vector pa, pb, va, vb, n, dv;
+
+    putp(pa,getRecv(arm),t);
+    putv(va,getRecv(arm),t);
+
+    putp(pb,getSend(arm),t - L);
+    putv(vb,getSend(arm),t - L);
+
+    n.setdifference(pa,pb);
+    n.setproduct(1.0/L);
+
+    dv.setdifference(va,vb);
+
+    return n.dotproduct(dv) / (1.0 - n.dotproduct(vb));
+}
@@ -0,0 +1,74 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_ORBIT_H_
+#define _LISASIM_ORBIT_H_
+
+#include "lisasim-tens.h"
+#include "lisasim-lisa.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+
+#include <math.h>
+
+/** Heliocentric gravitational parameter (s, using light-seconds for
+    distances). We take Kepler's third law with the Omega and Rgc
+    used by the analytic orbits, so that the unperturbed integration
+    reproduces CircularRotating/EccentricInclined; the IAU value
+    GM_sun/c^3 = 4.925490947e-6 s differs by about 0.4% because
+    Omega uses the 365-day year. */
+const double GMsun = Omega * Omega * Rgc * Rgc * Rgc;
+
+/** Numerically integrated LISA orbits. The spacecraft equations of
+    motion (Sun plus, optionally, the planets Venus through Saturn on
+    circular ecliptic orbits) are integrated once, at construction,
+    with a sixth-order Gauss-Legendre (implicit Runge-Kutta)
+    integrator with fixed step deltat. Every step is stored as a
+    quintic Hermite segment (positions, velocities and accelerations
+    at both ends), so that putp, putv and armlength reduce to the
+    evaluation of a few polynomials. The initial positions and
+    velocities are taken from another LISA object at time tmin. */
+
+class IntegratedLISA : public LISA {
+ private:
+    double tmin, tmax, deltat;
+
+    long segments;
+
+    /// Hermite coefficients, as [segment][craft][coordinate][power]
+    double *coeffs;
+
+    int planets;
+    double earthlead;
+
+    // planet longitudes at t = tmin
+    double planetphase[5];
+
+    void acceleration(double *a,double *r,double t);
+    void step(double *y,double t);
+
+    // returns the coefficient base and sets s to the normalized time in the segment
+    double *segment(int craft,double t,double &s);
+
+ public:
+    IntegratedLISA(LISA *initlisa,double tmin,double tmax,double deltat = 86400.0,int planets = 1,double earthlead = M_PI/9.0);
+    ~IntegratedLISA();
+
+    void putp(Vector &p,int craft,double t);
+    void putv(Vector &v,int craft,double t);
+
+    // IntegratedLISA solves the light-propagation equation by
+    // fixed-point iteration on the ephemeris, rather than by bisection
+
+    double armlength(int arm,double t);
+    double dotarmlength(int arm,double t);
+
+    double gettmin() {return tmin;};
+    double gettmax() {return tmax;};
+};
+
+#endif /* _LISASIM_ORBIT_H_ */
@@ -0,0 +1,367 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-parallel.h"
+#include "lisasim-tdisignal.h"
+#include "lisasim-wave.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#ifdef SYNTHLISA_MPI
+#include <mpi.h>
+
+static void mpiexit() {
+    int finalized;
+    MPI_Finalized(&finalized);
+
+    if(!finalized) MPI_Finalize();
+}
+
+// initialize MPI unless someone (e.g., pyMPI) already did; the threads
+// of fastgetobsp take turns at MPI calls, so we ask for serialized threads
+
+static void mpiinit() {
+    int initialized;
+    MPI_Initialized(&initialized);
+
+    if(!initialized) {
+        int provided;
+
+        MPI_Init_thread(0,0,MPI_THREAD_SERIALIZED,&provided);
+        atexit(mpiexit);
+    }
+}
+#endif
+
+int getmpirank() {
+#ifdef SYNTHLISA_MPI
+    mpiinit();
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+
+    return rank;
+#else
+    return 0;
+#endif
+}
+
+int getmpisize() {
+#ifdef SYNTHLISA_MPI
+    mpiinit();
+
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD,&size);
+
+    return size;
+#else
+    return 1;
+#endif
+}
+
+void getcatalogobs(double *buffer,long samples,double stime,LISA *lisa,double *catalog,long first,long last,
+                   const TDIcombination **combs,int observables,double inittime) {
+    int waves = last - first;
+
+    Wave **wavearray = new Wave*[waves];
+    for(int w=0;w<waves;w++) wavearray[w] = 0;
+
+    WaveArray *wa = 0;
+    TDIsignal *tdi = 0;
+
+    // free everything if a source or an evaluation throws
+
+    try {
+        for(int w=0;w<waves;w++) {
+            double *p = &catalog[(first + w) * catalogcolumns];
+
+            wavearray[w] = new GalacticBinary(p[0],p[1],p[2],p[3],p[4],p[5],p[6],p[7]);
+        }
+
+        wa = new WaveArray(wavearray,waves);
+        tdi = new TDIsignal(lisa,wa);
+
+        for(long i=0;i<samples;i++) {
+            double t = inittime + stime * i;
+
+            for(int j=0;j<observables;j++)
+                buffer[i*observables + j] += evaltdicombination(tdi,combs[j],t);
+        }
+    } catch (...) {
+        delete tdi;
+        delete wa;
+
+        for(int w=0;w<waves;w++) delete wavearray[w];
+        delete [] wavearray;
+
+        throw;
+    }
+
+    delete tdi;
+    delete wa;
+
+    for(int w=0;w<waves;w++) delete wavearray[w];
+    delete [] wavearray;
+}
+
+/* The state shared by the threads of a rank: the chunk counter (on
+   rank 0 through win if the window is open, local otherwise), taken
+   under mutex. */
+
+struct CatalogShared {
+    pthread_mutex_t mutex;
+
+    long counter;
+#ifdef SYNTHLISA_MPI
+    int remote;
+    MPI_Win win;
+#endif
+
+    long sources, chunk, samples;
+    double stime, inittime, *catalog;
+
+    const TDIcombination **combs;
+    int observables;
+};
+
+// a thread's LISA object and partial sum; failed records the exception
+// that stopped it (1 for ExceptionWrongArguments, 2 for any other)
+
+struct CatalogJob {
+    CatalogShared *shared;
+
+    LISA *lisa;
+    double *buffer;
+
+    int failed;
+};
+
+static long catalognext(CatalogShared *sh) {
+    long next;
+
+    pthread_mutex_lock(&sh->mutex);
+
+#ifdef SYNTHLISA_MPI
+    if(sh->remote) {
+        long one = 1;
+
+        MPI_Fetch_and_op(&one,&next,MPI_LONG,0,0,MPI_SUM,sh->win);
+        MPI_Win_flush(0,sh->win);
+    } else
+#endif
+        next = sh->counter++;
+
+    pthread_mutex_unlock(&sh->mutex);
+
+    return next;
+}
+
+static void *catalogworker(void *job) {
+    CatalogJob *j = (CatalogJob *)job;
+    CatalogShared *sh = j->shared;
+
+    try {
+        for(;;) {
+            long first = catalognext(sh) * sh->chunk;
+            if(first >= sh->sources) break;
+
+            long last = first + sh->chunk < sh->sources ? first + sh->chunk : sh->sources;
+
+            getcatalogobs(j->buffer,sh->samples,sh->stime,j->lisa,sh->catalog,first,last,sh->combs,sh->observables,sh->inittime);
+        }
+    } catch (ExceptionWrongArguments &e) {
+        j->failed = 1;
+    } catch (...) {
+        j->failed = 2;
+    }
+
+    return 0;
+}
+
+/* Run the chunks on threads threads (the caller included), which stop
+   when the counter passes the last source; the extra threads work on
+   copies of lisa and on their own partial sums, added to buffer at the
+   end. Returns the failure of any thread (see CatalogJob). */
+
+static int catalogthreads(CatalogShared &sh,double *buffer,LISA *lisa,int threads) {
+    long total = sh.samples * sh.observables;
+
+    CatalogJob *jobs = new CatalogJob[threads];
+    pthread_t *thread = new pthread_t[threads];
+    int *started = new int[threads];
+
+    for(int k=0;k<threads;k++) {
+        jobs[k].shared = &sh;
+        jobs[k].failed = 0;
+
+        started[k] = 0;
+
+        if(k == 0) {
+            jobs[k].lisa = lisa;
+            jobs[k].buffer = buffer;
+        } else {
+            jobs[k].lisa = lisa->copy();
+            if(!jobs[k].lisa) continue;
+
+            jobs[k].buffer = new double[total];
+            for(long i=0;i<total;i++) jobs[k].buffer[i] = 0.0;
+
+            started[k] = (pthread_create(&thread[k],0,catalogworker,&jobs[k]) == 0);
+
+            if(!started[k]) {
+                delete [] jobs[k].buffer;
+                delete jobs[k].lisa;
+            }
+        }
+    }
+
+    catalogworker(&jobs[0]);
+
+    int failed = jobs[0].failed;
+
+    for(int k=1;k<threads;k++) {
+        if(started[k]) {
+            pthread_join(thread[k],0);
+
+            for(long i=0;i<total;i++) buffer[i] += jobs[k].buffer[i];
+
+            delete [] jobs[k].buffer;
+            delete jobs[k].lisa;
+
+            if(jobs[k].failed > failed) failed = jobs[k].failed;
+        }
+    }
+
+    delete [] started;
+    delete [] thread;
+    delete [] jobs;
+
+    return failed;
+}
+
+void fastgetobsp(double *buffer,long length,long samples,double stime,LISA *lisa,
+                 double *catalog,long catlength,char *observables,double inittime,long chunk,int threads) {
+
+    // parse the observables
+
+    const TDIcombination *combs[64];
+    int nobs = parsetdicombinations(observables,combs,64);
+
+    if(nobs <= 0 || catlength % catalogcolumns != 0 || length < samples * nobs || chunk < 1 || threads < 1) {
+        std::cerr << "fastgetobsp(...): need (up to 64 known) observables in '" << observables
+                  << "', a catalog with " << catalogcolumns << " columns, a buffer of " << samples << "x" << nobs << " doubles,"
+                  << " and positive chunk and threads [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    long total = samples * nobs;
+
+    for(long i=0;i<total;i++) buffer[i] = 0.0;
+
+    CatalogShared sh;
+
+    pthread_mutex_init(&sh.mutex,0);
+
+    sh.counter = 0;
+
+    sh.sources = catlength / catalogcolumns;
+    sh.chunk = chunk;
+    sh.samples = samples;
+    sh.stime = stime;
+    sh.inittime = inittime;
+    sh.catalog = catalog;
+    sh.combs = combs;
+    sh.observables = nobs;
+
+    int failed;
+
+#ifdef SYNTHLISA_MPI
+    mpiinit();
+
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    MPI_Comm_size(MPI_COMM_WORLD,&size);
+
+    sh.remote = (size > 1);
+
+    if(sh.remote) {
+        // MPI must allow the threads to take turns at the counter
+
+        int provided;
+        MPI_Query_thread(&provided);
+
+        if(provided < MPI_THREAD_SERIALIZED) threads = 1;
+
+        // the shared chunk counter lives on rank 0; every rank (including
+        // 0) fetches-and-increments it with a passive-target atomic
+
+        long *counter = 0;
+
+        if(rank == 0) {
+            MPI_Alloc_mem(sizeof(long),MPI_INFO_NULL,&counter);
+            *counter = 0;
+
+            MPI_Win_create(counter,sizeof(long),sizeof(long),MPI_INFO_NULL,MPI_COMM_WORLD,&sh.win);
+        } else {
+            MPI_Win_create(0,0,sizeof(long),MPI_INFO_NULL,MPI_COMM_WORLD,&sh.win);
+        }
+
+        MPI_Win_lock_all(0,sh.win);
+
+        // failures are caught in the threads, so every rank gets here
+
+        int local = catalogthreads(sh,buffer,lisa,threads);
+
+        MPI_Win_unlock_all(sh.win);
+        MPI_Win_free(&sh.win);
+
+        if(rank == 0) MPI_Free_mem(counter);
+
+        // agree on failures before the reduction, which needs everyone
+
+        MPI_Allreduce(&local,&failed,1,MPI_INT,MPI_MAX,MPI_COMM_WORLD);
+
+        if(!failed) {
+            // reduce in slices, to stay within int counts
+
+            const long slice = 1L << 26;
+
+            for(long i=0;i<total;i+=slice) {
+                int count = (total - i) < slice ? (total - i) : slice;
+
+                if(rank == 0)
+                    MPI_Reduce(MPI_IN_PLACE,buffer + i,count,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+                else
+                    MPI_Reduce(buffer + i,0,count,MPI_DOUBLE,MPI_SUM,0,MPI_COMM_WORLD);
+            }
+        }
+    } else
+#endif
+        failed = catalogthreads(sh,buffer,lisa,threads);
+
+    pthread_mutex_destroy(&sh.mutex);
+
+    if(failed == 1) {
+        std::cerr << "fastgetobsp(...): invalid catalog parameters"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    } else if(failed) {
+        std::cerr << "fastgetobsp(...): the evaluation of a chunk failed"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionUndefined e;
+        throw e;
+    }
+}
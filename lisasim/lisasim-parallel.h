@@ -0,0 +1,52 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_PARALLEL_H_
+#define _LISASIM_PARALLEL_H_
+
+#include "lisasim-tdi.h"
+#include "lisasim-lisa.h"
+
+/* Native parallel getobs for source catalogs. If synthLISA is built
+   with MPI (python setup.py install --with-mpi=<prefix>, which defines
+   SYNTHLISA_MPI), the sources are distributed across all the ranks of
+   MPI_COMM_WORLD; otherwise everything runs in the calling process. */
+
+/// Number of columns per source in a GalacticBinary catalog (f, fdot, beta, lambda, amp, inc, psi, phi0).
+
+const int catalogcolumns = 8;
+
+/// MPI rank and size (0 and 1 without MPI); MPI is initialized if needed.
+
+extern int getmpirank();
+extern int getmpisize();
+
+/// Add the response of catalog rows [first,last) for observables combs to buffer (samples rows of observables).
+
+extern void getcatalogobs(double *buffer,long samples,double stime,LISA *lisa,double *catalog,long first,long last,
+                          const TDIcombination **combs,int observables,double inittime);
+
+/** Sum the TDI responses of all the GalacticBinary sources in catalog
+    (rows of catalogcolumns parameters, in the order of the
+    GalacticBinary constructor) for the comma-separated observables
+    (see findtdicombination), at samples times inittime + i*stime, into
+    buffer (samples rows of observables, as fastgetobs). Sources are
+    handed out in chunks of chunk, from a shared counter, to whichever
+    rank and thread is free (dynamic load balancing); each evaluates a
+    chunk as one WaveArray with TDIsignal. Each rank runs threads
+    threads (the caller included); the extra threads use copies of
+    lisa (see LISA::copy) and partial sums of their own, so a LISA
+    that cannot be copied (e.g., PyLISA) runs one thread per rank, as
+    does an MPI library without MPI_THREAD_SERIALIZED support. The
+    partial sums are reduced in place on rank 0; the buffers on other
+    ranks hold partial sums. If a chunk fails on any rank, all the
+    ranks throw (ExceptionWrongArguments for bad source parameters,
+    ExceptionUndefined otherwise) and nothing is reduced. */
+
+extern void fastgetobsp(double *buffer,long length,long samples,double stime,LISA *lisa,
+                        double *catalog,long catlength,char *observables,double inittime = 0.0,long chunk = 16,int threads = 1);
+
+#endif /* _LISASIM_PARALLEL_H_ */
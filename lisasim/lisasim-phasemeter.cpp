@@ -0,0 +1,302 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-phasemeter.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <string.h>
+#include <math.h>
+
+// (send,link,recv) of the y and z columns {12,21,23,32,31,13}, as for SampledTDI
+
+static const int phasemeterlinks[6][3] = { {1,-3,2}, {2,3,1}, {2,-1,3}, {3,1,2}, {3,-2,1}, {1,2,3} };
+
+Phasemeter::Phasemeter(TDI *c,TDI *n,double st,long cr,int co,long fr,long fl,
+                       double it,double nu,double sdreadout,unsigned long seed)
+    : carrier(c), noise(n), stime(st), inittime(it), nu0(nu),
+      cicratio(cr), firratio(fr), cicorder(co), firlength(fl) {
+
+    double mstime = stime / firratio;
+
+    if(!(stime > 0.0) || cicratio < 1 || cicorder < 1 || firratio < 1 || !(firlength * mstime > 5.5 * stime) || sdreadout < 0.0) {
+        std::cerr << "Phasemeter::Phasemeter(...): need a positive stime, positive ratios and cicorder,"
+                  << " firlength > 5.5 firratio, and a nonnegative sdreadout"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    hstime = mstime / cicratio;
+
+    // the CIC kernel is the cicorder-th power of a boxcar of cicratio
+    // samples, normalized to unit DC gain at each convolution
+
+    ciclength = cicorder * (cicratio - 1) + 1;
+    cic = new double[ciclength];
+
+    double *tmp = new double[ciclength];
+
+    cic[0] = 1.0;
+
+    for(int o=0;o<cicorder;o++) {
+        long len = o * (cicratio - 1) + 1;
+        double run = 0.0;
+
+        for(long j=0;j<len + cicratio - 1;j++) {
+            if(j < len) run += cic[j];
+            if(j >= cicratio) run -= cic[j - cicratio];
+
+            tmp[j] = run / cicratio;
+        }
+
+        for(long j=0;j<len + cicratio - 1;j++) cic[j] = tmp[j];
+    }
+
+    delete [] tmp;
+
+    // the FIR lowpass is designed by integrating the inverse CIC droop
+    // up to the passband edge, so that, after windowing, the transition
+    // band (about 5.5/(firlength mstime) wide) ends at the output Nyquist
+    // frequency
+
+    double fpass = 0.5 / stime - 2.75 / (firlength * mstime);
+    const long steps = 8 * firlength;
+
+    fir = new double[firlength];
+
+    double norm = 0.0;
+
+    for(long l=0;l<firlength;l++) {
+        double u = (l - 0.5 * (firlength - 1)) * mstime;
+        double acc = 0.0;
+
+        for(long k=0;k<steps;k++) {
+            double f = (k + 0.5) * fpass / steps;
+            acc += cos(2.0 * M_PI * f * u) / droop(f);
+        }
+
+        double w = (firlength > 1) ?
+            0.42 - 0.5 * cos(2.0 * M_PI * l / (firlength - 1)) + 0.08 * cos(4.0 * M_PI * l / (firlength - 1)) : 1.0;
+
+        fir[l] = w * acc;
+        norm += fir[l];
+    }
+
+    for(long l=0;l<firlength;l++) fir[l] /= norm;
+
+    // outputs are centered on their time by starting the high-rate grid late
+
+    delay = 0.5 * (ciclength - 1) * hstime + 0.5 * (firlength - 1) * mstime;
+
+    highcapacity = ciclength + 4 * cicratio;
+    high = new double[highcapacity * phasemeterchannels];
+
+    midcapacity = firlength + 4 * firratio;
+    mid = new double[midcapacity * phasemeterchannels];
+
+    node = new double[phasemeterchannels];
+    nextnode = new double[phasemeterchannels];
+    phase = new double[phasemeterchannels];
+
+    // variance of the phase deviates is sdreadout times the Nyquist frequency
+
+    readout = sqrt(0.5 * sdreadout / hstime);
+    deviates = new WhiteNoiseSource(1024,seed);
+
+    try {
+        start();
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+Phasemeter::~Phasemeter() {
+    release();
+}
+
+void Phasemeter::release() {
+    delete deviates;
+
+    delete [] phase;
+    delete [] nextnode;
+    delete [] node;
+
+    delete [] mid;
+    delete [] high;
+
+    delete [] fir;
+    delete [] cic;
+}
+
+// magnitude of the CIC transfer function
+
+double Phasemeter::droop(double f) {
+    double den = cicratio * sin(M_PI * f * hstime);
+
+    if(den == 0.0) return 1.0;
+
+    return pow(fabs(sin(M_PI * f * cicratio * hstime) / den),cicorder);
+}
+
+double Phasemeter::response(double f) {
+    double mstime = stime / firratio;
+    double re = 0.0, im = 0.0;
+
+    for(long l=0;l<firlength;l++) {
+        re += fir[l] * cos(2.0 * M_PI * f * l * mstime);
+        im -= fir[l] * sin(2.0 * M_PI * f * l * mstime);
+    }
+
+    return droop(f) * sqrt(re*re + im*im);
+}
+
+// the models at the high-rate sample j*cicratio, for all channels
+
+void Phasemeter::evalnode(long j,double *values) {
+    double t = inittime + delay + j * cicratio * hstime;
+
+    for(int c=0;c<6;c++) {
+        const int *lnk = phasemeterlinks[c];
+
+        values[c] = 0.0;
+        values[6 + c] = 0.0;
+
+        if(carrier) {
+            values[c] += carrier->y(lnk[0],lnk[1],lnk[2],DelayChain(),t);
+            values[6 + c] += carrier->z(lnk[0],lnk[1],lnk[2],DelayChain(),t);
+        }
+
+        if(noise) {
+            values[c] += nu0 * noise->y(lnk[0],lnk[1],lnk[2],DelayChain(),t);
+            values[6 + c] += nu0 * noise->z(lnk[0],lnk[1],lnk[2],DelayChain(),t);
+        }
+    }
+}
+
+// generate the high-rate samples chunk*cicratio + 1 .. (chunk + 1)*cicratio
+
+void Phasemeter::nextchunk() {
+    const int n = phasemeterchannels;
+
+    if(highnext - highfirst + cicratio > highcapacity) {
+        long keep = highnext - (ciclength - 1);
+        if(keep < highfirst) keep = highfirst;
+
+        memmove(high,&high[(keep - highfirst) * n],(highnext - keep) * n * sizeof(double));
+        highfirst = keep;
+    }
+
+    evalnode(chunk + 1,nextnode);
+
+    double *row = &high[(highnext - highfirst) * n];
+
+    for(long i=1;i<=cicratio;i++,row+=n) {
+        double frac = double(i) / cicratio;
+
+        for(int c=0;c<n;c++) row[c] = node[c] + frac * (nextnode[c] - node[c]);
+
+        if(readout > 0.0) {
+            for(int c=0;c<n;c++) {
+                double p = readout * (*deviates)[deviate++];
+
+                row[c] += (p - phase[c]) / hstime;
+                phase[c] = p;
+            }
+        }
+    }
+
+    highnext += cicratio;
+
+    double *swap = node; node = nextnode; nextnode = swap;
+    chunk++;
+}
+
+// the CIC output at the intermediate sample midnext
+
+void Phasemeter::nextmid() {
+    const int n = phasemeterchannels;
+
+    long last = midnext * cicratio;
+
+    while(highnext <= last) nextchunk();
+
+    if(midnext - midfirst == midcapacity) {
+        long keep = midnext - (firlength - 1);
+
+        memmove(mid,&mid[(keep - midfirst) * n],(midnext - keep) * n * sizeof(double));
+        midfirst = keep;
+    }
+
+    double acc[phasemeterchannels];
+    for(int c=0;c<n;c++) acc[c] = 0.0;
+
+    const double *row = &high[(last - highfirst) * n];
+
+    for(long j=0;j<ciclength;j++,row-=n) {
+        double w = cic[j];
+
+        for(int c=0;c<n;c++) acc[c] += w * row[c];
+    }
+
+    double *out = &mid[(midnext - midfirst) * n];
+    for(int c=0;c<n;c++) out[c] = acc[c];
+
+    midnext++;
+}
+
+/* The first output needs intermediate samples from -(firlength-1),
+   which need high-rate samples from -(firlength-1)*cicratio -
+   (ciclength-1); chunks start after a model node. */
+
+void Phasemeter::start() {
+    sample = 0;
+
+    midfirst = midnext = -(firlength - 1);
+
+    chunk = midfirst - (ciclength + cicratio - 1) / cicratio;
+    highfirst = highnext = chunk * cicratio + 1;
+
+    evalnode(chunk,node);
+
+    deviate = 0;
+
+    for(int c=0;c<phasemeterchannels;c++)
+        phase[c] = (readout > 0.0) ? readout * (*deviates)[deviate++] : 0.0;
+}
+
+void Phasemeter::reset(unsigned long seed) {
+    deviates->reset(seed);
+
+    start();
+}
+
+void Phasemeter::getobs(double *buffer,long length,long samples) {
+    const int n = phasemeterchannels;
+
+    checkvalues("Phasemeter::getobs",length,samples,n);
+
+    for(long i=0;i<samples;i++) {
+        long last = sample * firratio;
+
+        while(midnext <= last) nextmid();
+
+        double *out = &buffer[i*n];
+        for(int c=0;c<n;c++) out[c] = 0.0;
+
+        const double *row = &mid[(last - midfirst) * n];
+
+        for(long l=0;l<firlength;l++,row-=n) {
+            double w = fir[l];
+
+            for(int c=0;c<n;c++) out[c] += w * row[c];
+        }
+
+        sample++;
+    }
+}
@@ -0,0 +1,111 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_PHASEMETER_H_
+#define _LISASIM_PHASEMETER_H_
+
+#include "lisasim-tdi.h"
+#include "lisasim-signal.h"
+
+/// Number of beatnote channels of a Phasemeter: the six y, then the six z.
+
+const int phasemeterchannels = 12;
+
+/** Block-processing phasemeter: simulates the beatnote frequencies that
+    the phasemeters track at a high sampling rate, and decimates them to
+    the science cadence stime through a CIC stage (order cicorder,
+    ratio cicratio) followed by an FIR stage (firlength taps, ratio
+    firratio), so the high rate is 1/(stime/(cicratio firratio)).
+
+    The beatnote of each y and z measurement is the sum of the carrier
+    model (the y and z of carrier, e.g. a TDIcarrier, in Hz, with its
+    Doppler shifts), of the noise model (the y and z of noise, e.g. a
+    TDInoise, in fractional frequency, times the laser frequency nu0),
+    and of a white phase readout noise with one-sided PSD sdreadout
+    (cycles^2/Hz), drawn at the high rate. Either model may be null.
+    The models are evaluated once per CIC output (for all channels at
+    once, so buffered noises are read in time order), and interpolated
+    linearly to the high rate; the readout noise is what makes the high
+    rate matter, since the decimation filters set how much of it is
+    aliased into the science band.
+
+    The CIC stage is applied in its non-recursive form (the cicorder-th
+    power of a cicratio boxcar), and only at the decimated outputs, so
+    there are no integrators to wrap or drift; the FIR stage is a
+    Blackman-windowed lowpass whose stopband starts at the output
+    Nyquist frequency, and which compensates the CIC droop in its
+    passband. Samples are kept with the channels side by side, so the
+    filter loops run over the twelve channels. The group delay of the
+    chain is compensated: row i of the output is the beatnote at
+    inittime + i*stime. */
+
+class Phasemeter {
+ private:
+    TDI *carrier, *noise;
+
+    double stime, inittime, nu0;
+    double hstime, delay;
+
+    long cicratio, firratio;
+    int cicorder;
+
+    // normalized CIC kernel and FIR taps
+
+    long ciclength, firlength;
+    double *cic, *fir;
+
+    // high-rate and intermediate-rate samples from index highfirst and
+    // midfirst, channel-minor (high[(k - highfirst)*phasemeterchannels + c])
+
+    double *high;
+    long highfirst, highnext, highcapacity;
+
+    double *mid;
+    long midfirst, midnext, midcapacity;
+
+    // model values at the ends of the current high-rate chunk
+
+    double *node, *nextnode;
+    long chunk;
+
+    double readout;
+    WhiteNoiseSource *deviates;
+    long deviate;
+    double *phase;
+
+    long sample;
+
+    void evalnode(long j,double *values);
+    void nextchunk();
+    void nextmid();
+
+    double droop(double f);
+
+    void start();
+    void release();
+
+ public:
+    Phasemeter(TDI *carrier,TDI *noise,double stime,long cicratio = 1000,int cicorder = 4,long firratio = 8,long firlength = 256,
+               double inittime = 0.0,double nu0 = 2.82e14,double sdreadout = 0.0,unsigned long seed = 0);
+    ~Phasemeter();
+
+    /// Fill buffer with the next samples rows of beatnote frequencies (Hz): y then z, columns {12,21,23,32,31,13}.
+    void getobs(double *buffer,long length,long samples);
+
+    /// Restart at inittime, with a new readout-noise seed (the models are reread from inittime).
+    void reset(unsigned long seed = 0);
+
+    /// Magnitude of the transfer function of the CIC and FIR stages at frequency f.
+    double response(double f);
+
+    /// Group delay (s) of the CIC and FIR stages, compensated in the output.
+    double getdelay() { return delay; };
+
+    /// High sampling time (s).
+    double gethstime() { return hstime; };
+};
+
+#endif /* _LISASIM_PHASEMETER_H_ */
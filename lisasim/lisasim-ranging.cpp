@@ -0,0 +1,418 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-ranging.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <math.h>
+
+// column of the y/z arrays for (send,recv), in the convention {12,21,23,32,31,13}
+
+static int rangingcolumn(int send,int recv) {
+    if( (send == 1 && recv == 2) || (send == 2 && recv == 3) || (send == 3 && recv == 1) )
+        return 2*(send-1);
+    else
+        return 2*(recv-1)+1;
+}
+
+// index of arm {1,2,3,-1,-2,-3} in the model parameters
+
+static inline int rangingarm(int arm) {
+    return arm > 0 ? arm - 1 : 2 - arm;
+}
+
+/* A TDI that records the y and z terms requested by the observables:
+   with target = -1, it logs them (returning 0); with target = k, it
+   returns 1 for the k-th term only, so the observable returns its
+   coefficient. */
+
+class RangingRecorder : public TDI {
+ public:
+    SignalSource **sources;
+
+    RangingTerm *terms;
+    int count, capacity, target, call;
+
+    RangingRecorder(SignalSource **s)
+        : sources(s), terms(new RangingTerm[64]), count(0), capacity(64), target(-1), call(0) {};
+
+    ~RangingRecorder() { delete [] terms; };
+
+    double record(SignalSource *source,const DelayChain &ret) {
+        if(target == -1) {
+            if(count == capacity) {
+                RangingTerm *more = new RangingTerm[2*capacity];
+                for(int i=0;i<count;i++) more[i] = terms[i];
+
+                delete [] terms;
+                terms = more; capacity *= 2;
+            }
+
+            terms[count].coeff = 0.0;
+            terms[count].source = source;
+            terms[count].chain = ret;
+
+            count++;
+            return 0.0;
+        } else {
+            return (call++ == target) ? 1.0 : 0.0;
+        }
+    }
+
+    using TDI::y;
+    using TDI::z;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t) {
+        return record(sources[rangingcolumn(send,recv)],ret);
+    }
+
+    double z(int send, int link, int recv, const DelayChain &ret, double t) {
+        return record(sources[6 + rangingcolumn(send,recv)],ret);
+    }
+};
+
+TDIranging::TDIranging(double *yarray,long ylength,double *zarray,long zlength,double st,
+                       const char *observablenames,int interplen,double it,double maxarm)
+    : stime(st), inittime(it) {
+
+    const TDIcombination *combs[64];
+
+    observables = parsetdicombinations(observablenames,combs,64);
+
+    if(observables <= 0 || ylength != zlength || ylength % 6 != 0 || interplen < 2) {
+        std::cerr << "TDIranging::TDIranging(...): need y and z arrays of the same size with 6 columns,"
+                  << " known observables ('" << observablenames << "'), and interplen > 1"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    samples = ylength / 6;
+
+    // copy the measurements by column
+
+    for(int c=0;c<6;c++) {
+        data[c] = new double[samples];
+        data[6+c] = new double[samples];
+
+        for(long i=0;i<samples;i++) {
+            data[c][i] = yarray[6*i + c];
+            data[6+c][i] = zarray[6*i + c];
+        }
+    }
+
+    for(int c=0;c<12;c++) sources[c] = new SampledSignalSource(data[c],samples);
+
+    semiwin = interplen;
+    interp = new LagrangeInterpolator(interplen);
+    dinterp = new DotLagrangeInterpolator(interplen);
+
+    // record the terms of each observable
+
+    terms = new int[observables];
+    obsterms = new RangingTerm*[observables];
+
+    int maxchain = 0;
+
+    for(int j=0;j<observables;j++) {
+        RangingRecorder recorder(sources);
+
+        evaltdicombination(&recorder,combs[j],0.0);
+
+        terms[j] = 0;
+        obsterms[j] = new RangingTerm[recorder.count];
+
+        for(int k=0;k<recorder.count;k++) {
+            recorder.target = k;
+            recorder.call = 0;
+
+            double coeff = evaltdicombination(&recorder,combs[j],0.0);
+
+            if(coeff != 0.0) {
+                obsterms[j][terms[j]] = recorder.terms[k];
+                obsterms[j][terms[j]].coeff = coeff;
+
+                if(recorder.terms[k].chain.size() > maxchain) maxchain = recorder.terms[k].chain.size();
+
+                terms[j]++;
+            }
+        }
+    }
+
+    first = long(ceil(maxchain * maxarm / stime)) + semiwin + 1;
+    last = samples - semiwin - 1;
+
+    if(first >= last) {
+        std::cerr << "TDIranging::TDIranging(...): " << samples << " samples are too few for delays up to "
+                  << maxchain * maxarm << " s [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        release();
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+}
+
+TDIranging::~TDIranging() {
+    release();
+}
+
+void TDIranging::release() {
+    for(int j=0;j<observables;j++) delete [] obsterms[j];
+
+    delete [] obsterms;
+    delete [] terms;
+
+    delete dinterp;
+    delete interp;
+
+    for(int c=0;c<12;c++) {
+        delete sources[c];
+        delete [] data[c];
+    }
+}
+
+/* The retarded time of a chain follows LISA::retard: the last arm is
+   applied first, each with the armlength at the current retarded time,
+   t -> t - L0 - dL t; its derivatives by the parameters follow the same
+   recursion. */
+
+void TDIranging::evaluate(long i,const double *params,double *values,double *jacobian) {
+    double dt[rangingparameters];
+
+    for(int j=0;j<observables;j++) {
+        double val = 0.0;
+
+        if(jacobian)
+            for(int m=0;m<rangingparameters;m++) jacobian[j*rangingparameters + m] = 0.0;
+
+        for(int k=0;k<terms[j];k++) {
+            RangingTerm &term = obsterms[j][k];
+
+            double t = inittime + i * stime;
+
+            if(jacobian)
+                for(int m=0;m<rangingparameters;m++) dt[m] = 0.0;
+
+            for(int r=term.chain.size()-1;r>=0;r--) {
+                int a = rangingarm(term.chain[r]);
+
+                double L0 = params[a], dL = params[6+a];
+
+                if(jacobian) {
+                    for(int m=0;m<rangingparameters;m++) dt[m] *= (1.0 - dL);
+
+                    dt[a] -= 1.0;
+                    dt[6+a] -= t;
+                }
+
+                t -= L0 + dL * t;
+            }
+
+            double ireal = (t - inittime) / stime;
+            double iint = floor(ireal);
+
+            long ind = long(iint);
+
+            if(ind - semiwin + 1 < 0 || ind + semiwin >= samples) {
+                std::cerr << "TDIranging::evaluate(...): delay reaches beyond the data at row " << i
+                          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+                ExceptionOutOfBounds e;
+                throw e;
+            }
+
+            val += term.coeff * interp->getvalue(*term.source,ind,ireal - iint);
+
+            if(jacobian) {
+                double dval = term.coeff * dinterp->getvalue(*term.source,ind,ireal - iint) / stime;
+
+                for(int m=0;m<rangingparameters;m++)
+                    jacobian[j*rangingparameters + m] += dval * dt[m];
+            }
+        }
+
+        values[j] = val;
+    }
+}
+
+double TDIranging::residual(double *params,long length) {
+    checkvalues("TDIranging::residual",length,rangingparameters);
+
+    double *values = new double[observables];
+    double acc = 0.0;
+
+    try {
+        for(long i=first;i<last;i++) {
+            evaluate(i,params,values,0);
+
+            for(int j=0;j<observables;j++) acc += values[j] * values[j];
+        }
+    } catch (ExceptionOutOfBounds &e) {
+        delete [] values;
+        throw e;
+    }
+
+    delete [] values;
+
+    return acc / (last - first);
+}
+
+double TDIranging::gradient(double *grad,long glength,double *params,long length) {
+    checkvalues("TDIranging::gradient",glength,rangingparameters);
+    checkvalues("TDIranging::gradient",length,rangingparameters);
+
+    double *values = new double[observables];
+    double *jacobian = new double[observables * rangingparameters];
+
+    double acc = 0.0;
+
+    for(int m=0;m<rangingparameters;m++) grad[m] = 0.0;
+
+    try {
+        for(long i=first;i<last;i++) {
+            evaluate(i,params,values,jacobian);
+
+            for(int j=0;j<observables;j++) {
+                acc += values[j] * values[j];
+
+                for(int m=0;m<rangingparameters;m++)
+                    grad[m] += 2.0 * values[j] * jacobian[j*rangingparameters + m];
+            }
+        }
+    } catch (ExceptionOutOfBounds &e) {
+        delete [] jacobian;
+        delete [] values;
+        throw e;
+    }
+
+    for(int m=0;m<rangingparameters;m++) grad[m] /= (last - first);
+
+    delete [] jacobian;
+    delete [] values;
+
+    return acc / (last - first);
+}
+
+// solve a x = b (n x n, destroyed) by Gaussian elimination with partial pivoting; returns 0 if singular
+
+static int rangingsolve(double *a,double *b,double *x,int n) {
+    for(int c=0;c<n;c++) {
+        int p = c;
+        for(int r=c+1;r<n;r++) if(fabs(a[r*n+c]) > fabs(a[p*n+c])) p = r;
+
+        if(a[p*n+c] == 0.0) return 0;
+
+        if(p != c) {
+            for(int k=0;k<n;k++) { double tmp = a[c*n+k]; a[c*n+k] = a[p*n+k]; a[p*n+k] = tmp; }
+            double tmp = b[c]; b[c] = b[p]; b[p] = tmp;
+        }
+
+        for(int r=c+1;r<n;r++) {
+            double f = a[r*n+c] / a[c*n+c];
+
+            for(int k=c;k<n;k++) a[r*n+k] -= f * a[c*n+k];
+            b[r] -= f * b[c];
+        }
+    }
+
+    for(int r=n-1;r>=0;r--) {
+        double acc = b[r];
+        for(int k=r+1;k<n;k++) acc -= a[r*n+k] * x[k];
+
+        x[r] = acc / a[r*n+r];
+    }
+
+    return 1;
+}
+
+/* Gauss-Newton: the observables are linearized in the parameters, and
+   the normal equations (J^T J) dp = -J^T v are solved at each step,
+   with a slight Levenberg damping; steps that do not lower the
+   residual are halved. */
+
+double TDIranging::fit(double *params,long length,int iterations,int fitrates,double tolerance) {
+    checkvalues("TDIranging::fit",length,rangingparameters);
+
+    const int n = fitrates ? rangingparameters : 6;
+
+    double *values = new double[observables];
+    double *jacobian = new double[observables * rangingparameters];
+
+    double normal[rangingparameters*rangingparameters], rhs[rangingparameters], step[rangingparameters];
+    double trial[rangingparameters];
+
+    double current = 0.0;
+
+    try {
+        for(int it=0;it<iterations;it++) {
+            for(int m=0;m<n*n;m++) normal[m] = 0.0;
+            for(int m=0;m<n;m++) rhs[m] = 0.0;
+
+            current = 0.0;
+
+            for(long i=first;i<last;i++) {
+                evaluate(i,params,values,jacobian);
+
+                for(int j=0;j<observables;j++) {
+                    double *jrow = &jacobian[j*rangingparameters];
+
+                    current += values[j] * values[j];
+
+                    for(int m=0;m<n;m++) {
+                        rhs[m] -= jrow[m] * values[j];
+
+                        for(int l=0;l<n;l++) normal[m*n+l] += jrow[m] * jrow[l];
+                    }
+                }
+            }
+
+            current /= (last - first);
+
+            for(int m=0;m<n;m++) normal[m*n+m] *= (1.0 + 1e-12);
+
+            if(!rangingsolve(normal,rhs,step,n)) break;
+
+            // halve the step until the residual decreases
+
+            double next = current;
+            double scale = 1.0;
+
+            for(int h=0;h<16;h++) {
+                for(int m=0;m<rangingparameters;m++) trial[m] = params[m];
+                for(int m=0;m<n;m++) trial[m] += scale * step[m];
+
+                next = residual(trial,rangingparameters);
+
+                if(next < current) break;
+
+                scale *= 0.5;
+            }
+
+            if(next >= current) break;
+
+            for(int m=0;m<rangingparameters;m++) params[m] = trial[m];
+
+            if(current - next < tolerance * current) {
+                current = next;
+                break;
+            }
+
+            current = next;
+        }
+    } catch (ExceptionOutOfBounds &e) {
+        delete [] jacobian;
+        delete [] values;
+        throw e;
+    }
+
+    delete [] jacobian;
+    delete [] values;
+
+    return current;
+}
@@ -0,0 +1,89 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_RANGING_H_
+#define _LISASIM_RANGING_H_
+
+#include "lisasim-tdi.h"
+#include "lisasim-signal.h"
+
+/// Number of parameters of the TDIranging armlength model.
+
+const int rangingparameters = 12;
+
+/* One y or z measurement in a TDI observable, with its coefficient
+   and delay chain (recorded from the TDI methods). */
+
+struct RangingTerm {
+    double coeff;
+    SignalSource *source;
+
+    DelayChain chain;
+};
+
+/** TDI-ranging engine: estimates armlengths by minimizing the residual
+    (laser) noise in TDI observables. The y and z measurements are
+    given once, as sampled arrays (columns {12,21,23,32,31,13}, as for
+    SampledTDI, one row per sample at inittime + i*stime), and the TDI
+    observables (the second-generation X1,X2,X3 by default; any of
+    findtdicombination) are
+    recorded once as lists of delayed measurements, so a candidate
+    armlength model changes only the delays. The model has
+    rangingparameters parameters: the armlengths L(t) = L0 + dL t of
+    arms 1,2,3,-1,-2,-3 (s) at t = 0, followed by their rates dL.
+
+    residual returns the mean over samples of the summed squares of
+    the observables; gradient returns it together with its derivatives
+    by the parameters, computed exactly (through the delays) with a
+    derivative Lagrange interpolator. fit refines a model by
+    Gauss-Newton iterations. Samples whose delays could reach back
+    before the data (for armlengths up to maxarm) are not used; delays
+    beyond the data throw ExceptionOutOfBounds. */
+
+class TDIranging {
+ private:
+    long samples;
+    double stime, inittime;
+
+    double *data[12];
+    SignalSource *sources[12];
+
+    Interpolator *interp, *dinterp;
+    int semiwin;
+
+    int observables;
+    int *terms;
+    RangingTerm **obsterms;
+
+    long first, last;
+
+    // evaluate the observables at row i: values, and derivatives
+    // (observables x rangingparameters) if jacobian != 0
+
+    void evaluate(long i,const double *params,double *values,double *jacobian);
+
+    void release();
+
+ public:
+    TDIranging(double *yarray,long ylength,double *zarray,long zlength,double stime,
+               const char *observables = "X1,X2,X3",int interplen = 4,double inittime = 0.0,double maxarm = 20.0);
+    ~TDIranging();
+
+    double residual(double *params,long length);
+    double gradient(double *grad,long glength,double *params,long length);
+
+    /** Refines params in place with up to iterations Gauss-Newton steps
+        (stopping when the relative change of the residual is below
+        tolerance); with fitrates = 0, the rates are kept fixed. Returns
+        the final residual. */
+    double fit(double *params,long length,int iterations = 10,int fitrates = 1,double tolerance = 1e-10);
+
+    /// First and last+1 rows used in the residual.
+    long getfirst() { return first; };
+    long getlast() { return last; };
+};
+
+#endif /* _LISASIM_RANGING_H_ */
@@ -8,7 +8,7 @@
 
 CacheLISA::CacheLISA(LISA *l) : basiclisa(l) {
    for(unsigned int i=0;i<buflength;i++) {
-       keys[i] = 0;
+       keys[i] = 0; depths[i] = 0;
        its[i] = 0.0; rtis[i] = 0.0; trbs[i] = 0.0; tras[i] = 0.0;
 
        pts[i] = 0.0; pis[i] = 0;
@@ -20,7 +20,7 @@ CacheLISA::CacheLISA(LISA *l) : basiclisa(l) {
 
 void CacheLISA::reset() {
    for(unsigned int i=0;i<buflength;i++) {
-       keys[i] = 0;
+       keys[i] = 0; depths[i] = 0;
        its[i] = 0.0; rtis[i] = 0.0; trbs[i] = 0.0; tras[i] = 0.0;
    }
 
@@ -32,8 +32,8 @@ void CacheLISA::reset() {
 void CacheLISA::newretardtime(double t) {
    it = t; rt = t;
    trb = 0.0; tra = 0.0;
-   rts = 0; hash = 0;
-   lastarm = 0;
+   rts = delaykeyinit; hash = 0;
+   depth = 0;
 }
 
 double CacheLISA::retardedtime() {
@@ -47,33 +47,13 @@ double CacheLISA::retardation() {
 void CacheLISA::retard(int ret) {
     if(ret == 0) return;
 
-    // Update the retardation key and the hash.
-    if(rts == 0) {
-        rts = ret > 0 ? ret : (4 | -ret);
+    // Update the retardation key and the cache slot.
+    rts = delaykey(rts,ret);
+    depth++;
 
-        // use a "guard bit" at the left side of the hash
-        hash = 8 | rts;
-    } else {
-        rts = (rts << 3) | (ret > 0 ? ret : (4 | -ret));
-    
-        hash = hash << 1;
-        if(ret > 0) hash = hash | 1;
-    }
-
-    // printf("ret %d, looking for hash %d... ",ret,hash);
-
-    lastarm = ret;
-
-    // We cannot handle such as a large hash. Should throw exception.
-    if(hash >= buflength) {
-        std::cerr << "CacheLISA::retard: Hash " << hash << " out of range"
-                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
-
-		ExceptionOutOfBounds e;
-       	throw e;
-    }
+    hash = (unsigned long)(rts ^ (rts >> 32)) & (buflength - 1);
 
-    if(its[hash] == it && keys[hash] == rts) {
+    if(its[hash] == it && keys[hash] == rts && depths[hash] == depth) {
         // Got it!
 
         // printf("...found!\n");
@@ -98,6 +78,7 @@ void CacheLISA::retard(int ret) {
 
         its[hash] = it;
         keys[hash] = rts;
+        depths[hash] = depth;
 
         rtis[hash] = rt;
         trbs[hash] = trb; tras[hash] = tra;
@@ -15,8 +15,9 @@
 
 // ??? Might be good to move all these function definitions in a cpp file
 
-/** Length of the cache buffer. It should be at least 2^(3 + maximum
-    number of retardations). */
+/** Length of the cache buffer. The cache is direct-mapped on the
+    low bits of the retardation key, so this must be a power of
+    two; it no longer limits the number of retardations. */
 
 static const unsigned long buflength = 2048;
 
@@ -41,28 +42,23 @@ class CacheLISA : public LISA {
     /// Cumulative additional accurate retardation.
     double tra; 
 
-    /** Retardation key and hashed retardation key. The key is coded
-	by expressing each retarding arm as a 3-bit signed integer,
-	and shifting to the right as retarding arms are added. The
-	hashed key is coded by doing the first retarding arm as for
-	the key, but then coding each additional retarding arm as 1 if
-	it is equal (in absolute value) to the preceding retarding
-	arm, and 0 otherwise; therefore the hashed key is shifted to
-	the right only by 1 before adding each new retarding arm. This
-	hashed coding should be unique for causal retardations
-	(corresponding to geometric paths), where it is essentially
-	equivalent to a cw-ccw coding. */
+    /** Retardation key, cache slot, and number of retardations so
+	far. The key is built with delaykey() (see lisasim-delay.h) by
+	folding in each retarding arm as it is applied, so it has no
+	length limit and it agrees with DelayChain::hash(). The slot
+	is given by the low bits of the key; the full key and the
+	depth are stored to recognize genuine hits. */
 
-    unsigned long rts, hash;
-
-    /// Keeps track of the last retardation (needed to form hash).
-    int lastarm;
+    unsigned long long rts;
+    unsigned long hash;
+    int depth;
 
     /// Basic LISA object.
     LISA *basiclisa;
 
-    /// Cache keys.
-    unsigned long keys[buflength];
+    /// Cache keys and depths.
+    unsigned long long keys[buflength];
+    int depths[buflength];
 
     /// Caches for it, rt, trb, and tra.
     double its[buflength], rtis[buflength], trbs[buflength], tras[buflength];
@@ -92,6 +88,8 @@ class CacheLISA : public LISA {
 
     void putn(Vector &n, int arm, double t) { basiclisa->putn(n,arm,t); };
 
+    int isstatic() { return basiclisa->isstatic(); };
+
     void putp(Vector &p, int craft, double t);
     void putp(LISA *anotherlisa,Vector &p, int craft, double t);
 
@@ -114,6 +112,9 @@ class CacheLISA : public LISA {
 	retard call */
 
     void retard(LISA *anotherlisa,int ret);
+
+    /// Computes a chain of retardations, caching every step.
+    void retard(const DelayChain &chain) { LISA::retard(chain); };
 };
 
 #endif /* _LISASIM_RETARD_H_ */
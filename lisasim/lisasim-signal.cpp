@@ -28,6 +28,111 @@ void RingBuffer::reset() {
 	for(int i=0;i<length;i++) data[i] = 0.0;
 }
 
+void RingBuffer::writestate(FILE *file) {
+	statewrite(file,&length,sizeof(long));
+	statewrite(file,data,length*sizeof(double));
+}
+
+void RingBuffer::readstate(FILE *file) {
+	statecheck(file,length,"RingBuffer length");
+	stateread(file,data,length*sizeof(double));
+}
+
+
+// --- continuation state helpers ---
+
+void statewrite(FILE *file,const void *data,size_t size) {
+	if(fwrite(data,1,size,file) != size) {
+		std::cerr << "statewrite(...): cannot write continuation state"
+		          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionFileError e;
+		throw e;
+	}
+}
+
+void stateread(FILE *file,void *data,size_t size) {
+	if(fread(data,1,size,file) != size) {
+		std::cerr << "stateread(...): continuation state is truncated"
+		          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionFileError e;
+		throw e;
+	}
+}
+
+void statecheck(FILE *file,long value,const char *what) {
+	long stored;
+	stateread(file,&stored,sizeof(long));
+
+	if(stored != value) {
+		std::cerr << "statecheck(...): continuation state has " << what << " " << stored
+		          << " instead of " << value << " (objects built differently?)"
+		          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionFileError e;
+		throw e;
+	}
+}
+
+
+// --- vectorized evaluation ---
+
+void checkvalues(const char *method,long length,long samples,int components) {
+	if(length != components * samples) {
+		std::cerr << method << "(...): need " << components << " x " << samples
+		          << " values in the buffer, but it holds " << length
+		          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionWrongArguments e;
+		throw e;
+	}
+}
+
+void complexfft(double *z,long n,int sign) {
+    for(long i=1,j=0;i<n;i++) {
+        long bit = n >> 1;
+
+        for(;j & bit;bit >>= 1) j ^= bit;
+        j ^= bit;
+
+        if(i < j) {
+            double tr = z[2*i], ti = z[2*i+1];
+            z[2*i] = z[2*j]; z[2*i+1] = z[2*j+1];
+            z[2*j] = tr; z[2*j+1] = ti;
+        }
+    }
+
+    for(long len=2;len<=n;len <<= 1) {
+        double ang = sign * 2.0 * M_PI / len;
+        double wr = cos(ang), wi = sin(ang);
+
+        for(long i=0;i<n;i+=len) {
+            double cr = 1.0, ci = 0.0;
+
+            for(long j=0;j<len/2;j++) {
+                double *a = &z[2*(i+j)], *b = &z[2*(i+j+len/2)];
+
+                double br = b[0]*cr - b[1]*ci, bi = b[0]*ci + b[1]*cr;
+
+                b[0] = a[0] - br; b[1] = a[1] - bi;
+                a[0] += br;       a[1] += bi;
+
+                double nr = cr*wr - ci*wi;
+                ci = cr*wi + ci*wr;
+                cr = nr;
+            }
+        }
+    }
+}
+
+void Signal::getvalues(double *buffer,long length,double *times,long samples) {
+	checkvalues("Signal::getvalues",length,samples);
+
+	for(long i=0;i<samples;i++)
+		buffer[i] = value(times[i]);
+}
+
 
 // --- BufferedSignalSource ---
 
@@ -60,6 +165,16 @@ double BufferedSignalSource::operator[](long pos) {
 	}
 }
 
+void BufferedSignalSource::writestate(FILE *file) {
+	buffer.writestate(file);
+	statewrite(file,&current,sizeof(long));
+}
+
+void BufferedSignalSource::readstate(FILE *file) {
+	buffer.readstate(file);
+	stateread(file,&current,sizeof(long));
+}
+
 
 // --- WhiteNoiseSource ---
 
@@ -117,6 +232,31 @@ void WhiteNoiseSource::reset(unsigned long seed) {
 	BufferedSignalSource::reset(seed);
 }
 
+// the generator state is saved as raw bytes, so it is only portable
+// across machines with the same word size and endianness
+
+void WhiteNoiseSource::writestate(FILE *file) {
+	BufferedSignalSource::writestate(file);
+
+	long size = gsl_rng_size(randgen);
+
+	statewrite(file,&size,sizeof(long));
+	statewrite(file,gsl_rng_state(randgen),size);
+
+	statewrite(file,&cacheset,sizeof(int));
+	statewrite(file,&cacherand,sizeof(double));
+}
+
+void WhiteNoiseSource::readstate(FILE *file) {
+	BufferedSignalSource::readstate(file);
+
+	statecheck(file,gsl_rng_size(randgen),"random-generator state size");
+	stateread(file,gsl_rng_state(randgen),gsl_rng_size(randgen));
+
+	stateread(file,&cacheset,sizeof(int));
+	stateread(file,&cacherand,sizeof(double));
+}
+
 /* Box-Muller transform to get Gaussian deviate from uniform random,
    number, adapted from GSL 1.4 randist/gauss.c
 
@@ -147,6 +287,78 @@ double WhiteNoiseSource::getvalue(long pos) {
 }
 
 
+// --- BlockColoredNoise ---
+
+BlockColoredNoise::BlockColoredNoise(long blocklength)
+    : window(0), ready(0), tail(0), readypos(0), observables(0), half(blocklength / 2), work(0), block(0) {}
+
+BlockColoredNoise::~BlockColoredNoise() {
+    delete [] tail;
+    delete [] ready;
+    delete [] work;
+    delete [] window;
+}
+
+void BlockColoredNoise::allocateblocks() {
+    const long N = 2*half;
+
+    window = new double[N];
+    for(long i=0;i<N;i++) window[i] = sin(M_PI * (i + 0.5) / N);
+
+    work = new double[observables * 2 * N];
+
+    ready = new double[half * observables];
+    tail = new double[half * observables];
+}
+
+// block 0 provides only the tail of the first output
+
+void BlockColoredNoise::startblocks() {
+    for(long i=0;i<half*observables;i++) tail[i] = 0.0;
+
+    block = 0;
+    nextblock();
+
+    readypos = half;
+}
+
+// color the next block of 2 half samples, and overlap it with the last
+
+void BlockColoredNoise::nextblock() {
+    const int n = observables;
+    const long N = 2*half;
+
+    for(long i=0;i<n*2*N;i++) work[i] = 0.0;
+
+    color();
+
+    for(int j=0;j<n;j++) {
+        double *z = &work[j*2*N];
+
+        for(long k=1;k<half;k++) {
+            z[2*(N-k)]     =  z[2*k];
+            z[2*(N-k) + 1] = -z[2*k + 1];
+        }
+
+        complexfft(z,N,1);
+
+        for(long i=0;i<half;i++) {
+            ready[i*n + j] = tail[i*n + j] + window[i] * z[2*i];
+            tail[i*n + j] = window[half + i] * z[2*(half + i)];
+        }
+    }
+
+    block++;
+    readypos = 0;
+}
+
+const double *BlockColoredNoise::nextrow() {
+    if(readypos == half) nextblock();
+
+    return &ready[(readypos++) * observables];
+}
+
+
 // --- ResampledSignalSource ---
 
 // the idea is to take a Signal (continuous) and to use it to feed a
@@ -163,6 +375,18 @@ void ResampledSignalSource::reset(unsigned long seed) {
 	BufferedSignalSource::reset(seed);
 }
 
+void ResampledSignalSource::writestate(FILE *file) {
+	signal->writestate(file);
+
+	BufferedSignalSource::writestate(file);
+}
+
+void ResampledSignalSource::readstate(FILE *file) {
+	signal->readstate(file);
+
+	BufferedSignalSource::readstate(file);
+}
+
 
 // --- FileSignalSource ---
 
@@ -266,6 +490,23 @@ void FileSignalSource::reset(unsigned long seed ) {
     loadbuffer();
 }
 
+// the file itself is not saved, only where we were reading it
+
+void FileSignalSource::writestate(FILE *statefile) {
+    BufferedSignalSource::writestate(statefile);
+
+    statewrite(statefile,&initpos,sizeof(long));
+}
+
+void FileSignalSource::readstate(FILE *statefile) {
+    BufferedSignalSource::readstate(statefile);
+
+    stateread(statefile,&initpos,sizeof(long));
+
+    fseek(file,initpos * sizeof(double),SEEK_SET);
+    loadbuffer();
+}
+
 
 // --- SampledSignalSource ---
 
@@ -407,6 +648,18 @@ double SignalFilter::getvalue(long pos) {
 	return filter->getvalue(*source,*this,pos);
 }
 
+void SignalFilter::writestate(FILE *file) {
+	source->writestate(file);
+
+	BufferedSignalSource::writestate(file);
+}
+
+void SignalFilter::readstate(FILE *file) {
+	source->readstate(file);
+
+	BufferedSignalSource::readstate(file);
+}
+
 // --- Interpolators ---
 
 double NearestInterpolator::getvalue(SignalSource &y,long ind,double dind) {
@@ -658,7 +911,8 @@ Interpolator *getDerivativeInterpolator(int interplen) {
 InterpolatedSignal::InterpolatedSignal(SignalSource *src,Interpolator *inte,
 									   double deltat,double prebuffer,double norm)
 	: source(src), interp(inte),
-	  samplingtime(deltat), prebuffertime(prebuffer), normalize(norm) {}
+	  samplingtime(deltat), prebuffertime(prebuffer), normalize(norm),
+	  exact(inte->exactonnodes()) {}
 
 void InterpolatedSignal::reset(unsigned long seed) {
 	source->reset(seed);
@@ -674,6 +928,9 @@ double InterpolatedSignal::value(double time) {
 		iint  = floor(ireal);
 		ifrac = ireal - iint;
 
+		if(ifrac == 0.0 && exact)
+			return normalize * (*source)[long(iint)];
+
 		return normalize * interp->getvalue(*source,long(iint),ifrac);
 	} catch (ExceptionOutOfBounds &e) {
 		std::cerr << "InterpolateSignal::value(double) : OutOfBounds while accessing "
@@ -708,11 +965,17 @@ double InterpolatedSignal::value(double timebase,double timecorr) {
 
 		ifrac = ifracb + ifracc;
 
+		long ind = long(iintb+iintc);
+
 		if (ifrac >= 1.0) {
-			return normalize * interp->getvalue(*source,long(iintb+iintc)+1,ifrac-1.0);
-		} else {
-			return normalize * interp->getvalue(*source,long(iintb+iintc),ifrac);
+			ind++;
+			ifrac -= 1.0;
 		}
+
+		if (ifrac == 0.0 && exact)
+			return normalize * (*source)[ind];
+
+		return normalize * interp->getvalue(*source,ind,ifrac);
 	} catch (ExceptionOutOfBounds &e) {
 		std::cerr << "InterpolateSignal::value(double,double): OutOfBounds while accessing "
 		          << "(" << timebase << "," << timecorr << ")"
@@ -724,6 +987,69 @@ double InterpolatedSignal::value(double timebase,double timecorr) {
 
 void InterpolatedSignal::setinterp(Interpolator *inte) {
 	interp = inte;
+	exact = inte->exactonnodes();
+}
+
+// a SignalSource that records the range of positions read, and returns
+// one at position target and zero elsewhere; used to extract the
+// (linear) weights of any Interpolator
+
+class ProbeSignalSource : public SignalSource {
+ public:
+	long target, minpos, maxpos;
+
+	ProbeSignalSource(long pos) : target(pos), minpos(pos), maxpos(pos) {};
+
+	double operator[](long pos) {
+		if(pos < minpos) minpos = pos;
+		if(pos > maxpos) maxpos = pos;
+
+		return (pos == target) ? 1.0 : 0.0;
+	};
+};
+
+int InterpolatedSignal::getweights(double time,long &first,double *weights,int maxweights) {
+	double ireal, iint, ifrac;
+
+	ireal = (time + prebuffertime) / samplingtime;
+	iint  = floor(ireal);
+	ifrac = ireal - iint;
+
+	// first pass to find the window
+
+	long ind = long(iint);
+
+	// on the grid, a single weight (an integer delay)
+
+	if(ifrac == 0.0 && exact) {
+		first = ind;
+		weights[0] = normalize;
+
+		return 1;
+	}
+
+	ProbeSignalSource probe(ind);
+	interp->getvalue(probe,ind,ifrac);
+
+	int count = probe.maxpos - probe.minpos + 1;
+
+	if(count > maxweights) {
+		std::cerr << "InterpolatedSignal::getweights(...): interpolation window " << count
+		          << " exceeds " << maxweights << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionOutOfBounds e;
+		throw e;
+	}
+
+	first = probe.minpos;
+
+	for(int i=0;i<count;i++) {
+		probe.target = first + i;
+
+		weights[i] = normalize * interp->getvalue(probe,ind,ifrac);
+	}
+
+	return count;
 }
 
 
@@ -747,6 +1073,11 @@ PowerLawNoise::PowerLawNoise(double deltat,double prebuffer,
 	} else if (exponent == -2.00) {
 		filter = new IntFilter();
         normalize = sqrt(psd) * sqrt(nyquistf) * (2.00 * M_PI * deltat);
+	} else if (exponent == -4.00) {
+		// as in the Python PowerLawNoise factory
+		double a[3] = {1.0, 2.0, 1.0}, b[3] = {0.0, 0.9999*2.0, -0.9999};
+		filter = new IIRFilter(a,3,b,3);
+		normalize = sqrt(psd) * sqrt(nyquistf) * (M_PI * deltat) * (M_PI * deltat);
 	} else {
 		std::cerr << "PowerLawNoise::PowerLawNoise(...): undefined PowerLaw exponent "
 		          << exponent << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
@@ -782,6 +1113,112 @@ void PowerLawNoise::reset(unsigned long seed) {
 	interpolatednoise->reset(seed);
 }
 
+// one-sided PSD of the PowerLawNoise samples (filter and normalization as above)
+
+static double powerlawpsd(double f,double deltat,double psd,double exponent) {
+	double th = 2.0 * M_PI * f * deltat;
+
+	if (exponent == 0.00) {
+		return psd;
+	} else if (exponent == 2.00) {
+		double s = sin(0.5 * th) / (M_PI * deltat);
+
+		return psd * s * s;
+	} else if (exponent == -2.00) {
+		double re = 1.0 - 0.9999 * cos(th), im = 0.9999 * sin(th);
+		double n = 2.00 * M_PI * deltat;
+
+		return psd * n * n / (re*re + im*im);
+	} else if (exponent == -4.00) {
+		double re = 1.0 - 0.9999*2.0 * cos(th) + 0.9999 * cos(2.0*th);
+		double im = 0.9999*2.0 * sin(th) - 0.9999 * sin(2.0*th);
+		double n = (M_PI * deltat) * (M_PI * deltat);
+		double a = 4.0 * cos(0.5 * th) * cos(0.5 * th);		// |1 + e^{-i th}|^2
+
+		return psd * n * n * a * a / (re*re + im*im);
+	} else {
+		std::cerr << "interpolationerror(...): undefined PowerLaw exponent "
+		          << exponent << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		ExceptionUndefined e;
+		throw e;
+	}
+}
+
+double interpolationerror(double deltat,double psd,double exponent,int interplen) {
+	const int offsets = 16, freqs = 512, maxweights = 64;
+
+	powerlawpsd(0.0,deltat,psd,exponent);	// check the exponent first
+
+	Interpolator *interp;
+
+	try {
+		interp = getInterpolator(interplen);
+	} catch (ExceptionUndefined &e) {
+		std::cerr << "interpolationerror(...): undefined interpolator length "
+		          << interplen << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+		throw e;
+	}
+
+	double nyquistf = 0.5 / deltat, df = nyquistf / freqs;
+
+	double *spectrum = new double[freqs];
+	for(int j=0;j<freqs;j++)
+		spectrum[j] = powerlawpsd((j + 0.5) * df,deltat,psd,exponent);
+
+	double weights[maxweights];
+	double var = 0.0;
+
+	for(int i=0;i<offsets;i++) {
+		double x = (i + 0.5) / offsets;
+
+		// the interpolation weights, as in InterpolatedSignal::getweights
+
+		long ind = maxweights;
+
+		ProbeSignalSource probe(ind);
+		interp->getvalue(probe,ind,x);
+
+		int count = probe.maxpos - probe.minpos + 1;
+		if(count > maxweights) count = maxweights;
+
+		for(int k=0;k<count;k++) {
+			probe.target = probe.minpos + k;
+			weights[k] = interp->getvalue(probe,ind,x);
+		}
+
+		// |sum_k w_k exp(2 pi i f (k - x) deltat) - 1|^2 S(f), integrated over f
+
+		for(int j=0;j<freqs;j++) {
+			double th = 2.0 * M_PI * (j + 0.5) * df * deltat;
+			double re = -1.0, im = 0.0;
+
+			for(int k=0;k<count;k++) {
+				double ph = th * (probe.minpos + k - ind - x);
+
+				re += weights[k] * cos(ph);
+				im += weights[k] * sin(ph);
+			}
+
+			var += (re*re + im*im) * spectrum[j] * df;
+		}
+	}
+
+	delete [] spectrum;
+	delete interp;
+
+	return sqrt(var / offsets);
+}
+
+int interpolationlength(double deltat,double psd,double exponent,double tolerance,int maxlen) {
+	for(int interplen=1;interplen<=maxlen;interplen++)
+		if(interpolationerror(deltat,psd,exponent,interplen) <= tolerance)
+			return interplen;
+
+	return -1;
+}
+
 
 // SampledSignal
 
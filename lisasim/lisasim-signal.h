@@ -12,6 +12,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/* Continuation state: writestate(file) and readstate(file) save and
+   restore what a source or signal needs to carry on from where it
+   stopped (random-generator state, filter histories, sample buffers),
+   so that a run can be extended, even in a new process with objects
+   built with the same parameters, exactly as if it had not stopped.
+   Stateless objects need not redefine them. The helpers below throw
+   ExceptionFileError on short reads or writes, and statecheck also if
+   the value read differs from the one given. */
+
+extern void statewrite(FILE *file,const void *data,size_t size);
+extern void stateread(FILE *file,void *data,size_t size);
+extern void statecheck(FILE *file,long value,const char *what);
+
+/* Vectorized evaluation: the get... methods of Signal, Wave, and LISA
+   that take a times array fill buffer with the values at times[i],
+   looping in C++ (they back the numpy-aware Python methods).
+   checkvalues throws ExceptionWrongArguments unless buffer holds
+   components values per time. */
+
+extern void checkvalues(const char *method,long length,long samples,int components = 1);
+
+/* In-place radix-2 FFT of n (a power of two) complex numbers stored as
+   re,im pairs; computes sum_j z_j exp(sign 2 pi i j k / n), unnormalized. */
+
+extern void complexfft(double *z,long n,int sign);
+
 class RingBuffer {
  private:
     double *data;
@@ -22,6 +48,9 @@ class RingBuffer {
 	~RingBuffer();
 	
 	void reset();
+
+	void writestate(FILE *file);
+	void readstate(FILE *file);
 	
 	inline double& operator[](long pos);
 };
@@ -43,6 +72,9 @@ class SignalSource {
 
 	virtual void reset(unsigned long seed = 0) {};
 	virtual double operator[](long pos) = 0;
+
+	virtual void writestate(FILE *file) {};
+	virtual void readstate(FILE *file) {};
 };
 
 
@@ -64,6 +96,9 @@ class BufferedSignalSource : public SignalSource {
 
 	virtual void reset(unsigned long seed = 0); // ??? redefining default
 	virtual double operator[](long pos);
+
+	virtual void writestate(FILE *file);
+	virtual void readstate(FILE *file);
 };
 
 
@@ -94,11 +129,57 @@ class WhiteNoiseSource : public BufferedSignalSource {
 		
 	void reset(unsigned long seed = 0);  // ??? redefining default
 
+	void writestate(FILE *file);
+	void readstate(FILE *file);
+
     static void setglobalseed(unsigned long seed = 0);
     static unsigned long getglobalseed();
 };
 
 
+/** Base of the noise streams colored in the frequency domain by
+    blocks (SpectralTDInoise, GalacticConfusion). For each block of
+    2*half samples, color() fills the positive-frequency bins 1..half-1
+    of every stream j in work (2*half complex numbers at work[4*half*j],
+    zeroed beforehand); the negative frequencies are mirrored, the
+    block is transformed, and consecutive blocks overlap by half, with
+    sine windows whose squares add to one, so the streams are
+    continuous. Derived classes set observables, call allocateblocks()
+    once, startblocks() to (re)start the streams, and read the rows
+    with nextrow(). */
+
+class BlockColoredNoise {
+ private:
+    double *window;
+    double *ready, *tail;
+    long readypos;
+
+    void nextblock();
+
+ protected:
+    int observables;
+    long half;
+
+    double *work;
+    long block;
+
+    BlockColoredNoise(long blocklength);
+
+    void allocateblocks();
+    void startblocks();
+
+    /// The next row of observables values.
+    const double *nextrow();
+
+    virtual void color() = 0;
+
+ public:
+    virtual ~BlockColoredNoise();
+
+    int getobservables() { return observables; };
+};
+
+
 class SampledSignalSource : public SignalSource {
  private:
 	double *data;
@@ -132,6 +213,9 @@ class FileSignalSource : public BufferedSignalSource {
 	double getvalue(long pos);
 	
 	void reset(unsigned long seed = 0);  // ??? redefining default
+
+	void writestate(FILE *file);
+	void readstate(FILE *file);
 };
 
 
@@ -144,6 +228,9 @@ class Filter {
     virtual ~Filter() {};
  
     virtual double getvalue(SignalSource &x,SignalSource &y,long pos) = 0;
+
+    /// How far back (in samples of x or y) getvalue reaches.
+    virtual long getorder() { return 0; };
 };
 
 
@@ -161,12 +248,14 @@ class IntFilter : public Filter {
     IntFilter(double a = 0.9999);
 
     double getvalue(SignalSource &x,SignalSource &y,long pos);
+    long getorder() { return 1; };
 };
 
 
 class DiffFilter : public Filter {
  public:
     double getvalue(SignalSource &x,SignalSource &y,long pos);
+    long getorder() { return 1; };
 };
 
 
@@ -178,6 +267,7 @@ class BandIntFilter : public Filter {
     BandIntFilter(double deltat,double flow,double fhi);
 
     double getvalue(SignalSource &x,SignalSource &y,long pos);
+    long getorder() { return 1; };
 };
 
 
@@ -191,6 +281,7 @@ class FIRFilter : public Filter {
  	~FIRFilter();
 
     double getvalue(SignalSource &x,SignalSource &y,long pos);
+    long getorder() { return length - 1; };
 };
 
 
@@ -204,6 +295,7 @@ class IIRFilter : public Filter {
  	~IIRFilter();
  
     double getvalue(SignalSource &x,SignalSource &y,long pos);
+    long getorder() { return (lengtha > lengthb ? lengtha : lengthb) - 1; };
 };
 
 
@@ -218,12 +310,17 @@ class SignalFilter : public BufferedSignalSource {
 	double getvalue(long pos);
 	
 	void reset(unsigned long seed = 0);  // ??? redefining default
+
+	void writestate(FILE *file);
+	void readstate(FILE *file);
 };
 
 
 /* Interface for Signal: value(time) and value(timebase,timecorr). Also
    reset(). */
 
+class InterpolatedSignal;
+
 class Signal {
  public:
 	virtual ~Signal() {};
@@ -244,6 +341,20 @@ class Signal {
 	
     virtual double noise(double time) { return value(time); };    
 	virtual double noise(double timebase,double timecorr) { return value(timebase,timecorr); }
+
+	// if the signal is interpolated from sampled data, return the
+	// InterpolatedSignal that does it (used for block evaluation)
+
+	virtual InterpolatedSignal *getinterpolated() { return 0; };
+
+	// continuation state (see RingBuffer above)
+
+	virtual void writestate(FILE *file) {};
+	virtual void readstate(FILE *file) {};
+
+	// value(times[i]) for i = 0..samples-1 (see checkvalues above)
+
+	void getvalues(double *buffer,long length,double *times,long samples);
 };
 
 
@@ -259,18 +370,27 @@ class Interpolator {
 	virtual ~Interpolator() {};
 
     virtual double getvalue(SignalSource &y,long ind,double dind) = 0;
+
+	// nonzero if getvalue(y,ind,0.0) is exactly y[ind], so that reads
+	// on the sampling grid may skip the interpolation window
+
+	virtual int exactonnodes() { return 0; };
 };
 
 
 class NearestInterpolator : public Interpolator {
  public:
 	double getvalue(SignalSource &y,long ind,double dind);
+
+	int exactonnodes() { return 1; };
 };
 
 
 class LinearInterpolator : public Interpolator {
  public:
 	double getvalue(SignalSource &y,long ind,double dind);
+
+	int exactonnodes() { return 1; };
 };
 
 
@@ -294,6 +414,9 @@ class LagrangeInterpolator : public Interpolator {
     virtual ~LagrangeInterpolator();
 
     double getvalue(SignalSource &y,long ind,double dind);
+
+    // at a node, all the Neville corrections along the path are zero
+    int exactonnodes() { return 1; };
 };
 
 class DotLagrangeInterpolator : public Interpolator {
@@ -369,6 +492,16 @@ class SumSignal : public Signal {
         return signal1->value(timebase,timecorr) +
                signal2->value(timebase,timecorr);
     };
+
+    void writestate(FILE *file) {
+        signal1->writestate(file);
+        signal2->writestate(file);
+    };
+
+    void readstate(FILE *file) {
+        signal1->readstate(file);
+        signal2->readstate(file);
+    };
 };
 
 
@@ -378,6 +511,11 @@ class InterpolatedSignal : public Signal {
 	Interpolator *interp;
 	
 	double samplingtime, prebuffertime, normalize;
+
+	// set if interp->exactonnodes(); then reads on the sampling grid
+	// (e.g., with armlengths that are multiples of samplingtime) are
+	// direct lookups, with the same result
+	int exact;
 	
  public:
 	InterpolatedSignal(SignalSource *src,Interpolator *inte,
@@ -390,6 +528,19 @@ class InterpolatedSignal : public Signal {
 	double value(double timebase,double timecorr);
 	
 	void setinterp(Interpolator *inte);
+
+	InterpolatedSignal *getinterpolated() { return this; };
+
+	void writestate(FILE *file) { source->writestate(file); };
+	void readstate(FILE *file) { source->readstate(file); };
+
+	SignalSource *getsource() { return source; };
+	double getsamplingtime() { return samplingtime; };
+
+	/* write value(time) as the sum of weights[i] * source[first + i],
+	   i = 0..n-1, and return n (at most maxweights) */
+
+	int getweights(double time,long &first,double *weights,int maxweights);
 };
 
 
@@ -421,6 +572,11 @@ class PowerLawNoise : public Signal {
 
 	double value(double time);
 	double value(double timebase,double timecorr);
+
+	InterpolatedSignal *getinterpolated() { return interpolatednoise; };
+
+	void writestate(FILE *file) { interpolatednoise->writestate(file); };
+	void readstate(FILE *file) { interpolatednoise->readstate(file); };
 };
 
 inline double PowerLawNoise::value(double time) {
@@ -431,6 +587,16 @@ inline double PowerLawNoise::value(double timebase,double timecorr) {
 	return interpolatednoise->value(timebase,timecorr);
 }
 
+/* Predicted RMS error of reading PowerLawNoise(deltat,...,psd,exponent,interplen)
+   between samples: the exact PSD of the filtered samples is integrated
+   against the error response of the interpolator up to Nyquist, and
+   averaged over the fractional offset. interpolationlength returns the
+   cheapest interpolator length (1 for linear, then Lagrange semiwindows
+   2..maxlen) whose error is within tolerance, or -1 if none is. */
+
+extern double interpolationerror(double deltat,double psd,double exponent,int interplen);
+extern int interpolationlength(double deltat,double psd,double exponent,double tolerance,int maxlen = 16);
+
 
 // --- SampledSignal ---
 
@@ -452,6 +618,11 @@ class SampledSignal : public Signal {
 
 	double value(double time);
 	double value(double timebase,double timecorr);
+
+	InterpolatedSignal *getinterpolated() { return interpolatednoise; };
+
+	void writestate(FILE *file) { interpolatednoise->writestate(file); };
+	void readstate(FILE *file) { interpolatednoise->readstate(file); };
 };
 
 inline double SampledSignal::value(double time) {
@@ -478,6 +649,9 @@ class ResampledSignalSource : public BufferedSignalSource {
 	void reset(unsigned long seed = 0);  // ??? redefining default
 
 	double getvalue(long pos);
+
+	void writestate(FILE *file);
+	void readstate(FILE *file);
 };
 
 class CachedSignal : public Signal {
@@ -494,6 +668,11 @@ class CachedSignal : public Signal {
 
 	double value(double time);
 	double value(double timebase,double timecorr);
+
+	InterpolatedSignal *getinterpolated() { return interpsignal; };
+
+	void writestate(FILE *file) { interpsignal->writestate(file); };
+	void readstate(FILE *file) { interpsignal->readstate(file); };
 };
 
 inline double CachedSignal::value(double time) {
@@ -0,0 +1,374 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-spectrum.h"
+#include "lisasim-stream.h"
+#include "lisasim-signal.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+
+/* An observable file, read by rows: rows of records doubles, back to
+   back or in StreamServer frames of framerows rows (each after a
+   header of headerbytes). Row 0 of a framed file is the first sample
+   of its first frame, and the frame holding rows k*framerows onward
+   is frame[k] in the file (-1 if it was not captured). */
+
+struct SpectrumInput {
+    FILE *file;
+
+    int records;
+    long rows;
+
+    long framerows;
+    off_t framebytes, headerbytes;
+
+    long *frame;
+};
+
+static void spectrumseek(FILE *file,off_t offset,int whence = SEEK_SET) {
+    if(fseeko(file,offset,whence)) {
+        std::cerr << "outofcorefft(...): cannot seek in file"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+}
+
+static void spectrumclose(SpectrumInput &in) {
+    fclose(in.file);
+    delete [] in.frame;
+}
+
+/* Place the frames of a StreamServer file by the firstsample of their
+   headers, which need not be consecutive (frames dropped by
+   maxlatency, or a capture started mid-stream). */
+
+static void spectrumframes(SpectrumInput &in,char *infile,off_t size) {
+    long frames = size / in.framebytes;
+
+    long long *firstsample = new long long[frames];
+
+    for(long k=0;k<frames;k++) {
+        StreamHeader header;
+
+        spectrumseek(in.file,(off_t)k * in.framebytes);
+        stateread(in.file,&header,sizeof(StreamHeader));
+
+        if(memcmp(header.magic,"SLTD",4) || header.observables != in.records || header.samples != in.framerows
+           || (k > 0 && (header.firstsample <= firstsample[k-1] || (header.firstsample - firstsample[0]) % in.framerows != 0))) {
+            std::cerr << "outofcorefft(...): frame " << k << " of " << infile << " does not follow the previous ones"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            delete [] firstsample;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        firstsample[k] = header.firstsample;
+    }
+
+    long slots = frames ? (firstsample[frames-1] - firstsample[0]) / in.framerows + 1 : 0;
+
+    in.frame = new long[slots > 0 ? slots : 1];
+    for(long j=0;j<slots;j++) in.frame[j] = -1;
+
+    for(long k=0;k<frames;k++) in.frame[(firstsample[k] - firstsample[0]) / in.framerows] = k;
+
+    in.rows = slots * in.framerows;
+
+    delete [] firstsample;
+}
+
+static void spectrumopen(SpectrumInput &in,char *infile,int records) {
+    in.frame = 0;
+    in.file = fopen(infile,"rb");
+
+    if(!in.file) {
+        std::cerr << "outofcorefft(...): cannot open " << infile
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    spectrumseek(in.file,0,SEEK_END);
+    off_t size = ftello(in.file);
+    spectrumseek(in.file,0);
+
+    StreamHeader header;
+
+    if(size >= (off_t)sizeof(StreamHeader) && fread(&header,sizeof(StreamHeader),1,in.file) == 1
+       && !memcmp(header.magic,"SLTD",4)) {
+        if(header.observables < 1 || header.samples < 1 || (records != 0 && records != header.observables)) {
+            std::cerr << "outofcorefft(...): " << infile << " has frames of " << header.observables
+                      << " observables, not " << records << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            fclose(in.file);
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+
+        in.records = header.observables;
+        in.framerows = header.samples;
+        in.headerbytes = sizeof(StreamHeader);
+        in.framebytes = in.headerbytes + (off_t)in.framerows * in.records * sizeof(double);
+
+        try {
+            spectrumframes(in,infile,size);
+        } catch (...) {
+            spectrumclose(in);
+            throw;
+        }
+    } else {
+        if(records < 1) {
+            std::cerr << "outofcorefft(...): need the number of records of " << infile
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            fclose(in.file);
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+
+        in.records = records;
+        in.framerows = 0;
+        in.headerbytes = in.framebytes = 0;
+
+        in.rows = size / ((off_t)records * sizeof(double));
+    }
+}
+
+// read rows first..first+count-1 into buffer, with zeros from row length
+// on and for the frames that are missing
+
+static void spectrumread(SpectrumInput &in,long first,long count,long length,double *buffer) {
+    long avail = first < length ? (first + count <= length ? count : length - first) : 0;
+
+    for(long done=0;done<avail;) {
+        long row = first + done, run = avail - done;
+        off_t offset;
+
+        if(in.framerows) {
+            long inframe = row % in.framerows;
+            if(run > in.framerows - inframe) run = in.framerows - inframe;
+
+            long k = in.frame[row / in.framerows];
+
+            if(k < 0) {
+                for(long i=done*in.records;i<(done + run)*in.records;i++) buffer[i] = 0.0;
+
+                done += run;
+                continue;
+            }
+
+            offset = (off_t)k * in.framebytes + in.headerbytes + (off_t)inframe * in.records * sizeof(double);
+        } else {
+            offset = (off_t)row * in.records * sizeof(double);
+        }
+
+        spectrumseek(in.file,offset);
+        stateread(in.file,&buffer[done * in.records],run * in.records * sizeof(double));
+
+        done += run;
+    }
+
+    for(long i=avail*in.records;i<count*in.records;i++) buffer[i] = 0.0;
+}
+
+/* With n = N2 n1 + n2 and k = k1 + N1 k2, X_k = sum_n2 exp(-2 pi i n2 k1 / N)
+   exp(-2 pi i n2 k2 / N2) sum_n1 x_n exp(-2 pi i n1 k1 / N1). The scratch
+   file holds the inner sums, twiddled, as [k1][n2][record] complex. */
+
+long outofcorefft(char *infile,long length,int records,char *outfile,double stime,long memory,char *tmpfile) {
+    if(!(stime > 0.0) || memory < 1 || length < 0) {
+        std::cerr << "outofcorefft(...): need stime > 0, memory > 0, and length >= 0"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    SpectrumInput in;
+    spectrumopen(in,infile,records);
+
+    if(length == 0) length = in.rows;
+
+    if(length < 1 || length > in.rows) {
+        std::cerr << "outofcorefft(...): " << infile << " has " << in.rows << " rows, not " << length
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        spectrumclose(in);
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    const int R = in.records;
+
+    long N = 2;
+    int bits = 1;
+    while(N < length) { N <<= 1; bits++; }
+
+    const long N1 = 1L << (bits / 2), N2 = N / N1;
+    const long half = N / 2;
+
+    // blocks of columns; the work and staging buffers take memory bytes together
+
+    long B1 = memory / (2 * 16 * (long)R * N1);
+    if(B1 < 1) B1 = 1;
+    if(B1 > N2) B1 = N2;
+
+    long B2 = memory / (2 * 16 * (long)R * N2);
+    if(B2 < 1) B2 = 1;
+    if(B2 > N1) B2 = N1;
+
+    long worksize = 2 * R * (B1 * N1 > B2 * N2 ? B1 * N1 : B2 * N2);
+    long outwidth = 1 + 2*R;
+
+    double *work = new double[worksize];
+    double *stage = new double[worksize > B2 * outwidth ? worksize : B2 * outwidth];
+
+    char *scratchname = tmpfile;
+    if(!scratchname) {
+        scratchname = new char[strlen(outfile) + 5];
+        strcpy(scratchname,outfile);
+        strcat(scratchname,".tmp");
+    }
+
+    FILE *tmp = fopen(scratchname,"w+b");
+    FILE *out = tmp ? fopen(outfile,"wb") : 0;
+
+    try {
+        if(!tmp || !out) {
+            std::cerr << "outofcorefft(...): cannot open " << (tmp ? outfile : scratchname) << " for writing"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        // pass 1: FFTs of length N1 on the columns n2 = c..c+b-1, twiddled
+
+        for(long c=0;c<N2;c+=B1) {
+            long b = (N2 - c < B1) ? N2 - c : B1;
+
+            for(long n1=0;n1<N1;n1++) {
+                spectrumread(in,n1 * N2 + c,b,length,stage);
+
+                for(long i=0;i<b;i++) {
+                    for(int r=0;r<R;r++) {
+                        double *z = &work[2*((i*R + r)*N1 + n1)];
+
+                        z[0] = stage[i*R + r];
+                        z[1] = 0.0;
+                    }
+                }
+            }
+
+            for(long col=0;col<b*R;col++) complexfft(&work[2*col*N1],N1,-1);
+
+            for(long i=0;i<b;i++) {
+                long n2 = c + i;
+
+                for(long k1=1;k1<N1;k1++) {
+                    double ang = -2.0 * M_PI * double(n2 * k1) / N;
+                    double wr = cos(ang), wi = sin(ang);
+
+                    for(int r=0;r<R;r++) {
+                        double *z = &work[2*((i*R + r)*N1 + k1)];
+                        double zr = z[0]*wr - z[1]*wi;
+
+                        z[1] = z[0]*wi + z[1]*wr;
+                        z[0] = zr;
+                    }
+                }
+            }
+
+            for(long k1=0;k1<N1;k1++) {
+                for(long i=0;i<b;i++) {
+                    for(int r=0;r<R;r++) {
+                        stage[2*(i*R + r)]     = work[2*((i*R + r)*N1 + k1)];
+                        stage[2*(i*R + r) + 1] = work[2*((i*R + r)*N1 + k1) + 1];
+                    }
+                }
+
+                spectrumseek(tmp,(off_t)(k1 * N2 + c) * R * 16);
+                statewrite(tmp,stage,b * R * 16);
+            }
+        }
+
+        // pass 2: FFTs of length N2 on the rows k1 = c..c+b-1, written out
+        // at k = k1 + N1 k2 for k <= N/2
+
+        for(long c=0;c<N1;c+=B2) {
+            long b = (N1 - c < B2) ? N1 - c : B2;
+
+            spectrumseek(tmp,(off_t)c * N2 * R * 16);
+            stateread(tmp,stage,b * N2 * R * 16);
+
+            for(long i=0;i<b;i++) {
+                for(long n2=0;n2<N2;n2++) {
+                    for(int r=0;r<R;r++) {
+                        work[2*((i*R + r)*N2 + n2)]     = stage[2*((i*N2 + n2)*R + r)];
+                        work[2*((i*R + r)*N2 + n2) + 1] = stage[2*((i*N2 + n2)*R + r) + 1];
+                    }
+                }
+            }
+
+            for(long col=0;col<b*R;col++) complexfft(&work[2*col*N2],N2,-1);
+
+            for(long k2=0;k2<N2;k2++) {
+                long kfirst = N1 * k2 + c;
+                if(kfirst > half) break;
+
+                long count = (half - kfirst + 1 < b) ? half - kfirst + 1 : b;
+
+                for(long i=0;i<count;i++) {
+                    double *row = &stage[i * outwidth];
+
+                    row[0] = (kfirst + i) / (N * stime);
+
+                    for(int r=0;r<R;r++) {
+                        row[1 + 2*r] = stime * work[2*((i*R + r)*N2 + k2)];
+                        row[2 + 2*r] = stime * work[2*((i*R + r)*N2 + k2) + 1];
+                    }
+                }
+
+                spectrumseek(out,(off_t)kfirst * outwidth * sizeof(double));
+                statewrite(out,stage,count * outwidth * sizeof(double));
+            }
+        }
+    } catch (...) {
+        if(out) fclose(out);
+        if(tmp) { fclose(tmp); remove(scratchname); }
+        spectrumclose(in);
+
+        if(scratchname != tmpfile) delete [] scratchname;
+        delete [] stage;
+        delete [] work;
+
+        throw;
+    }
+
+    fclose(out);
+    fclose(tmp);
+    remove(scratchname);
+    spectrumclose(in);
+
+    if(scratchname != tmpfile) delete [] scratchname;
+    delete [] stage;
+    delete [] work;
+
+    return N;
+}
@@ -0,0 +1,34 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_SPECTRUM_H_
+#define _LISASIM_SPECTRUM_H_
+
+/* outofcorefft computes the full-resolution Fourier transform of the
+   observables in infile without holding them in memory. infile holds
+   rows of records doubles in native byte order, either back to back (as
+   written by lisaXML for a TimeSeries, or by writebinary, possibly in
+   appended chunks), or in StreamServer frames (recognized by their
+   "SLTD" magic; records may then be 0, or must match the frames).
+   Frames are placed by the firstsample of their headers, counted from
+   the first frame in the file; frames missing in between (dropped by
+   StreamServer under maxlatency) are read as zeros, and files whose
+   frames are out of order or misaligned throw ExceptionFileError. The
+   first length rows (all of them if length = 0) are zero-padded to N,
+   the next power of two, and transformed by the four-step algorithm:
+   N = N1*N2, FFTs of length N1 on strided columns, twiddle factors,
+   and FFTs of length N2, with the intermediate result transposed
+   through the scratch file tmpfile (outfile.tmp if 0). Both passes
+   work on blocks of columns that fit in memory bytes, so the files are
+   read and written in contiguous runs.
+
+   outfile receives rows k = 0..N/2 in the lisaXML FrequencySeries
+   layout: the frequency k/(N stime), then the real and imaginary parts
+   of stime * sum_n x_n exp(-2 pi i k n / N) for each record. Returns N. */
+
+extern long outofcorefft(char *infile,long length,int records,char *outfile,double stime,long memory = 268435456,char *tmpfile = 0);
+
+#endif /* _LISASIM_SPECTRUM_H_ */
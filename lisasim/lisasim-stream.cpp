@@ -0,0 +1,471 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-stream.h"
+#include "lisasim-except.h"
+
+#include <Python.h>
+
+#include <iostream>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static double monotime() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+
+    return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+// we wait in short slices, so that KeyboardInterrupt gets through
+
+static const double waitslice = 0.05;
+
+static void checkinterrupt() {
+    if(PyErr_CheckSignals() != 0) {
+        ExceptionKeyboardInterrupt e;
+        throw e;
+    }
+}
+
+static void sleepuntil(double t) {
+    double dt;
+
+    while((dt = t - monotime()) > 0.0) {
+        if(dt > waitslice) dt = waitslice;
+
+        struct timespec ts;
+        ts.tv_sec = long(dt);
+        ts.tv_nsec = long((dt - ts.tv_sec) * 1.0e9);
+
+        nanosleep(&ts,0);
+
+        checkinterrupt();
+    }
+}
+
+StreamServer::StreamServer(Signal **thesignals,int sigs,double st,long smp,double it,int qf)
+    : observables(sigs), stime(st), inittime(it), samples(smp), firstsample(0),
+      queueframes(qf), produced(0), consumed(0), target(-1), stop(0), failed(0),
+      sent(0), dropped(0), underruns(0), meanlatency(0.0), maxlatency(0.0), jitter(0.0), disconnected(0) {
+
+    if(sigs < 1 || smp < 1 || qf < 1 || st <= 0.0) {
+        std::cerr << "StreamServer::StreamServer(...): need at least one signal, one sample per frame, one queued frame, and stime > 0"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    signals = new Signal*[observables];
+    for(int j=0;j<observables;j++) signals[j] = thesignals[j];
+
+    queue = new double*[queueframes];
+    for(int q=0;q<queueframes;q++) queue[q] = new double[samples * observables];
+
+    pthread_mutex_init(&mutex,0);
+    pthread_cond_init(&cond,0);
+}
+
+StreamServer::~StreamServer() {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+
+    for(int q=0;q<queueframes;q++) delete [] queue[q];
+    delete [] queue;
+
+    delete [] signals;
+}
+
+void *StreamServer::worker(void *server) {
+    // leave the signals (e.g., SIGINT) to the serving thread
+
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK,&all,0);
+
+    ((StreamServer *)server)->produce();
+
+    return 0;
+}
+
+// runs on the worker thread: compute frames until the queue is full, or
+// until the frames requested by serve() are all done
+
+void StreamServer::produce() {
+    TDIblock *block = 0;
+
+    try {
+        block = getblockevaluator(signals,observables,stime,inittime);
+
+        for(;;) {
+            pthread_mutex_lock(&mutex);
+
+            while(!stop && (produced - consumed >= queueframes || (target >= 0 && produced >= target)))
+                pthread_cond_wait(&cond,&mutex);
+
+            if(stop) {
+                pthread_mutex_unlock(&mutex);
+                break;
+            }
+
+            long frame = produced;
+
+            pthread_mutex_unlock(&mutex);
+
+            double *buffer = queue[frame % queueframes];
+            long first = frame * samples;
+
+            if(block) {
+                block->getobs(buffer,first,first + samples);
+            } else {
+                for(long i=0;i<samples;i++) {
+                    double t = inittime + stime * (first + i);
+
+                    for(int j=0;j<observables;j++)
+                        buffer[i*observables + j] = signals[j]->value(t);
+                }
+            }
+
+            pthread_mutex_lock(&mutex);
+            produced++;
+            pthread_cond_broadcast(&cond);
+            pthread_mutex_unlock(&mutex);
+        }
+    } catch (...) {
+        pthread_mutex_lock(&mutex);
+        failed = 1;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    delete block;
+}
+
+int StreamServer::openaddress(char *address,int &listener) {
+    listener = -1;
+
+    if(!strncmp(address,"unix:",5)) {
+        char *path = address + 5;
+
+        struct sockaddr_un addr;
+        memset(&addr,0,sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        if(strlen(path) >= sizeof(addr.sun_path)) {
+            std::cerr << "StreamServer::serve(...): socket path " << path << " is too long"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        strcpy(addr.sun_path,path);
+        unlink(path);
+
+        listener = socket(AF_UNIX,SOCK_STREAM,0);
+
+        if(listener < 0 || bind(listener,(struct sockaddr *)&addr,sizeof(addr)) < 0 || listen(listener,1) < 0) {
+            std::cerr << "StreamServer::serve(...): cannot listen on " << path << ": " << strerror(errno)
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            if(listener >= 0) close(listener);
+            listener = -1;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        // wait for the client
+
+        for(;;) {
+            struct pollfd p = {listener, POLLIN, 0};
+
+            if(poll(&p,1,int(1000 * waitslice)) > 0) break;
+
+            try {
+                checkinterrupt();
+            } catch (...) {
+                close(listener); unlink(path);
+                listener = -1;
+
+                throw;
+            }
+        }
+
+        int fd = accept(listener,0,0);
+
+        if(fd < 0) {
+            std::cerr << "StreamServer::serve(...): cannot accept on " << path << ": " << strerror(errno)
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            close(listener); unlink(path);
+            listener = -1;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        return fd;
+    } else {
+        struct stat st;
+
+        int exists = (stat(address,&st) == 0);
+
+        // an existing regular file is truncated, so no stale frames remain
+
+        int regular = exists && S_ISREG(st.st_mode);
+
+        if(!exists && mkfifo(address,0666) != 0) {
+            std::cerr << "StreamServer::serve(...): cannot create pipe " << address << ": " << strerror(errno)
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        // opening a pipe blocks until there is a reader, so we poll
+
+        for(;;) {
+            int fd = open(address,O_WRONLY | O_NONBLOCK | O_CREAT | (regular ? O_TRUNC : 0),0666);
+
+            if(fd >= 0) {
+                fcntl(fd,F_SETFL,fcntl(fd,F_GETFL) & ~O_NONBLOCK);
+                return fd;
+            } else if(errno != ENXIO) {
+                std::cerr << "StreamServer::serve(...): cannot open " << address << ": " << strerror(errno)
+                          << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+                ExceptionFileError e;
+                throw e;
+            }
+
+            sleepuntil(monotime() + waitslice);
+        }
+    }
+}
+
+// returns 1 if the frame was written, 0 if it was dropped because the
+// reader was not ready by deadline (if nonzero), -1 if the reader is
+// gone; sendtime is set relative to start
+
+int StreamServer::writeframe(int fd,StreamHeader &header,double *data,int socket,double deadline,double start) {
+    if(deadline > 0.0) {
+        for(;;) {
+            double wait = deadline - monotime();
+            if(wait <= 0.0) return 0;
+
+            if(wait > waitslice) wait = waitslice;
+
+            struct pollfd p = {fd, POLLOUT, 0};
+            int ret = poll(&p,1,int(1000 * wait));
+
+            if(ret > 0) {
+                if(p.revents & (POLLERR | POLLHUP)) return -1;
+                break;
+            }
+
+            checkinterrupt();
+        }
+    }
+
+    header.sendtime = monotime() - start;
+
+    const char *parts[2] = {(const char *)&header, (const char *)data};
+    size_t sizes[2] = {sizeof(StreamHeader), samples * observables * sizeof(double)};
+
+    for(int p=0;p<2;p++) {
+        const char *ptr = parts[p];
+        size_t left = sizes[p];
+
+        while(left > 0) {
+            ssize_t done = socket ? send(fd,ptr,left,MSG_NOSIGNAL) : write(fd,ptr,left);
+
+            if(done < 0) {
+                if(errno == EINTR) {
+                    checkinterrupt();
+                    continue;
+                }
+
+                return -1;
+            }
+
+            ptr += done;
+            left -= done;
+        }
+    }
+
+    return 1;
+}
+
+long StreamServer::serve(char *address,long frames,double speedup,double maxlat) {
+    if(speedup <= 0.0 || frames < 0) {
+        std::cerr << "StreamServer::serve(...): need speedup > 0 and frames >= 0"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    sent = dropped = underruns = 0;
+    meanlatency = maxlatency = jitter = 0.0;
+    disconnected = 0;
+
+    int listener;
+    int fd = openaddress(address,listener);
+
+    // a reader that goes away should end the stream, not the process
+
+    struct sigaction ignore, previous;
+    memset(&ignore,0,sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE,&ignore,&previous);
+
+    pthread_mutex_lock(&mutex);
+    stop = 0; failed = 0;
+    target = frames > 0 ? consumed + frames : -1;
+    pthread_mutex_unlock(&mutex);
+
+    pthread_t thread;
+
+    if(pthread_create(&thread,0,worker,this) != 0) {
+        close(fd);
+
+        if(listener >= 0) {
+            close(listener);
+            unlink(address + 5);
+        }
+
+        sigaction(SIGPIPE,&previous,0);
+
+        std::cerr << "StreamServer::serve(...): cannot start the worker thread"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionUndefined e;
+        throw e;
+    }
+
+    double period = samples * stime / speedup;
+    double start = monotime();
+    double sum = 0.0, sum2 = 0.0;
+
+    int error = 0;
+
+    try {
+        for(long f=0;frames == 0 || f < frames;f++) {
+            double due = start + (f + 1) * period;
+
+            sleepuntil(due);
+
+            // the frame should be ready; if not, wait for the worker
+
+            pthread_mutex_lock(&mutex);
+
+            if(produced <= consumed && !failed) {
+                underruns++;
+
+                while(produced <= consumed && !failed) {
+                    pthread_mutex_unlock(&mutex);
+                    sleepuntil(monotime() + 0.001);
+                    pthread_mutex_lock(&mutex);
+                }
+            }
+
+            if(produced <= consumed) {
+                pthread_mutex_unlock(&mutex);
+
+                error = 1;
+                break;
+            }
+
+            double *data = queue[consumed % queueframes];
+
+            pthread_mutex_unlock(&mutex);
+
+            StreamHeader header;
+            memcpy(header.magic,"SLTD",4);
+            header.observables = observables;
+            header.samples = samples;
+            header.flags = 0;
+            header.frame = consumed;
+            header.firstsample = consumed * samples;
+            header.firsttime = inittime + stime * header.firstsample;
+            header.stime = stime;
+            header.sendtime = 0.0;
+
+            int ret = writeframe(fd,header,data,listener >= 0,maxlat > 0.0 ? due + maxlat : 0.0,start);
+
+            if(ret < 0) {
+                disconnected = 1;
+                break;
+            } else if(ret == 0) {
+                dropped++;
+            } else {
+                double latency = monotime() - due;
+
+                sent++;
+                sum += latency;
+                sum2 += latency * latency;
+                if(latency > maxlatency) maxlatency = latency;
+            }
+
+            pthread_mutex_lock(&mutex);
+            consumed++;
+            pthread_cond_broadcast(&cond);
+            pthread_mutex_unlock(&mutex);
+        }
+    } catch (...) {
+        error = 2;
+    }
+
+    // stop the worker; frames computed ahead stay queued for the next serve()
+
+    pthread_mutex_lock(&mutex);
+    stop = 1;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    pthread_join(thread,0);
+
+    close(fd);
+
+    if(listener >= 0) {
+        close(listener);
+        unlink(address + 5);
+    }
+
+    sigaction(SIGPIPE,&previous,0);
+
+    firstsample = consumed * samples;
+
+    if(sent > 0) {
+        meanlatency = sum / sent;
+        jitter = sqrt(fabs(sum2 / sent - meanlatency * meanlatency));
+    }
+
+    if(error == 2) {
+        ExceptionKeyboardInterrupt e;
+        throw e;
+    } else if(error == 1) {
+        std::cerr << "StreamServer::serve(...): could not compute frame " << consumed
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionOutOfBounds e;
+        throw e;
+    }
+
+    return sent;
+}
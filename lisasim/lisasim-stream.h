@@ -0,0 +1,108 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_STREAM_H_
+#define _LISASIM_STREAM_H_
+
+#include "lisasim-tdi.h"
+
+#include <pthread.h>
+
+/* Frame layout for StreamServer: a StreamHeader followed by samples
+   rows of observables doubles (as fastgetobs), all in native byte
+   order; every frame of a stream has the same size. sendtime is the
+   time (s) since the start of the stream at which the frame was
+   written, for the reader to measure its own latency. */
+
+struct StreamHeader {
+    char magic[4];              // "SLTD"
+    int observables, samples;
+    int flags;                  // reserved (0)
+
+    long long frame, firstsample;
+    double firsttime, stime;
+
+    double sendtime;
+};
+
+/** Real-time source of TDI observables, for testing pipelines on live
+    data. The signals are evaluated (by block, as in fastgetobs, when
+    possible) on a worker thread, up to queueframes frames ahead of
+    the reader, and the frames are published at wall-clock cadence,
+    each as soon as its last sample is due (stime*samples/speedup
+    seconds apart). If the reader is slow, writes block (backpressure)
+    and the stream catches up afterwards; with maxlatency > 0, frames
+    that could not be written within maxlatency seconds of their due
+    time are dropped instead (and counted). The signals must not be
+    used elsewhere while serve() runs. Since the worker thread runs
+    without the Python interpreter lock, the signals must not call
+    back into Python: no PyLISA, AllPyLISA, or PyWave objects may be
+    used by them. */
+
+class StreamServer {
+ private:
+    Signal **signals;
+    int observables;
+
+    double stime, inittime;
+    long samples, firstsample;
+
+    // the queue of frames computed ahead, filled by the worker thread
+
+    int queueframes;
+    double **queue;
+    long produced, consumed, target;
+
+    int stop, failed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    // statistics of the last serve()
+
+    long sent, dropped, underruns;
+    double meanlatency, maxlatency, jitter;
+    int disconnected;
+
+    void produce();
+    static void *worker(void *server);
+
+    int openaddress(char *address,int &listener);
+    int writeframe(int fd,StreamHeader &header,double *data,int socket,double deadline,double start);
+
+ public:
+    StreamServer(Signal **thesignals,int signals,double stime,long samples,double inittime = 0.0,int queueframes = 16);
+    ~StreamServer();
+
+    /** Publish frames frames (0 for an unending stream) to address:
+        "unix:<path>" listens on a UNIX socket at path and serves the
+        first client; any other path is opened for writing (a named
+        pipe is created there if nothing exists; an existing regular
+        file is truncated). Runs at speedup times
+        real time, dropping frames later than maxlatency s (if > 0).
+        Returns the number of frames sent; it stops early if the
+        reader goes away (see getdisconnected). Streams continue from
+        where the previous serve() stopped. */
+
+    long serve(char *address,long frames = 0,double speedup = 1.0,double maxlatency = 0.0);
+
+    /// Frames sent, dropped (late), and written late because the worker had not computed them yet.
+    long getsent() { return sent; };
+    long getdropped() { return dropped; };
+    long getunderruns() { return underruns; };
+
+    /// Mean and maximum latency of frames sent, and its RMS deviation (jitter), in seconds.
+    double getmeanlatency() { return meanlatency; };
+    double getmaxlatency() { return maxlatency; };
+    double getjitter() { return jitter; };
+
+    int getdisconnected() { return disconnected; };
+
+    /// Index of the first sample of the next frame.
+    long getfirstsample() { return firstsample; };
+};
+
+#endif /* _LISASIM_STREAM_H_ */
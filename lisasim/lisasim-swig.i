@@ -42,6 +42,20 @@ Destructor. See above.
 };
 %enddef
 
+%define exceptionhandle2(thefunction,theexception,theerror,otherexception,othererror)
+%exception thefunction {
+    try {
+        $action
+    } catch (theexception &e) {
+        PyErr_SetString(theerror,"");
+        return NULL;
+    } catch (otherexception &e) {
+        PyErr_SetString(othererror,"");
+        return NULL;
+    }
+};
+%enddef
+
 %pythoncode %{
 import numpy
 
@@ -93,7 +107,9 @@ components (normalized) of arm l (1,2,3,-1,-2,-3) at time t [s]."
 
 %feature("docstring") LISA::putp "
 LISA.putp(i,t) -> (pix,piy,piz) returns a 3-tuple with the SSB
-coordinates of spacecraft i (1,2,3) at time t [s]."
+coordinates of spacecraft i (1,2,3) at time t [s]. If t is a numpy
+array, returns an array of shape t.shape + (3,) (as do putn and putv).
+"
 
 %feature("docstring") LISA::putv "
 LISA.putv(i,t) -> (vix,viy,viz) returns a 3-tuple with the SSB
@@ -113,6 +129,19 @@ given in units of the speed of light."
 LISA.reset() resets any underlying pseudo-random or ring-buffer
 elements used by the LISA object."
 
+%feature("docstring") LISA::getp "
+LISA.getp(buffer,i,times) fills the numpy array buffer (of 3*len(times)
+doubles) with the SSB coordinates of spacecraft i at the numpy array of
+times; getn, getv, getarmlength (len(times) doubles) and
+getdotarmlength do the same for putn, putv, armlength and dotarmlength.
+The loop runs in C++; putp(i,times) & co. call these for you."
+
+exceptionhandle2(LISA::getp,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle2(LISA::getn,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle2(LISA::getv,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle2(LISA::getarmlength,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle2(LISA::getdotarmlength,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_ValueError)
+
 %nodefault LISA;
 
 class LISA {
@@ -125,6 +154,13 @@ class LISA {
     virtual double dotarmlength(int arm, double t);
 
     virtual void reset();
+
+    void getp(double *numarray,long length,int craft,double *numarray,long length);
+    void getn(double *numarray,long length,int arm,double *numarray,long length);
+    void getv(double *numarray,long length,int craft,double *numarray,long length);
+
+    void getarmlength(double *numarray,long length,int arm,double *numarray,long length);
+    void getdotarmlength(double *numarray,long length,int arm,double *numarray,long length);
 };
 
 
@@ -202,6 +238,8 @@ class CircularRotating : public LISA, public ApproxLISA {
 };
 
 
+initsave(HaloAnalytic)
+
 class HaloAnalytic : public LISA {
   public:
     HaloAnalytic(double myL,double t0=0.0);
@@ -231,6 +269,8 @@ class EccentricInclined : public LISA, public ApproxLISA {
 };
 
 
+initsave(ZeroLISA)
+
 class ZeroLISA : public LISA {
   public:
     ZeroLISA();
@@ -336,8 +376,10 @@ solving the backward light propagation equation."
 
 initdoc(SampledLISA)
 
-/* SampledLISA makes copies of the positions arrays, so initsave is not
-   needed */
+/* SampledLISA makes copies of the positions arrays, but we keep them
+   anyway so that SampledLISA can be pickled (see below) */
+
+initsave(SampledLISA)
 
 class SampledLISA : public LISA {
  public:
@@ -345,6 +387,53 @@ class SampledLISA : public LISA {
 };
 
 
+%feature("docstring") EphemerisLISA "
+EphemerisLISA(filename,cachefile=None)
+returns a LISA object that takes the positions of its spacecraft from
+an orbit ephemeris, read once from the ASCII file filename (formatted
+as for getLISApositions: Julian date, then the SSB coordinates of the
+three spacecraft in km, optionally followed by their velocities in
+km/s), or from a binary ephemeris written by EphemerisLISA.writecache.
+Times are counted from the first row; rows must be equally spaced.
+
+Missing velocities are derived by fourth-order finite differences.
+Positions, velocities, and light-times (solved at the ephemeris nodes)
+are interpolated with cubic Hermite polynomials, which use two nodes
+per query and keep putv, armlength, and dotarmlength consistent with
+putp. Outside the ephemeris, the first and last intervals are
+extrapolated.
+
+If cachefile is given, the ephemeris is read from there when it is
+newer than filename and was made from it (the cache records the
+absolute path and size of filename), and written there otherwise; a
+truncated or corrupt cache is ignored. See also
+makeEphemerisLISA in lisautils.
+
+EphemerisLISA.getnodes(), getdeltat(), getinitjd() return the number
+of nodes, their spacing, and the Julian date of the first; getderived()
+returns 1 if velocities were derived from the positions."
+
+initdoc(EphemerisLISA)
+
+initsave(EphemerisLISA)
+
+exceptionhandle(EphemerisLISA::EphemerisLISA,ExceptionFileError,PyExc_IOError)
+exceptionhandle(EphemerisLISA::writecache,ExceptionFileError,PyExc_IOError)
+
+class EphemerisLISA : public LISA {
+ public:
+    EphemerisLISA(char *filename,char *cachefile = 0);
+    ~EphemerisLISA();
+
+    void writecache(char *filename);
+
+    long getnodes();
+    double getdeltat();
+    double getinitjd();
+    int getderived();
+};
+
+
 %feature("docstring") CacheLengthLISA "
 CacheLengthLISA(baseLISA,bufferlength,deltat,interplen = 1)
 returns a LISA object that caches and interpolates armlengths found by
@@ -369,7 +458,98 @@ class CacheLengthLISA : public LISA {
     ~CacheLengthLISA();
 };
 
+%feature("docstring") IntegratedLISA "
+IntegratedLISA(initLISA,tmin,tmax,deltat=86400,planets=1,earthlead=pi/9)
+returns a LISA object with spacecraft orbits obtained by integrating
+numerically the heliocentric equations of motion from tmin to tmax [s].
+The initial positions and velocities are taken from the LISA object
+initLISA at time tmin (e.g., EccentricInclined()); initLISA is not used
+after construction.
+
+If planets is nonzero, the integration includes the perturbations of
+Venus, Earth-Moon, Mars, Jupiter, and Saturn (on circular ecliptic
+orbits), with the Earth leading the LISA guiding center by earthlead
+radians at tmin.
+
+The integration uses a sixth-order Gauss-Legendre scheme with fixed
+step deltat [s]; every step is stored as a quintic Hermite polynomial,
+so putp, putv, and armlength (solved by fixed-point iteration of the
+light-propagation equation) are cheap and reproducible. Requesting
+positions outside [tmin,tmax] raises an exception; remember that
+armlength(l,t) needs positions at t - L."
+
+initdoc(IntegratedLISA)
+
+exceptionhandle(IntegratedLISA::IntegratedLISA,ExceptionWrongArguments,PyExc_ValueError)
+
+initsave(IntegratedLISA)
+
+class IntegratedLISA : public LISA {
+ public:
+    IntegratedLISA(LISA *initlisa,double tmin,double tmax,double deltat = 86400.0,int planets = 1,double earthlead = M_PI/9.0);
+    ~IntegratedLISA();
+
+    double gettmin();
+    double gettmax();
+};
+
+%feature("docstring") DelayChain "
+DelayChain(arms) returns a chain of retardations D_arms[0] D_arms[1] ...
+D_arms[n-1], where each arm is one of 1,2,3,-1,-2,-3 (zeros are
+dropped). As in the fixed-argument forms of TDI.y and TDI.z, the last
+arm is applied first. DelayChains have no length limit, and can be
+passed to TDI.y(send,link,recv,chain,t), TDI.z(send,link,recv,chain,t),
+and retardation(lisa,chain,t). They support len(), indexing, hashing,
+and comparison; chain.append(arm) adds a retardation to the right
+(applied first), chain.prepend(arm) to the left (applied last)."
+
+initdoc(DelayChain)
+
+exceptionhandle(DelayChain::DelayChain,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle(DelayChain::append,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle(DelayChain::prepend,ExceptionUndefined,PyExc_ValueError)
+exceptionhandle(DelayChain::__getitem__,ExceptionOutOfBounds,PyExc_IndexError)
+
+class DelayChain {
+ public:
+    DelayChain(int *intarray,int intnum);
+    ~DelayChain();
+
+    void append(int arm);
+    void prepend(int arm);
+
+    %extend {
+        int __len__() {
+            return self->size();
+        };
+
+        int __getitem__(int i) {
+            if(i < 0) i += self->size();
+
+            if(i < 0 || i >= self->size()) {
+                ExceptionOutOfBounds e;
+                throw e;
+            }
+
+            return (*self)[i];
+        };
+
+        long __hash__() {
+            return (long)self->hash();
+        };
+
+        bool __eq__(const DelayChain &chain) {
+            return *self == chain;
+        };
+
+        bool __ne__(const DelayChain &chain) {
+            return *self != chain;
+        };
+    };
+};
+
 extern double retardation(LISA *lisa,int ret1,int ret2,int ret3,int ret4,int ret5,int ret6,int ret7,int ret8,double t);
+extern double retardation(LISA *lisa,const DelayChain &ret,double t);
 
 /* -------- Signal/Noise objects -------- */
 
@@ -402,6 +582,8 @@ or reset. The seed is an unsigned long integer. The global seed is
 increased by one after each creation or initialization. This is a class
 (static) method. "
 
+initsave(WhiteNoiseSource)
+
 class WhiteNoiseSource : public SignalSource {
  public:
     WhiteNoiseSource(long len,unsigned long seed = 0,double norm = 1.0);
@@ -417,7 +599,7 @@ class SampledSignalSource : public SignalSource {
     SampledSignalSource(double *numarray,long length,double norm = 1.0);
 };
 
-initsave(SampledSignalSource)
+initsave(FileSignalSource)
 
 class FileSignalSource : public SignalSource {
  public:
@@ -429,31 +611,43 @@ class FileSignalSource : public SignalSource {
 %nodefault Filter;
 class Filter;
 
+initsave(NoFilter)
+
 class NoFilter : public Filter {
  public:
     NoFilter();
 };
 
+initsave(IntFilter)
+
 class IntFilter : public Filter {
  public:
     IntFilter(double a = 0.9999);
 };
 
+initsave(DiffFilter)
+
 class DiffFilter : public Filter {
  public:
     DiffFilter();
 };
 
+initsave(BandIntFilter)
+
 class BandIntFilter : public Filter {
  public:
     BandIntFilter(double deltat,double flow,double fhi);
 };
 
+initsave(FIRFilter)
+
 class FIRFilter: public Filter {
  public:
     FIRFilter(double *doublearray,int doublenum);
 };
 
+initsave(IIRFilter)
+
 class IIRFilter : public Filter {
  public:
     IIRFilter(double *doublearray,int doublenum,double *doublearray,int doublenum);
@@ -466,8 +660,84 @@ class SignalFilter : public SignalSource {
     SignalFilter(long length,SignalSource *src,Filter *flt);
 };
 
+%feature("docstring") ARNoiseModel "
+ARNoiseModel(psd,deltat,order)
+ARNoiseModel(observable,deltat,order,proofnoise=2.5e-48,opticalnoise=1.8e-37,L=16.6782)
+fits an autoregressive model of order order to the one-sided noise PSD
+of a time series sampled at deltat. The PSD is given either as a
+two-column array of rows (f,S(f)) (e.g., as returned by spect), or as
+the name of a TDI observable (Xm, Ym, Zm, X1, X2, X3, alpham, betam,
+gammam, zetam, Am, Em, Tm), for which the analytic equal-arm expression
+is used, with the given proof-mass and optical-path noise levels and
+armlength L [s].
+
+ARNoiseModel.whitening() returns a (FIR) Filter that whitens the noise
+to unit variance; ARNoiseModel.recoloring() returns the (IIR) Filter
+that inverts it exactly. Both can be used with SignalFilter or with
+BlockFilter. ARNoiseModel.psd(f) returns the PSD of the fitted model.
+PSDs with deep nulls or steep slopes (e.g., TDI noise at low
+frequencies) need high orders (a few hundred) to be whitened well."
+
+initdoc(ARNoiseModel)
+
+exceptionhandle(ARNoiseModel::ARNoiseModel,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(ARNoiseModel::tdipsd,ExceptionWrongArguments,PyExc_ValueError)
+
+%newobject ARNoiseModel::whitening();
+%newobject ARNoiseModel::recoloring();
+
+class ARNoiseModel {
+ public:
+    ARNoiseModel(double *numarray,long length,double deltat,int order);
+    ARNoiseModel(char *observable,double deltat,int order,double proofnoise = 2.5e-48,double opticalnoise = 1.8e-37,double armlength = 16.6782);
+    ~ARNoiseModel();
+
+    int getorder();
+    double getsigma();
+
+    double psd(double f);
+
+    Filter *whitening();
+    Filter *recoloring();
+
+    static double tdipsd(char *observable,double f,double proofnoise = 2.5e-48,double opticalnoise = 1.8e-37,double armlength = 16.6782);
+};
+
+%feature("docstring") BlockFilter "
+BlockFilter(length,filter,column=0,columns=1)
+applies Filter filter, in place, to successive blocks of samples
+passed to BlockFilter.apply(array), keeping the filter state across
+blocks, so that long streams (e.g., successive blocks returned by
+getobs) can be filtered in bounded memory. length must exceed the
+filter order (the number of past samples it uses), or ValueError is
+raised. For 2D arrays with several observables per row, only
+column column of columns is filtered. BlockFilter.reset() restarts
+the stream."
+
+initdoc(BlockFilter)
+
+initsave(BlockFilter)
+
+exceptionhandle(BlockFilter::BlockFilter,ExceptionWrongArguments,PyExc_ValueError)
+
+class BlockFilter {
+ public:
+    BlockFilter(long length,Filter *flt,int column = 0,int columns = 1);
+
+    void reset();
+
+    void apply(double *numarray,long length);
+};
+
+%feature("docstring") Signal::getvalues "
+Signal.getvalues(buffer,times) fills the numpy array buffer with the
+values of the Signal at the numpy array of times, looping in C++.
+Signal.value(times) and Signal(times) do the same, and return an array
+of the same shape as times."
+
 exceptionhandle(Signal::value,ExceptionOutOfBounds,PyExc_IndexError)
 exceptionhandle(Signal::__call__,ExceptionOutOfBounds,PyExc_IndexError)
+exceptionhandle2(Signal::getvalues,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
 
 %nodefault Signal;
 class Signal {
@@ -477,6 +747,8 @@ class Signal {
     virtual double value(double time);
     virtual double value(double timebase,double timecorr);
 
+    void getvalues(double *numarray,long length,double *numarray,long length);
+
     %extend {
         double __call__(double time) {
             return self->value(time);
@@ -491,41 +763,55 @@ typedef Signal Noise;
 class Interpolator;
 
 
+initsave(NearestInterpolator)
+
 class NearestInterpolator : public Interpolator {
  public:
     NearestInterpolator();
 };
 
 
+initsave(LinearInterpolator)
+
 class LinearInterpolator : public Interpolator {
  public:
     LinearInterpolator();
 };
 
 
+initsave(LinearExtrapolator)
+
 class LinearExtrapolator : public Interpolator {
  public:
     LinearExtrapolator();
 };
 
 
+initsave(LagrangeInterpolator)
+
 class LagrangeInterpolator : public Interpolator {
  public:
     LagrangeInterpolator(int semiwin);
 };
 
 
+initsave(DotLagrangeInterpolator)
+
 class DotLagrangeInterpolator : public Interpolator {
  public:
     DotLagrangeInterpolator(int semiwin);
 };
 
 
+initsave(NewLagrangeInterpolator)
+
 class NewLagrangeInterpolator : public Interpolator {
  public:
     NewLagrangeInterpolator(int semiwin);
 };
 
+initsave(NoSignal)
+
 class NoSignal : public Signal {
  public:
     NoSignal();
@@ -540,6 +826,10 @@ class SumSignal : public Signal {
 
 initsave(InterpolatedSignal)
 
+%feature("addtofunc") InterpolatedSignal::setinterp {
+        self.initcalls = getattr(self,'initcalls',[]) + [('setinterp',args)]
+}
+
 class InterpolatedSignal : public Signal {
  public:
     InterpolatedSignal(SignalSource *src,Interpolator *interp,
@@ -592,6 +882,9 @@ def PowerLawNoise(deltat,prebuffer,psd,exponent,interplen=1,seed=0):
     else:
         raise NotImplementedError, "PowerLawNoise: undefined PowerLaw exponent %s (lisasim-swig.i)." % exponent
 
+    if isinstance(interplen,InterpolationBudget):
+        interplen = interplen.choose(deltat,psd,exponent)
+
     if seed == 0:
         seed = getcseed()
 
@@ -608,6 +901,68 @@ def PowerLawNoise(deltat,prebuffer,psd,exponent,interplen=1,seed=0):
     return noise
 %}
 
+%feature("docstring") interpolationerror "
+interpolationerror(deltat,psd,exponent,interplen) returns the predicted
+RMS error of reading PowerLawNoise(deltat,...,psd,exponent,interplen)
+between samples, computed from the exact PSD of its filtered samples
+and from the response of the interpolator, averaged over fractional
+offsets. interpolationlength(deltat,psd,exponent,tolerance,maxlen=16)
+returns the cheapest interpolator length (1 for linear, then Lagrange
+semiwindows) with error within tolerance, or -1 if none is. See also
+InterpolationBudget."
+
+exceptionhandle(interpolationerror,ExceptionUndefined,PyExc_NotImplementedError)
+exceptionhandle(interpolationlength,ExceptionUndefined,PyExc_NotImplementedError)
+
+extern double interpolationerror(double deltat,double psd,double exponent,int interplen);
+extern int interpolationlength(double deltat,double psd,double exponent,double tolerance,int maxlen = 16);
+
+%pythoncode %{
+class InterpolationBudget:
+    """InterpolationBudget(target,reads=8,noises=18,maxlen=16) chooses
+    interpolator lengths automatically: pass it as interplen to
+    PowerLawNoise, as interp to stdproofnoise, stdopticalnoise, and
+    stdlasernoise, or as the last argument to TDInoise. The TDI residual
+    target (RMS, in the units of the observable) is split evenly among
+    noises objects, each read reads times by the observable, and every
+    noise gets the cheapest interpolator that meets its share.
+    report() prints the predicted error budget; budget() returns it as
+    a list of (exponent,deltat,psd,interplen,error) entries."""
+
+    def __init__(self,target,reads=8,noises=18,maxlen=16):
+        self.target, self.reads, self.noises, self.maxlen = target, reads, noises, maxlen
+        self.entries = []
+
+    def tolerance(self):
+        return self.target / math.sqrt(self.reads * self.noises)
+
+    def choose(self,deltat,psd,exponent):
+        interplen = interpolationlength(deltat,psd,exponent,self.tolerance(),self.maxlen)
+
+        if interplen == -1:
+            print "InterpolationBudget: no interpolator up to length %s meets %s for exponent %s noise; using the longest." % (self.maxlen,self.tolerance(),exponent)
+            interplen = self.maxlen
+
+        self.entries.append((exponent,deltat,psd,interplen,interpolationerror(deltat,psd,exponent,interplen)))
+
+        return interplen
+
+    def budget(self):
+        return list(self.entries)
+
+    def residual(self):
+        """Predicted RMS interpolation residual in the TDI observable, for
+        the noises chosen so far."""
+
+        return math.sqrt(self.reads * sum([entry[4]**2 for entry in self.entries]))
+
+    def report(self):
+        print "Interpolation budget: target %s, %s reads per noise, share %s per noise" % (self.target,self.reads,self.tolerance())
+        for exponent,deltat,psd,interplen,error in self.entries:
+            print "  exponent %4s  deltat %-6s psd %-10s interplen %2d  error %.3e" % (exponent,deltat,psd,interplen,error)
+        print "Predicted TDI residual: %.3e (%d noises)" % (self.residual(),len(self.entries))
+%}
+
 %pythoncode %{
 def SampledSignal(array,deltat,buffer = 136.0,norm = 1.0,filter = None,interplen = 1,timeoffset = 0.0,endianness = -1,readbuffer=2**20):
     interp = getInterpolator(interplen)
@@ -682,11 +1037,18 @@ the SSB."
 
 %feature("docstring") Wave::hp "
 Wave.hp(t) returns the hp polarization of the GW Wave at time t [s] at
-the SSB."
+the SSB. If t is a numpy array, returns an array of the same shape."
 
 %feature("docstring") Wave::hc "
 Wave.hc(t) returns the hc polarization of the GW Wave at time t [s] at
-the SSB."
+the SSB. If t is a numpy array, returns an array of the same shape.
+
+Wave.gethp(buffer,times) and Wave.gethc(buffer,times) fill the numpy
+array buffer with hp and hc at the numpy array of times, looping in
+C++."
+
+exceptionhandle(Wave::gethp,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(Wave::gethc,ExceptionWrongArguments,PyExc_ValueError)
 
 %feature("docstring") Wave::putep "
 Wave.putep(elat,elon,pol) returns the basic ep polarization tensor
@@ -712,6 +1074,9 @@ class Wave : public WaveObject {
     virtual double hp(double t);
     virtual double hc(double t);
 
+    void gethp(double *numarray,long length,double *numarray,long length);
+    void gethc(double *numarray,long length,double *numarray,long length);
+
     static void putep(Tensor &outtensor,double b,double l,double p);
     static void putec(Tensor &outtensor,double b,double l,double p);
 };
@@ -791,6 +1156,8 @@ parameters:
 
 initdoc(SimpleMonochromatic)
 
+initsave(SimpleMonochromatic)
+
 class SimpleMonochromatic : public Wave {
  public:
     SimpleMonochromatic(double freq, double phi, double gamma, double amp, double elat, double elon, double pol);
@@ -818,6 +1185,8 @@ lisasim-wave.cpp)."
 
 initdoc(GaussianPulse)
 
+initsave(GaussianPulse)
+
 class GaussianPulse : public Wave {
  public:
     GaussianPulse(double time, double decay, double gamma, double amp, double b, double l, double p);
@@ -848,6 +1217,8 @@ lisasim-wave.cpp)."
 
 initdoc(SineGaussian)
 
+initsave(SineGaussian)
+
 class SineGaussian : public Wave {
  public:
     SineGaussian(double time, double decay, double freq, double phase0, double gamma, double amp, double b, double l, double p);
@@ -1119,8 +1490,164 @@ class timeobject : public Signal {};
 
 exceptionhandle(fastgetobsc,ExceptionKeyboardInterrupt,PyExc_KeyboardInterrupt)
 
-extern void fastgetobs(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,double inittime);
-extern void fastgetobsc(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,double inittime);
+extern void fastgetobs(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample = 0);
+extern void fastgetobsc(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample = 0);
+
+%feature("docstring") fastgetlockstep "
+fastgetlockstep(buffer,samples,stime,signals,variants,inittime,firstsample=0)
+evaluates the list of signals, made of variants sets of the same
+observables, in lockstep (all at each time inittime + (firstsample +
+i)*stime), so that TDI variants built on the same noise objects (see
+TDIvariant) share noise generation. Each row of the numpy array buffer
+holds the variants in order, then their differences from the first
+variant. See getlockstep for a version that allocates the arrays."
+
+exceptionhandle(fastgetlockstep,ExceptionWrongArguments,PyExc_ValueError)
+
+extern void fastgetlockstep(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,int variants,double inittime,long firstsample = 0);
+
+%pythoncode %{
+def TDIvariant(tdi,tdiclass=None,lisa=None,phlisa=None):
+    """TDIvariant(tdi,tdiclass=None,lisa=None,phlisa=None) returns a TDI
+    object of class tdiclass (default: the class of tdi, which must be
+    TDInoise or a subclass built from noise objects) that reads the same
+    noise objects as tdi, with the same laser locking, and with LISA
+    geometry lisa (default: tdi's) and physical geometry phlisa (default:
+    tdi's, if tdi has one and lisa is not given). Use getlockstep to
+    evaluate variants in lockstep."""
+
+    if tdiclass == None:
+        tdiclass = tdi.__class__
+
+    if lisa == None:
+        lisa = tdi.initargs[0]
+
+    variant = tdiclass(lisa,*tdi.initargs[1:4])
+
+    for name,args in getattr(tdi,'initcalls',[]):
+        if name == 'setphlisa' and (phlisa != None or lisa != tdi.initargs[0]):
+            continue
+
+        getattr(variant,name)(*args)
+
+    if phlisa != None:
+        variant.setphlisa(phlisa)
+
+    return variant
+
+def getlockstep(snum,stime,variants,observables='Xm',zerotime=0.0,firstsample=0):
+    """getlockstep(snum,stime,variants,observables='Xm',zerotime=0.0,firstsample=0)
+    evaluates the comma-separated observables of the list of TDI
+    variants (e.g., built with TDIvariant on shared noise) in lockstep,
+    and returns the arrays of values, with shape (snum,variants,observables),
+    and of their differences from the first variant, with shape
+    (snum,variants-1,observables)."""
+
+    names = observables.replace(',',' ').split()
+    signals = [getattr(tdi,name)() for tdi in variants for name in names]
+
+    nvar, nobs = len(variants), len(names)
+
+    array = numpy.zeros((snum,(2*nvar - 1)*nobs),dtype='d')
+    fastgetlockstep(array,snum,stime,signals,nvar,zerotime,firstsample)
+
+    values = numpy.reshape(array[:,:nvar*nobs],(snum,nvar,nobs))
+    differences = numpy.reshape(array[:,nvar*nobs:],(snum,nvar-1,nobs))
+
+    return values, differences
+%}
+
+%feature("docstring") fastgetensemble "
+fastgetensemble(buffer,samples,stime,signals,realizations,inittime,firstsample=0)
+evaluates the list of signals, made of realizations sets of the same
+observables of TDInoise objects of the same class and LISA geometry
+(e.g., built with different seeds), at times inittime + (firstsample +
+i)*stime, into the numpy array buffer, as fastgetobs would. The delays,
+interpolation weights, and TDI terms are computed once for all the
+realizations, and applied to their noise samples together. See
+getensemble for a version that allocates the array."
+
+exceptionhandle(fastgetensemble,ExceptionWrongArguments,PyExc_ValueError)
+
+extern void fastgetensemble(double *numarray,long length,long samples,double stime,Signal **thesignals,int signals,int realizations,double inittime,long firstsample = 0);
+
+%pythoncode %{
+def getensemble(snum,stime,tdis,observables='Xm',zerotime=0.0,firstsample=0):
+    """getensemble(snum,stime,tdis,observables='Xm',zerotime=0.0,firstsample=0)
+    evaluates the comma-separated observables of the list of TDInoise
+    realizations tdis with fastgetensemble, and returns an array of shape
+    (snum,realizations,observables)."""
+
+    names = observables.replace(',',' ').split()
+    signals = [getattr(tdi,name)() for tdi in tdis for name in names]
+
+    array = numpy.zeros((snum,len(tdis)*len(names)),dtype='d')
+    fastgetensemble(array,snum,stime,signals,len(tdis),zerotime,firstsample)
+
+    return numpy.reshape(array,(snum,len(tdis),len(names)))
+%}
+
+%feature("docstring") SpectralTDInoise "
+SpectralTDInoise(tdi,observables,stime,inittime=0.0,blocklength=65536,vary=0,
+                 sdproof=2.5e-48,sdshot=1.8e-37,sdlaser=1.1e-26,seed=0)
+synthesizes Gaussian noise for the comma-separated TDI observables
+(e.g., 'Xm,Ym,Zm' or 'Am,Em,Tm'), sampled at inittime + i*stime,
+directly from their cross-spectral density, without generating the
+eighteen underlying noises. The CSD is built from the TDI structure of
+tdi (a TDInoise object, or subclass, on the desired LISA geometry,
+whose own noises are not used) and from the one-sided PSDs of proof-mass
+(sdproof/f^2), optical-path (sdshot f^2), and laser (sdlaser) noises,
+so unequal armlengths and laser-noise residuals are included. Blocks of
+blocklength samples (a power of two) are colored in the frequency
+domain and overlapped by half with sine windows; frequencies below
+1/(blocklength*stime) are not represented. With vary = 1, the CSD is
+recomputed for every block with the armlengths at its center, to
+follow slowly varying armlengths. All noises are taken as independent,
+so a tdi with locked lasers (after TDInoise.lock) raises ValueError.
+
+SpectralTDInoise.getobs(buffer,samples) fills the numpy array buffer,
+of shape (samples,observables), with the next samples of the stream;
+SpectralTDInoise.reset(seed=0) restarts it at inittime.
+SpectralTDInoise.getcsd(csd,f,t) fills the numpy array csd, of shape
+(observables,observables,2), with the real and imaginary parts of the
+one-sided CSD at frequency f and time t."
+
+initdoc(SpectralTDInoise)
+
+initsave(SpectralTDInoise)
+
+exceptionhandle(SpectralTDInoise::SpectralTDInoise,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(SpectralTDInoise::getobs,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(SpectralTDInoise::getcsd,ExceptionWrongArguments,PyExc_ValueError)
+
+class SpectralTDInoise {
+ public:
+    SpectralTDInoise(TDInoise *tdi,char *observables,double stime,double inittime = 0.0,long blocklength = 65536,int vary = 0,
+                     double sdproof = 2.5e-48,double sdshot = 1.8e-37,double sdlaser = 1.1e-26,unsigned long seed = 0);
+    ~SpectralTDInoise();
+
+    void getcsd(double *numarray,long length,double f,double t);
+    void getobs(double *numarray,long length,long samples);
+
+    void reset(unsigned long seed = 0);
+
+    int getobservables();
+};
+
+%feature("docstring") savestate "
+savestate(filename,signals) saves to filename the continuation state
+of the list of signals (and of the TDI objects behind them): noise
+generator states, filter histories, and sample buffers. After
+loadstate(filename,signals), with the same list of signals built with
+the same parameters (possibly in another session), a run of N samples
+is extended exactly by fastgetobs(...,inittime,N). See also savestate,
+loadstate, and extendobs in lisautils."
+
+exceptionhandle(savestate,ExceptionFileError,PyExc_IOError)
+exceptionhandle(loadstate,ExceptionFileError,PyExc_IOError)
+
+extern void savestate(char *filename,Signal **thesignals,int signals);
+extern void loadstate(char *filename,Signal **thesignals,int signals);
 
 %newobject TDI::alpham();
 %newobject TDI::betam();
@@ -1229,11 +1756,14 @@ class TDI {
     virtual double X3(double t);
     TDIobject *X3();
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t);
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t);
+    virtual double y(int send, int link, int recv, const DelayChain &ret, double t);
+    virtual double z(int send, int link, int recv, const DelayChain &ret, double t);
+
+    double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t);
+    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t);
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
+    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
 
     double y123(double t);
     TDIobject *y123();
@@ -1279,6 +1809,8 @@ class SampledTDI : public TDI {
     ~SampledTDI();
 };
 
+initsave(SampledTDIaccurate)
+
 class SampledTDIaccurate : public SampledTDI {
  public:
     SampledTDIaccurate(LISA *lisa,Noise *yijk[6],Noise *zijk[6]);
@@ -1324,11 +1856,12 @@ defined in the base TDI class are available from TDInoise.
   SHpsd*(f/Hz)^2  Hz^-1
   LSpsd           Hz^-1
 
-Note: resetting the TDInoise object will reset all the component noise
-objects.
+  An InterpolationBudget may be passed as the last argument, to
+  choose the interpolation width of these noise objects from the
+  target TDI residual (see InterpolationBudget).
 
-TODO: might want to allow different interpolation widths for the
-self-built pseudorandom noise objects."
+Note: resetting the TDInoise object will reset all the component noise
+objects."
 
 initdoc(TDInoise)
 
@@ -1338,6 +1871,13 @@ initsave(TDInoise)
 
 %feature("addtofunc") TDInoise::setphlisa {
         self.phlisa = args
+        self.initcalls = getattr(self,'initcalls',[]) + [('setphlisa',args)]
+}
+
+// lock() and setphlisa() are part of the configuration (see pickling below)
+
+%feature("addtofunc") TDInoise::lock {
+        self.initcalls = getattr(self,'initcalls',[]) + [('lock',args)]
 }
 
 // utility Python functions needed by TDInoise constructor
@@ -1388,6 +1928,13 @@ initsave(TDInoise)
         self.lisa = args[0]
         args = args[1:]
 
+        # an InterpolationBudget as the last argument chooses interplen for std noises
+
+        interp = 1
+        if len(args) > 0 and isinstance(args[-1],InterpolationBudget):
+            interp = args[-1]
+            args = args[:-1]
+
         # if no parameters are passed, used default value
         # if only one parameter is passed, use it as stime
 
@@ -1400,7 +1947,7 @@ initsave(TDInoise)
         # six Noise objects otherwise
 
         if type(args[0]) in (int,float):
-            self.pm = [stdproofnoise(self.lisa,args[0],args[1]) for i in range(6)]
+            self.pm = [stdproofnoise(self.lisa,args[0],args[1],interp) for i in range(6)]
             args = args[2:]
         else:
             self.pm = args[0]
@@ -1409,7 +1956,7 @@ initsave(TDInoise)
         # shot noise: same story
 
         if type(args[0]) in (int,float):
-            self.pd = [stdopticalnoise(self.lisa,args[0],args[1]) for i in range(6)]
+            self.pd = [stdopticalnoise(self.lisa,args[0],args[1],interp) for i in range(6)]
             args = args[2:]
         else:
             self.pd = args[0]
@@ -1419,7 +1966,7 @@ initsave(TDInoise)
 
         if len(args) > 0:
             if type(args[0]) in (int,float):
-                self.c = [stdlasernoise(self.lisa,args[0],args[1]) for i in range(6)]
+                self.c = [stdlasernoise(self.lisa,args[0],args[1],interp) for i in range(6)]
                 args = args[2:]
             else:
                 self.c = args[0]
@@ -1500,3 +2047,800 @@ class TDIsignal : public TDI {
 
     double Phi(int slink,double t);
 };
+
+%feature("docstring") TDIbackground "
+TDIbackground(lisa,nlat,nlon,deltat,density,exponent,interplen=4,seed=0)
+TDIbackground(lisa,nlat,nlon,weights,deltat,density,exponent,interplen=4,seed=0)
+returns a TDI object for the response of LISA object lisa to a Gaussian
+stochastic background of unpolarized gravitational waves, defined for
+t >= 0. The sky is divided into nlat bands of equal width in
+sin(beta), each with nlon pixels of equal width in lambda (all pixels
+subtend the same solid angle); each pixel carries independent hp and
+hc streams, sampled at deltat and interpolated linearly, with
+one-sided PSD density*(f/Hz)^exponent summed over the sky (exponent
+can be 0, 2, -2, as for PowerLawNoise). An anisotropic background can
+be obtained by giving nlat*nlon nonnegative pixel weights (pixel index
+ilat*nlon + ilon, from the south ecliptic pole); the PSD is then split
+among pixels in proportion to the weights.
+
+The pixel sums are accumulated once per sample for each of the six
+links and two ends, and then interpolated (with Lagrange interpolation
+of order interplen) for all TDI observables, which is much cheaper
+than summing a WaveArray of NoiseWaves. Since the link sums are
+resampled, power near the Nyquist frequency 1/(2 deltat) is somewhat
+suppressed: choose deltat so that the band of interest lies well below
+it. If seed is zero, the global seed is used and incremented.
+
+TDIbackground.getpixels() returns the number of pixels, and
+TDIbackground.pixelbeta(pix), TDIbackground.pixellambda(pix) return
+the ecliptic latitude and longitude of the center of pixel pix."
+
+initdoc(TDIbackground)
+
+initsave(TDIbackground)
+
+exceptionhandle(TDIbackground::TDIbackground,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(TDIbackground::pixelbeta,ExceptionOutOfBounds,PyExc_IndexError)
+exceptionhandle(TDIbackground::pixellambda,ExceptionOutOfBounds,PyExc_IndexError)
+
+class TDIbackground : public TDI {
+ public:
+    TDIbackground(LISA *mylisa,int nlat,int nlon,double deltat,double density,double exponent,int interplen = 4,unsigned long seed = 0);
+    TDIbackground(LISA *mylisa,int nlat,int nlon,double *numarray,long length,double deltat,double density,double exponent,int interplen = 4,unsigned long seed = 0);
+    ~TDIbackground();
+
+    void reset(unsigned long seed = 0);
+
+    int getpixels();
+
+    double pixelbeta(int pix);
+    double pixellambda(int pix);
+};
+
+%feature("docstring") GalacticConfusion "
+GalacticConfusion(lisa,observables,psd,sky,stime,inittime=0.0,period=31536000.0,
+                  nodes=64,fref=1e-3,blocklength=65536,seed=0)
+synthesizes cyclostationary galactic confusion noise for the
+comma-separated TDI observables (e.g., 'Xm,Ym,Zm'), sampled at
+inittime + i*stime, at the cost of ordinary colored noise rather than
+of summing the binaries. In the long-wavelength limit, the CSD of the
+observables is S(f) G(t): S is the confusion spectrum, a numpy array of
+rows (f,S) (interpolated linearly, zero outside), and G(t) is the
+modulation matrix from the geometry of LISA object lisa and the sky
+distribution of the sources, a numpy array of rows (beta,lambda,weight)
+(see galacticsky). G sums the responses to waves of frequency fref,
+averaged over polarization, and is tabulated at nodes times over one
+period (a year for the standard orbits); it is normalized so that its
+mean trace is the number of observables, so that S is the
+orbit-averaged PSD of symmetric observables such as Xm, Ym, Zm.
+Blocks of blocklength samples (a power of two) of independent colored
+streams are overlapped by half with sine windows, and mixed by the
+Cholesky factor of G.
+
+GalacticConfusion.getobs(buffer,samples) fills the numpy array buffer,
+of shape (samples,observables), with the next samples of the stream;
+GalacticConfusion.reset(seed=0) restarts it at inittime.
+GalacticConfusion.getmodulation(buffer,t) fills the numpy array
+buffer, of shape (observables,observables), with G(t)."
+
+initdoc(GalacticConfusion)
+
+initsave(GalacticConfusion)
+
+exceptionhandle(GalacticConfusion::GalacticConfusion,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(GalacticConfusion::getobs,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(GalacticConfusion::getmodulation,ExceptionWrongArguments,PyExc_ValueError)
+
+class GalacticConfusion {
+ public:
+    GalacticConfusion(LISA *lisa,char *observables,double *numarray,long length,double *numarray,long length,double stime,
+                      double inittime = 0.0,double period = 31536000.0,long nodes = 64,double fref = 1.0e-3,
+                      long blocklength = 65536,unsigned long seed = 0);
+    ~GalacticConfusion();
+
+    void getmodulation(double *numarray,long length,double t);
+    void getobs(double *numarray,long length,long samples);
+
+    void reset(unsigned long seed = 0);
+
+    int getobservables();
+};
+
+%pythoncode %{
+def galacticsky(catalog,nlat=16,nlon=32):
+    """galacticsky(catalog,nlat=16,nlon=32) bins a catalog of GalacticBinary
+    sources, given as rows (f,fdot,beta,lambda,amp,inc,psi,phi0), into
+    the equal-area pixels of TDIbackground, and returns the nonempty
+    pixels as rows (beta,lambda,weight) for GalacticConfusion, with the
+    weight of each source proportional to its polarization-averaged
+    power, amp^2 ((1 + cos^2 inc)^2 + 4 cos^2 inc)."""
+
+    catalog = numpy.asarray(catalog,dtype='d')
+
+    beta, lam = catalog[:,2], numpy.mod(catalog[:,3],2.0*math.pi)
+    cosi = numpy.cos(catalog[:,5])
+    power = catalog[:,4]**2 * ((1.0 + cosi**2)**2 + 4.0*cosi**2)
+
+    ilat = numpy.minimum(numpy.floor(0.5 * (numpy.sin(beta) + 1.0) * nlat).astype('i'),nlat - 1)
+    ilon = numpy.minimum(numpy.floor(lam / (2.0*math.pi) * nlon).astype('i'),nlon - 1)
+
+    weights = numpy.zeros(nlat*nlon,dtype='d')
+    for pix,pw in zip(ilat*nlon + ilon,power):
+        weights[pix] += pw
+
+    rows = []
+    for pix in numpy.nonzero(weights)[0]:
+        sinb = -1.0 + 2.0 * (pix // nlon + 0.5) / nlat
+        rows.append((math.asin(sinb),2.0*math.pi * (pix % nlon + 0.5) / nlon,weights[pix]))
+
+    return numpy.array(rows,dtype='d')
+%}
+
+%feature("docstring") FStatistic "
+FStatistic(lisa,data,observables,deltat,inittime=0,bandwidth=5e-5)
+returns an F-statistic search engine for quasi-monochromatic binaries
+(GalacticBinary) over the TDI data array data, sampled at deltat from
+inittime, with one column per channel (as returned by getobs, without
+a time column). observables is a comma-separated string naming the
+channels, chosen among Xm, Ym, Zm, X1, X2, X3, alpham, betam, gammam,
+zetam, and Am, Em, Tm (the optimal combinations of Xm, Ym, Zm). The
+templates are computed with TDIsignal for LISA object lisa. The
+channels should have uncorrelated noise; its PSD is estimated in each
+frequency band of width bandwidth [Hz] from the data.
+
+FStatistic.getdf() returns the spacing of the frequency grid (about
+1/(2T)); bin i corresponds to frequency FStatistic.getfrequency(i),
+and FStatistic.getbin(f) returns the first bin at or above f.
+
+FStatistic.fstat(out,fmin,beta,lambda,fdot=0) fills the numpy array
+out with F for consecutive frequency bins starting at fmin, for the
+given sky position (SSB ecliptic latitude and longitude) and fdot.
+
+FStatistic.search(out,fmin,fdots,betas,lambdas,threads=1) fills the
+array out, of shape (len(betas)*len(fdots),nbins), with F for nbins
+frequency bins starting at fmin, for all fdots and for the sky
+positions (betas[i],lambdas[i]), ordered as [sky][fdot][bin]. The data
+are heterodyned once per band, and the response once per band and sky
+position, so it is much faster to search many points in one call.
+The bands are split among up to threads threads, each with its own
+copy of lisa; LISA classes that cannot be copied (PyLISA, AllPyLISA,
+and the sampled, ephemeris, and cached geometries) use one thread.
+
+2F is chi-square distributed with four degrees of freedom and
+noncentrality SNR^2."
+
+initdoc(FStatistic)
+
+initsave(FStatistic)
+
+exceptionhandle(FStatistic::FStatistic,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle2(FStatistic::search,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_RuntimeError)
+exceptionhandle(FStatistic::fstat,ExceptionWrongArguments,PyExc_ValueError)
+
+class FStatistic {
+ public:
+    FStatistic(LISA *mylisa,double *numarray,long length,char *observables,double deltat,double inittime = 0.0,double bandwidth = 5.0e-5);
+    ~FStatistic();
+
+    double getdf();
+    long getbin(double f);
+    double getfrequency(long bin);
+
+    void search(double *numarray,long length,double fmin,double *numarray,long length,double *numarray,long length,double *numarray,long length,int threads = 1);
+    void fstat(double *numarray,long length,double fmin,double beta,double lambda,double fdot = 0.0);
+};
+
+%feature("docstring") fastgetobsp "
+fastgetobsp(buffer,samples,stime,lisa,catalog,observables,inittime=0,chunk=16,threads=1)
+computes the summed TDI response of a catalog of GalacticBinary
+sources, given as a numpy array of rows (f,fdot,beta,lambda,amp,
+inc,psi,phi0), for the comma-separated observables (e.g. 'Xm,Ym,Zm',
+or 'Am,Em,Tm'), at times inittime + i*stime, into the numpy array
+buffer of shape (samples,observables).
+
+If synthLISA was built with MPI (setup.py --with-mpi=<prefix>), the
+sources are handed out in chunks of chunk, on demand, to all the
+processes in MPI_COMM_WORLD, and the result is reduced on rank 0;
+otherwise the computation runs in the calling process. Within each
+process, the chunks are shared by threads threads, each with its own
+copy of lisa; LISA classes that cannot be copied (PyLISA, AllPyLISA,
+and the sampled, ephemeris, and cached geometries) use one thread, so
+run one process per core for them. If a chunk fails in any process,
+all of them raise the error and nothing is reduced. Use getobsp for a
+version that allocates the array. getmpirank() and getmpisize() return the
+MPI rank and size (0 and 1 without MPI)."
+
+exceptionhandle2(fastgetobsp,ExceptionWrongArguments,PyExc_ValueError,ExceptionUndefined,PyExc_RuntimeError)
+
+extern int getmpirank();
+extern int getmpisize();
+
+extern void fastgetobsp(double *numarray,long length,long samples,double stime,LISA *lisa,double *numarray,long length,char *observables,double inittime = 0.0,long chunk = 16,int threads = 1);
+
+%pythoncode %{
+def getobsp(snum,stime,lisa,catalog,observables,zerotime=0.0,chunk=16,threads=1):
+    """getobsp(snum,stime,lisa,catalog,observables,zerotime=0.0,chunk=16,threads=1)
+    returns the (snum,observables) array computed by fastgetobsp on
+    rank 0, and None on the other MPI ranks."""
+
+    nobs = len(observables.replace(',',' ').split())
+
+    array = numpy.zeros((snum,nobs),dtype='d')
+    fastgetobsp(array,snum,stime,lisa,numpy.asarray(catalog,dtype='d'),observables,zerotime,chunk,threads)
+
+    if getmpirank() == 0:
+        if nobs == 1:
+            return array[:,0]
+        else:
+            return array
+    else:
+        return None
+%}
+
+%feature("docstring") InjectionCache "
+InjectionCache(lisa,samples,stime,observables,inittime=0,directory=None)
+keeps the TDI responses of the GalacticBinary sources in a catalog
+(rows as for fastgetobsp) for the comma-separated observables,
+sampled at inittime + i*stime, and their running total. Since the
+responses are linear in the sources, editing the catalog only
+computes the sources that are new; an amplitude change rescales the
+stored response. If directory is given, responses are stored there
+(one file per source) rather than in memory, and are reused by later
+caches with the same sampling, observables, and LISA geometry (the
+file names and headers carry a fingerprint of the LISA class and of
+its armlengths and positions, so other geometries do not match).
+
+InjectionCache.add(catalog) and InjectionCache.remove(catalog) add
+and remove the sources in catalog (which must have been added);
+InjectionCache.update(catalog) makes the total correspond to the
+full catalog, adding and removing only the differences.
+
+InjectionCache.gettotal(buffer) copies the total into the numpy
+array buffer of shape (samples,observables); InjectionCache.rebuild()
+recomputes it from the stored responses, clearing roundoff after
+many edits.
+
+InjectionCache.getsources() returns the number of sources in the
+total; getcomputed(), getloaded(), and getrescaled() return the
+number of responses computed, read from disk, and rescaled."
+
+initdoc(InjectionCache)
+
+exceptionhandle(InjectionCache::InjectionCache,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle2(InjectionCache::add,ExceptionWrongArguments,PyExc_ValueError,ExceptionFileError,PyExc_IOError)
+exceptionhandle2(InjectionCache::remove,ExceptionWrongArguments,PyExc_ValueError,ExceptionFileError,PyExc_IOError)
+exceptionhandle2(InjectionCache::update,ExceptionWrongArguments,PyExc_ValueError,ExceptionFileError,PyExc_IOError)
+exceptionhandle(InjectionCache::rebuild,ExceptionFileError,PyExc_IOError)
+exceptionhandle(InjectionCache::gettotal,ExceptionWrongArguments,PyExc_ValueError)
+
+class InjectionCache {
+ public:
+    InjectionCache(LISA *lisa,long samples,double stime,char *observables,double inittime = 0.0,char *directory = 0);
+    ~InjectionCache();
+
+    void add(double *numarray,long length);
+    void remove(double *numarray,long length);
+    void update(double *numarray,long length);
+
+    void rebuild();
+
+    void gettotal(double *numarray,long length);
+
+    long getsources();
+    long getsamples();
+    int getobservables();
+
+    long getcomputed();
+    long getloaded();
+    long getrescaled();
+};
+
+%feature("docstring") StreamServer "
+StreamServer(signals,stime,samples,inittime=0,queueframes=16) streams
+the list of signals (e.g., [tdi.Xm(),tdi.Ym(),tdi.Zm()]), sampled at
+inittime + i*stime, as a live data source: frames of samples rows are
+computed ahead on a worker thread (up to queueframes of them) and
+published at wall-clock cadence. Each frame is a fixed-size header
+(magic 'SLTD', int observables, int samples, int flags, long long
+frame, long long firstsample, double firsttime, double stime, double
+sendtime) followed by samples*observables doubles, in native byte order.
+The worker thread runs without the Python interpreter lock, so the
+signals must not use Python-based objects (PyLISA, AllPyLISA, PyWave).
+
+StreamServer.serve(address,frames=0,speedup=1,maxlatency=0) publishes
+frames frames (0 for an unending stream, stopped by Ctrl-C) at speedup
+times real time; address is 'unix:<path>' to serve the first client of
+a UNIX socket, or the path of a named pipe (created if needed) or of a
+regular file (truncated). Writes
+block if the reader is slow; with maxlatency > 0, frames not written
+within maxlatency seconds of their due time are dropped. Returns the
+number of frames sent; a later serve() continues the stream.
+
+getsent(), getdropped(), getunderruns() (frames that the worker had
+not computed in time), getmeanlatency(), getmaxlatency(), getjitter()
+(RMS latency deviation, in s) and getdisconnected() describe the last
+serve()."
+
+initdoc(StreamServer)
+
+exceptionhandle(StreamServer::StreamServer,ExceptionWrongArguments,PyExc_ValueError)
+
+%exception StreamServer::serve {
+    try {
+        $action
+    } catch (ExceptionWrongArguments &e) {
+        PyErr_SetString(PyExc_ValueError,"");
+        return NULL;
+    } catch (ExceptionFileError &e) {
+        PyErr_SetString(PyExc_IOError,"");
+        return NULL;
+    } catch (ExceptionOutOfBounds &e) {
+        PyErr_SetString(PyExc_IndexError,"");
+        return NULL;
+    } catch (ExceptionKeyboardInterrupt &e) {
+        PyErr_SetString(PyExc_KeyboardInterrupt,"");
+        return NULL;
+    } catch (ExceptionUndefined &e) {
+        PyErr_SetString(PyExc_RuntimeError,"");
+        return NULL;
+    }
+};
+
+class StreamServer {
+ public:
+    StreamServer(Signal **thesignals,int signals,double stime,long samples,double inittime = 0.0,int queueframes = 16);
+    ~StreamServer();
+
+    long serve(char *address,long frames = 0,double speedup = 1.0,double maxlatency = 0.0);
+
+    long getsent();
+    long getdropped();
+    long getunderruns();
+
+    double getmeanlatency();
+    double getmaxlatency();
+    double getjitter();
+
+    int getdisconnected();
+    long getfirstsample();
+};
+
+%feature("docstring") NarrowbandObs "
+NarrowbandObs(signals,stime,freqs,decimate,inittime=0,halfwidth=8,chunk=4096)
+produces complex-baseband series of the list of signals (e.g.,
+[tdi.Xm(),tdi.Ym(),tdi.Zm()]), sampled at inittime + i*stime, in narrow
+bands around each of the frequencies in the numpy array freqs: every
+sample is mixed with exp(-2 pi i f t), low-passed, and decimated by
+decimate in one streaming pass (the signals are evaluated chunk rows
+at a time, by block when possible), so the full-band series is never
+stored. Output row m is at inittime + m*decimate*stime, and within a
+band x(t) ~ 2 Re[z(t) exp(2 pi i f t)].
+
+The low-pass is a Blackman-windowed sinc of 2*halfwidth*decimate + 1
+taps centered on the output time (halfwidth > 2), with its stopband
+starting at the output Nyquist frequency. The signals are not
+evaluated before inittime (so noises need no extra prebuffer); the
+filter sees zeros there, so the first halfwidth output rows are
+distorted (row 0 sees only half its window). To have full rows from a time T
+on, start at inittime <= T - halfwidth*decimate*stime.
+
+NarrowbandObs.getbands(buffer,samples) fills the numpy array buffer, of
+shape (samples,bands,observables,2), with the real and imaginary parts
+of the next samples rows (see also getnarrowband); getstime() returns
+the output sampling time, getproduced() the index of the next row."
+
+initdoc(NarrowbandObs)
+
+initsave(NarrowbandObs)
+
+exceptionhandle(NarrowbandObs::NarrowbandObs,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle2(NarrowbandObs::getbands,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
+
+class NarrowbandObs {
+ public:
+    NarrowbandObs(Signal **thesignals,int signals,double stime,double *numarray,long length,long decimate,
+                  double inittime = 0.0,int halfwidth = 8,long chunk = 4096);
+    ~NarrowbandObs();
+
+    void getbands(double *numarray,long length,long samples);
+
+    int getobservables();
+    long getbandcount();
+
+    double getstime();
+    long getproduced();
+};
+
+%pythoncode %{
+def getnarrowband(narrowband,snum):
+    """getnarrowband(narrowband,snum) returns the next snum rows of the
+    NarrowbandObs narrowband as a complex numpy array of shape
+    (snum,bands,observables)."""
+
+    array = numpy.zeros((snum,narrowband.getbandcount(),narrowband.getobservables(),2),dtype='d')
+    narrowband.getbands(array,snum)
+
+    return array[...,0] + 1j * array[...,1]
+%}
+
+%feature("docstring") LineTracker "
+LineTracker(signals,stime,freqs,segment,inittime=0,window=0,chunk=4096)
+tracks the complex amplitudes of lines at the frequencies in the numpy
+array freqs (e.g., verification binaries) in the list of signals,
+sampled at inittime + i*stime (evaluated chunk rows at a time, by
+block when possible). Each segment of segment samples is reduced, for
+every line f and signal, to a = (2/sum w) sum w x exp(-2 pi i f t),
+so that A cos(2 pi f t + phi) gives A exp(i phi); w is 1 (window = 0)
+or a Hann window over the segment (window = 1). The sums run as
+Goertzel recursions, vectorized across lines, with O(lines) work per
+sample; nothing but the current segment state is stored.
+
+LineTracker.getamplitudes(buffer,segments) fills the numpy array
+buffer, of shape (segments,lines,observables,2), with the real and
+imaginary parts for the next segments segments (see also
+getlineamplitudes); getsegmenttime() returns the segment duration,
+getproduced() the index of the next segment."
+
+initdoc(LineTracker)
+
+initsave(LineTracker)
+
+exceptionhandle(LineTracker::LineTracker,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle2(LineTracker::getamplitudes,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
+
+class LineTracker {
+ public:
+    LineTracker(Signal **thesignals,int signals,double stime,double *numarray,long length,long segment,
+                double inittime = 0.0,int window = 0,long chunk = 4096);
+    ~LineTracker();
+
+    void getamplitudes(double *numarray,long length,long segments);
+
+    int getobservables();
+    long getlinecount();
+
+    double getsegmenttime();
+    long getproduced();
+};
+
+%pythoncode %{
+def getlineamplitudes(tracker,segments):
+    """getlineamplitudes(tracker,segments) returns the amplitudes of the
+    next segments segments of the LineTracker tracker as a complex numpy
+    array of shape (segments,lines,observables)."""
+
+    array = numpy.zeros((segments,tracker.getlinecount(),tracker.getobservables(),2),dtype='d')
+    tracker.getamplitudes(array,segments)
+
+    return array[...,0] + 1j * array[...,1]
+%}
+
+%feature("docstring") outofcorefft "
+outofcorefft(infile,length,records,outfile,stime,memory=2**28,tmpfile=None)
+computes the full-resolution Fourier transform of the observables in
+the binary file infile without loading them: rows of records doubles,
+back to back (as written for a binary lisaXML TimeSeries, or by
+writebinary, possibly appended in chunks), or in StreamServer frames
+(recognized by their magic; records may then be 0). Frames are placed
+by their firstsample, counted from the first frame in the file, and
+frames missing in between (dropped under maxlatency) are read as
+zeros; frames out of order raise IOError. The first length rows (all
+if 0) are zero-padded to N, the next power of two, and
+transformed by the four-step algorithm, in two passes over blocks that
+fit in about memory bytes, with the intermediate result transposed
+through tmpfile (outfile + '.tmp' by default, removed at the end).
+
+outfile receives N/2 + 1 rows in the lisaXML FrequencySeries layout:
+the frequency k/(N*stime), then the real and imaginary parts of stime *
+sum_n x_n exp(-2 pi i k n/N) for each record. Returns N. See also
+lisaXML.TDISpectraFromFile."
+
+exceptionhandle2(outofcorefft,ExceptionWrongArguments,PyExc_ValueError,ExceptionFileError,PyExc_IOError)
+
+extern long outofcorefft(char *infile,long length,int records,char *outfile,double stime,long memory = 268435456,char *tmpfile = 0);
+
+%feature("docstring") XMLSimulation "
+XMLSimulation(filename) reads the lisaXML simulation description in
+filename and builds its LISA, noise, source, and TDI objects natively,
+in one call (the Python equivalent is readXML(filename) followed by
+getLISAGeometry, getTDInoise, and getLISASources). It understands
+PseudoLISA and OriginalLISA (LISAData), PseudoRandomNoise named pm1,
+pm1s, ..., pdm3, pd3, ..., C1, C1s, ... (NoiseData; noises with the
+same name are summed), and GalacticBinary/SimpleBinary PlaneWaves and
+SampledPlaneWaves with remote binary data (SourceData). The whole file
+is checked before anything is built; all problems are printed, and
+then ValueError is raised (IOError for unreadable or malformed files).
+
+XMLSimulation.getlisa(), gettdinoise(), and gettdisignal() (None
+without sources) return the objects, which belong to the
+XMLSimulation; getnoises() and getsources() count the noises and
+sources read, and getparsetime() and getbuildtime() return the
+seconds spent reading and checking the file, and building the
+objects."
+
+initdoc(XMLSimulation)
+
+exceptionhandle2(XMLSimulation::XMLSimulation,ExceptionWrongArguments,PyExc_ValueError,ExceptionFileError,PyExc_IOError)
+
+// the objects belong to the XMLSimulation, so we keep it alive
+
+%feature("addtofunc") XMLSimulation::getlisa {
+        if val: val.simulation = self
+}
+
+%feature("addtofunc") XMLSimulation::gettdinoise {
+        if val: val.simulation = self
+}
+
+%feature("addtofunc") XMLSimulation::gettdisignal {
+        if val: val.simulation = self
+}
+
+class XMLSimulation {
+ public:
+    XMLSimulation(char *filename);
+    ~XMLSimulation();
+
+    LISA *getlisa();
+    TDInoise *gettdinoise();
+    TDIsignal *gettdisignal();
+
+    int getnoises();
+    int getsources();
+
+    double getparsetime();
+    double getbuildtime();
+};
+
+%feature("docstring") TDIranging "
+TDIranging(y,z,stime,observables='X1,X2,X3',interplen=4,inittime=0.0,maxarm=20.0)
+returns a TDI-ranging engine that estimates armlengths by minimizing
+the residual (laser) noise in the comma-separated TDI observables
+(by default, the second-generation X1, X2, X3). The measurements y
+and z are numpy arrays of shape (samples,6), with columns
+{12,21,23,32,31,13} as for SampledTDI, sampled at inittime + i*stime
+(see getrangingdata); they are copied, and interpolated with Lagrange
+semiwindow interplen. The observables are recorded once as lists of
+delayed measurements, so evaluating a candidate armlength model only
+recomputes the delays.
+
+The model is a numpy array of 12 parameters: the armlengths L0 of arms
+1,2,3,-1,-2,-3 at t = 0 (in s), then their rates dL, with L(t) = L0 +
+dL t. Samples whose delays could reach before the data for armlengths
+up to maxarm are not used.
+
+TDIranging.residual(params) returns the mean over samples of the sum
+of the squared observables; TDIranging.gradient(grad,params) returns
+it and fills grad (12 values) with its derivatives; TDIranging.fit(params,
+iterations=10,fitrates=1,tolerance=1e-10) refines params in place by
+Gauss-Newton iterations (keeping the rates fixed if fitrates = 0), and
+returns the final residual."
+
+initdoc(TDIranging)
+
+initsave(TDIranging)
+
+exceptionhandle(TDIranging::TDIranging,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle2(TDIranging::residual,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
+exceptionhandle2(TDIranging::gradient,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
+exceptionhandle2(TDIranging::fit,ExceptionWrongArguments,PyExc_ValueError,ExceptionOutOfBounds,PyExc_IndexError)
+
+class TDIranging {
+ public:
+    TDIranging(double *numarray,long length,double *numarray,long length,double stime,
+               const char *observables = "X1,X2,X3",int interplen = 4,double inittime = 0.0,double maxarm = 20.0);
+    ~TDIranging();
+
+    double residual(double *numarray,long length);
+    double gradient(double *numarray,long length,double *numarray,long length);
+
+    double fit(double *numarray,long length,int iterations = 10,int fitrates = 1,double tolerance = 1e-10);
+
+    long getfirst();
+    long getlast();
+};
+
+%pythoncode %{
+def getrangingdata(tdi,snum,stime,zerotime=0.0):
+    """getrangingdata(tdi,snum,stime,zerotime=0.0) returns the y and z
+    measurements of the TDI object tdi at times zerotime + i*stime, as
+    two numpy arrays of shape (snum,6) with the columns {12,21,23,32,31,13}
+    expected by TDIranging. All twelve are evaluated in one pass, so
+    that buffered noises are read in time order."""
+
+    names = ['132','231','213','312','321','123']
+    signals = [getattr(tdi,'y' + name)() for name in names] + [getattr(tdi,'z' + name)() for name in names]
+
+    array = numpy.zeros((snum,12),dtype='d')
+    fastgetobs(array,snum,stime,signals,zerotime)
+
+    return array[:,0:6].copy(), array[:,6:12].copy()
+%}
+
+%feature("docstring") Phasemeter "
+Phasemeter(carrier,noise,stime,cicratio=1000,cicorder=4,firratio=8,firlength=256,
+           inittime=0.0,nu0=2.82e14,sdreadout=0.0,seed=0)
+simulates the phasemeters of the twelve y and z measurements: their
+beatnote frequencies (in Hz) are generated at the high sampling time
+stime/(cicratio*firratio), and decimated to the science cadence stime
+by a CIC stage (order cicorder, ratio cicratio) and an FIR stage
+(firlength taps, ratio firratio; the FIR is a Blackman-windowed lowpass
+that compensates the CIC droop, with its stopband starting at the
+output Nyquist frequency, which needs firlength > 5.5*firratio).
+
+The beatnotes sum the y and z of carrier (e.g., a TDIcarrier, in Hz),
+nu0 times the y and z of noise (e.g., a TDInoise, in fractional
+frequency), and a white phase readout noise of one-sided PSD sdreadout
+(in cycles^2/Hz) drawn at the high rate; carrier or noise may be None.
+The models are evaluated once per CIC output and interpolated to the
+high rate. The group delay of the filters is compensated, so row i of
+the output is the beatnote at inittime + i*stime.
+
+Phasemeter.getobs(buffer,samples) fills the numpy array buffer, of
+shape (samples,12), with the next samples of y then z, each with
+columns {12,21,23,32,31,13} (see getphasemeterdata); Phasemeter.reset(
+seed=0) restarts at inittime (the noises of the models must be reset
+as well); Phasemeter.response(f) returns the magnitude of the transfer
+function of the filters at f; Phasemeter.getdelay() their group delay."
+
+initdoc(Phasemeter)
+
+initsave(Phasemeter)
+
+exceptionhandle(Phasemeter::Phasemeter,ExceptionWrongArguments,PyExc_ValueError)
+exceptionhandle(Phasemeter::getobs,ExceptionWrongArguments,PyExc_ValueError)
+
+class Phasemeter {
+ public:
+    Phasemeter(TDI *carrier,TDI *noise,double stime,long cicratio = 1000,int cicorder = 4,long firratio = 8,long firlength = 256,
+               double inittime = 0.0,double nu0 = 2.82e14,double sdreadout = 0.0,unsigned long seed = 0);
+    ~Phasemeter();
+
+    void getobs(double *numarray,long length,long samples);
+
+    void reset(unsigned long seed = 0);
+
+    double response(double f);
+
+    double getdelay();
+    double gethstime();
+};
+
+%pythoncode %{
+def getphasemeterdata(phasemeter,snum):
+    """getphasemeterdata(phasemeter,snum) returns the next snum samples of
+    the Phasemeter phasemeter as two numpy arrays y and z of shape
+    (snum,6), with the columns {12,21,23,32,31,13} expected by
+    TDIranging, and by SampledTDI once each column is wrapped in a
+    SampledSignal (e.g., SampledTDI(lisa,[SampledSignal(y[:,i].copy(),
+    stime,timeoffset=inittime) for i in range(6)],...))."""
+
+    array = numpy.zeros((snum,12),dtype='d')
+    phasemeter.getobs(array,snum)
+
+    return array[:,0:6].copy(), array[:,6:12].copy()
+%}
+
+/* -------- vectorized evaluation -------- */
+
+/* The time-argument methods of Signal, Wave, LISA, and TDI (the named
+   observables) also accept a numpy array of times, regular or not, and
+   return an array of the same shape (with a trailing dimension of 3 for
+   the vectors of putp, putn, putv). The loop runs in C++, through the
+   get... methods above; TDI observables are evaluated through their
+   Signal objects (e.g., tdi.X1()). Scalar arguments go to the original
+   methods as before. */
+
+%pythoncode %{
+import inspect
+
+def _vectorize(method,arraymethod,nargs,components):
+    def vectorized(self,*args):
+        if len(args) == nargs and isinstance(args[-1],numpy.ndarray):
+            times = numpy.asarray(args[-1],dtype='d')
+            values = numpy.zeros(components*times.size,dtype='d')
+
+            arraymethod(self,values,*(args[:-1] + (numpy.ascontiguousarray(times.ravel()),)))
+
+            if components == 1:
+                return values.reshape(times.shape)
+            else:
+                return values.reshape(times.shape + (components,))
+        else:
+            return method(self,*args)
+
+    vectorized.__doc__ = method.__doc__
+    vectorized.__name__ = method.__name__
+
+    return vectorized
+
+def _tdigetvalues(observable):
+    return lambda self,values,times: getattr(self,observable)().getvalues(values,times)
+
+# (class, method, array method, arguments, values per time)
+
+_vectorized = [(Signal,'value',Signal.getvalues,1,1),
+               (Signal,'__call__',Signal.getvalues,1,1),
+               (Wave,'hp',Wave.gethp,1,1),
+               (Wave,'hc',Wave.gethc,1,1),
+               (LISA,'putp',LISA.getp,2,3),
+               (LISA,'putn',LISA.getn,2,3),
+               (LISA,'putv',LISA.getv,2,3),
+               (LISA,'armlength',LISA.getarmlength,2,1),
+               (LISA,'dotarmlength',LISA.getdotarmlength,2,1)]
+
+for _obs in ['alpham','betam','gammam','zetam','alpha1','alpha2','alpha3','zeta1','zeta2','zeta3',
+             'P','E','U','Xm','Ym','Zm','Xmlock1','Xmlock2','Xmlock3','X1','X2','X3',
+             'y123','y231','y312','y321','y132','y213','z123','z231','z312','z321','z132','z213']:
+    _vectorized.append((TDI,_obs,_tdigetvalues(_obs),1,1))
+
+# wrap the methods wherever a proxy class (re)defines them
+
+for _cls in [_c for _c in globals().values() if inspect.isclass(_c)]:
+    for _base,_name,_arraymethod,_nargs,_components in _vectorized:
+        if issubclass(_cls,_base) and _name in _cls.__dict__:
+            setattr(_cls,_name,_vectorize(_cls.__dict__[_name],_arraymethod,_nargs,_components))
+
+del _cls, _base, _name, _arraymethod, _nargs, _components, _obs
+%}
+
+/* -------- pickling -------- */
+
+/* Simulation objects pickle as their configuration, not their state:
+   the constructor arguments kept by initsave (pickled recursively, so
+   that objects shared by several others, such as a LISA or a noise,
+   remain shared), the attributes set from Python (e.g., xmlargs), and
+   the configuration calls listed in initcalls, which are replayed.
+   Unpickling reruns the constructors, so pseudorandom noises restart
+   from their seeds (which the Python noise factories always set
+   explicitly) and ring buffers are empty: the copy reproduces the
+   simulation from the start. Use savestate/loadstate (lisautils) to
+   carry the state of a run. Objects that do not keep their
+   constructor arguments (or that hold Python functions that cannot
+   be pickled) raise pickle.PicklingError. */
+
+%pythoncode %{
+import pickle
+
+def _getinitargs(self):
+    try:
+        return self.__dict__['initargs']
+    except KeyError:
+        raise pickle.PicklingError, "%s does not keep its constructor arguments and cannot be pickled (lisasim-swig.i)." % self.__class__.__name__
+
+def _getconfig(self):
+    return dict([(key,value) for (key,value) in self.__dict__.items() if key not in ('this','thisown','initargs')])
+
+def _setconfig(self,config):
+    initcalls = config.get('initcalls',[])
+
+    self.__dict__.update([(key,value) for (key,value) in config.items() if key != 'initcalls'])
+
+    # replaying the calls records them again in initcalls
+
+    for method,args in initcalls:
+        getattr(self,method)(*args)
+
+def _reduce(self):
+    return (self.__class__,_getinitargs(self),_getconfig(self))
+
+for _cls in [OriginalLISA,ModifiedLISA,CircularRotating,HaloAnalytic,EccentricInclined,ZeroLISA,
+             PyLISA,AllPyLISA,CacheLISA,SampledLISA,EphemerisLISA,CacheLengthLISA,IntegratedLISA,
+             WhiteNoiseSource,SampledSignalSource,FileSignalSource,
+             NoFilter,IntFilter,DiffFilter,BandIntFilter,FIRFilter,IIRFilter,SignalFilter,BlockFilter,
+             NearestInterpolator,LinearInterpolator,LinearExtrapolator,
+             LagrangeInterpolator,DotLagrangeInterpolator,NewLagrangeInterpolator,
+             NoSignal,SumSignal,InterpolatedSignal,CachedSignal,
+             SimpleBinary,GalacticBinary,SimpleMonochromatic,GaussianPulse,SineGaussian,
+             NoiseWave,PyWave,WaveArray,
+             SampledTDI,SampledTDIaccurate,TDIquantize,TDInoise,TDIaccurate,TDIdoppler,TDIcarrier,
+             TDIsignal,TDIbackground,GalacticConfusion,FStatistic,TDIranging,Phasemeter,SpectralTDInoise]:
+    # __reduce__ for new-style classes, the others for classic ones
+
+    _cls.__reduce__ = _reduce
+    _cls.__getinitargs__ = _getinitargs
+    _cls.__getstate__ = _getconfig
+    _cls.__setstate__ = _setconfig
+
+del _cls
+%}
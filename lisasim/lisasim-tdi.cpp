@@ -10,6 +10,7 @@
 
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 
 // in these expressions the order of the delays is physically
 // motivated, but the combination still does not cancel laser
@@ -590,9 +591,37 @@ static void showtime(long maxi,long maxlength,time_t begtime) {
     }
 }
 
-void fastgetobsc(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime) {
+// if all the signals are observables of the same TDI object, ask it
+// for a block evaluator (e.g., TDInoise with a static geometry)
+
+TDIblock *getblockevaluator(Signal **thesignals,int signals,double stime,double inittime) {
+    TDIobservable *obs = new TDIobservable[signals];
+    TDI *tdi = 0;
+
+    for(int j=0;j<signals;j++) {
+        TDIobjectpnt *obj = dynamic_cast<TDIobjectpnt *>(thesignals[j]);
+
+        if(!obj || (tdi && obj->gettdi() != tdi)) {
+            delete [] obs;
+            return 0;
+        }
+
+        tdi = obj->gettdi();
+        obs[j] = obj->getobservable();
+    }
+
+    TDIblock *ret = tdi ? tdi->getblockevaluator(obs,signals,stime,inittime) : 0;
+
+    delete [] obs;
+
+    return ret;
+}
+
+void fastgetobsc(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample) {
     long maxlength = length < samples ? length : samples;
 
+    TDIblock *block = getblockevaluator(thesignals,signals,stime,inittime);
+
     // divide up the cycle into batches of 16384
     const int batchlen = 16384;
     
@@ -603,27 +632,52 @@ void fastgetobsc(double *buffer,long length,long samples,double stime,Signal **t
     fprintf(stderr,"Processing (running enhanced TDI C++ cycle)...");
     fflush(stderr);
 
-    for(int b=0;b<batches;b++) {
-        long mini = b * batchlen;
-        long maxi = (mini + batchlen) < maxlength ? (mini + batchlen) : maxlength;
-
-        for(long i=mini;i<maxi;i++) {
-            double t = inittime + stime * i;
-
-            for(int j=0;j<signals;j++) {
-                buffer[i*signals + j] = thesignals[j]->value(t);
+    try {
+        for(int b=0;b<batches;b++) {
+            long mini = b * batchlen;
+            long maxi = (mini + batchlen) < maxlength ? (mini + batchlen) : maxlength;
+
+            if(block) {
+                block->getobs(&buffer[mini*signals],firstsample + mini,firstsample + maxi);
+            } else {
+                for(long i=mini;i<maxi;i++) {
+                    double t = inittime + stime * (firstsample + i);
+
+                    for(int j=0;j<signals;j++) {
+                        buffer[i*signals + j] = thesignals[j]->value(t);
+                    }
+                }
             }
-        }
 
-        showtime(maxi,maxlength,begtime);
+            showtime(maxi,maxlength,begtime);
+        }
+    } catch (...) {
+        delete block;
+        throw;
     }
+
+    delete block;
 }
 
-void fastgetobs(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime) {
+void fastgetobs(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample) {
     long maxlength = length < samples ? length : samples;
 
-    for(int i=0;i<maxlength;i++) {
-        double t = inittime + stime * i;
+    TDIblock *block = getblockevaluator(thesignals,signals,stime,inittime);
+
+    if(block) {
+        try {
+            block->getobs(buffer,firstsample,firstsample + maxlength);
+        } catch (...) {
+            delete block;
+            throw;
+        }
+
+        delete block;
+        return;
+    }
+
+    for(long i=0;i<maxlength;i++) {
+        double t = inittime + stime * (firstsample + i);
     
         for(int j=0;j<signals;j++) {
             buffer[i*signals + j] = thesignals[j]->value(t);
@@ -631,6 +685,194 @@ void fastgetobs(double *buffer,long length,long samples,double stime,Signal **th
     }
 }
 
+void fastgetlockstep(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,int variants,double inittime,long firstsample) {
+    if(variants < 1 || signals % variants != 0) {
+        std::cerr << "fastgetlockstep(...): cannot split " << signals << " signals into "
+                  << variants << " variants [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    int observables = signals / variants;
+    int width = (2*variants - 1) * observables;
+
+    checkvalues("fastgetlockstep",length,samples,width);
+
+    for(long i=0;i<samples;i++) {
+        double t = inittime + stime * (firstsample + i);
+        double *row = &buffer[i*width];
+
+        for(int j=0;j<signals;j++)
+            row[j] = thesignals[j]->value(t);
+
+        for(int v=1;v<variants;v++)
+            for(int j=0;j<observables;j++)
+                row[signals + (v-1)*observables + j] = row[v*observables + j] - row[j];
+    }
+}
+
+// --- continuation state ---
+
+static const char statemagic[8] = {'S','L','S','T','A','T','E','1'};
+
+/* The state of each distinct TDI object behind the signals is saved
+   once; other signals save their own. The signals must be given in
+   the same order to loadstate, and built with the same parameters. */
+
+static int statetdis(Signal **thesignals,int signals,TDI **tdis,Signal **others) {
+    int ntdis = 0;
+
+    for(int j=0;j<signals;j++) {
+        TDIobject *obj = dynamic_cast<TDIobject *>(thesignals[j]);
+
+        others[j] = 0;
+
+        if(obj) {
+            int seen = 0;
+            for(int k=0;k<ntdis;k++)
+                if(tdis[k] == obj->gettdi()) seen = 1;
+
+            if(!seen) tdis[ntdis++] = obj->gettdi();
+        } else {
+            others[j] = thesignals[j];
+        }
+    }
+
+    return ntdis;
+}
+
+void savestate(char *filename,Signal **thesignals,int signals) {
+    FILE *file = fopen(filename,"wb");
+
+    if(file == NULL) {
+        std::cerr << "savestate(...): cannot open file " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    TDI **tdis = new TDI*[signals];
+    Signal **others = new Signal*[signals];
+
+    try {
+        int ntdis = statetdis(thesignals,signals,tdis,others);
+
+        long count = signals;
+
+        statewrite(file,statemagic,sizeof(statemagic));
+        statewrite(file,&count,sizeof(long));
+
+        for(int k=0;k<ntdis;k++) tdis[k]->writestate(file);
+        for(int j=0;j<signals;j++) if(others[j]) others[j]->writestate(file);
+    } catch (...) {
+        delete [] others; delete [] tdis;
+        fclose(file);
+
+        throw;
+    }
+
+    delete [] others; delete [] tdis;
+
+    if(fclose(file) != 0) {
+        std::cerr << "savestate(...): cannot write file " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+}
+
+void loadstate(char *filename,Signal **thesignals,int signals) {
+    FILE *file = fopen(filename,"rb");
+
+    if(file == NULL) {
+        std::cerr << "loadstate(...): cannot open file " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    TDI **tdis = new TDI*[signals];
+    Signal **others = new Signal*[signals];
+
+    try {
+        int ntdis = statetdis(thesignals,signals,tdis,others);
+
+        char magic[sizeof(statemagic)];
+        stateread(file,magic,sizeof(statemagic));
+
+        if(memcmp(magic,statemagic,sizeof(statemagic))) {
+            std::cerr << "loadstate(...): " << filename << " is not a continuation-state file"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionFileError e;
+            throw e;
+        }
+
+        statecheck(file,signals,"number of signals");
+
+        for(int k=0;k<ntdis;k++) tdis[k]->readstate(file);
+        for(int j=0;j<signals;j++) if(others[j]) others[j]->readstate(file);
+    } catch (...) {
+        delete [] others; delete [] tdis;
+        fclose(file);
+
+        throw;
+    }
+
+    delete [] others; delete [] tdis;
+    fclose(file);
+}
+
+static const double isq2 = 1.0/sqrt(2.0), isq3 = 1.0/sqrt(3.0), isq6 = 1.0/sqrt(6.0);
+
+static const TDIcombination tdicombinations[] = {
+    {"Xm",     {&TDI::Xm,     0, 0}, {1.0, 0.0, 0.0}},
+    {"Ym",     {&TDI::Ym,     0, 0}, {1.0, 0.0, 0.0}},
+    {"Zm",     {&TDI::Zm,     0, 0}, {1.0, 0.0, 0.0}},
+    {"X1",     {&TDI::X1,     0, 0}, {1.0, 0.0, 0.0}},
+    {"X2",     {&TDI::X2,     0, 0}, {1.0, 0.0, 0.0}},
+    {"X3",     {&TDI::X3,     0, 0}, {1.0, 0.0, 0.0}},
+    {"alpham", {&TDI::alpham, 0, 0}, {1.0, 0.0, 0.0}},
+    {"betam",  {&TDI::betam,  0, 0}, {1.0, 0.0, 0.0}},
+    {"gammam", {&TDI::gammam, 0, 0}, {1.0, 0.0, 0.0}},
+    {"zetam",  {&TDI::zetam,  0, 0}, {1.0, 0.0, 0.0}},
+    {"Am",     {&TDI::Xm, &TDI::Ym, &TDI::Zm}, {-isq2, 0.0,       isq2}},
+    {"Em",     {&TDI::Xm, &TDI::Ym, &TDI::Zm}, { isq6, -2.0*isq6, isq6}},
+    {"Tm",     {&TDI::Xm, &TDI::Ym, &TDI::Zm}, { isq3, isq3,      isq3}},
+    {0,        {0, 0, 0},                       {0.0, 0.0, 0.0}}
+};
+
+const TDIcombination *findtdicombination(const char *name) {
+    for(const TDIcombination *comb = tdicombinations;comb->name;comb++)
+        if(!strcmp(comb->name,name)) return comb;
+
+    return 0;
+}
+
+int parsetdicombinations(const char *names,const TDIcombination **combs,int maxcombs) {
+    char *buffer = new char[strlen(names) + 1];
+    strcpy(buffer,names);
+
+    int ret = 0;
+
+    for(char *tok = strtok(buffer,", ");tok;tok = strtok(0,", ")) {
+        if(ret == maxcombs || !(combs[ret] = findtdicombination(tok))) {
+            ret = -1;
+            break;
+        }
+
+        ret++;
+    }
+
+    delete [] buffer;
+
+    return ret;
+}
+
 SampledTDI::SampledTDI(LISA *l,Noise *yijk[6],Noise *zijk[6]) {
     // the convention is {12,21,23,32,31,13}
 
@@ -662,87 +904,62 @@ void SampledTDI::reset(unsigned long seed) {
     }
 }
 
-double SampledTDI::y(int send, int slink, int recv, int ret1, int ret2, int ret3, double t) {
-    return y(send,slink,recv,ret1,ret2,ret3,0,0,0,0,t);
+void SampledTDI::writestate(FILE *file) {
+    for(int craft1 = 1; craft1 <= 3; craft1++) {
+        for(int craft2 = 1; craft2 <= 3; craft2++) {
+            if(craft1 != craft2) {
+                yobj[craft1][craft2]->writestate(file);
+                zobj[craft1][craft2]->writestate(file);
+            }
+        }
+    }
 }
 
-double SampledTDI::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, double t) {
-    return z(send,slink,recv,ret1,ret2,ret3,ret4,0,0,0,0,t);
+void SampledTDI::readstate(FILE *file) {
+    for(int craft1 = 1; craft1 <= 3; craft1++) {
+        for(int craft2 = 1; craft2 <= 3; craft2++) {
+            if(craft1 != craft2) {
+                yobj[craft1][craft2]->readstate(file);
+                zobj[craft1][craft2]->readstate(file);
+            }
+        }
+    }
 }
 
 // can improve precision by calling value with two times
 // (assuming the underlying implementation supports it)
 
-double SampledTDI::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double SampledTDI::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     lisa->newretardtime(t);
-
-    lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     return yobj[send][recv]->value(lisa->retardedtime());
 }
 
-double SampledTDI::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double SampledTDI::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     lisa->newretardtime(t);
-
-    lisa->retard(ret8); lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     return zobj[send][recv]->value(lisa->retardedtime());
 }
 
-double SampledTDIaccurate::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double SampledTDIaccurate::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     lisa->newretardtime(t);
 
     double dopplerfactor = 1.0;
 
-    if(ret7 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret7,t));
-        lisa->retard(ret7);
+    for(int i=ret.size()-1;i>=0;i--) {
+        dopplerfactor *= (1 - lisa->dotarmlength(ret[i],lisa->retardedtime()));
+        lisa->retard(ret[i]);
     }
 
-    if(ret6 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret6,lisa->retardedtime()));
-        lisa->retard(ret6);
-    }
-
-    if(ret5 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret5,lisa->retardedtime()));
-        lisa->retard(ret5);
-    }
-
-    if(ret4 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret4,lisa->retardedtime()));
-        lisa->retard(ret4);
-    }
-
-    if(ret3 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret3,lisa->retardedtime()));
-        lisa->retard(ret3);
-    }
-
-    if(ret2 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret2,lisa->retardedtime()));
-        lisa->retard(ret2);
-    }
-
-    if(ret1 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret1,lisa->retardedtime()));
-        lisa->retard(ret1);
-    }
-
-    // lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    // lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
-
     // return dopplerfactor * yobj[send][recv]->value(t,-lisa->retardation());
     return yobj[send][recv]->value(t,-lisa->retardation());
 }
 
-double SampledTDIaccurate::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double SampledTDIaccurate::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     lisa->newretardtime(t);
-
-    lisa->retard(ret8); lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     return zobj[send][recv]->value(t,-lisa->retardation());
 }
@@ -9,6 +9,7 @@
 
 #include "lisasim-lisa.h"
 #include "lisasim-wave.h"
+#include "lisasim-delay.h"
 
 #include <math.h>
 
@@ -17,6 +18,8 @@
 
 class TDI;
 
+typedef double (TDI::*TDIobservable)(double t);
+
 class TDIobject : public Signal {
  protected:
    TDI *tdi;    
@@ -26,6 +29,8 @@ class TDIobject : public Signal {
     virtual ~TDIobject() {};
         
     virtual double value(double t) = 0;
+
+    TDI *gettdi() { return tdi; };
 };
 
 class TDIobjectpnt : public TDIobject {
@@ -37,6 +42,8 @@ class TDIobjectpnt : public TDIobject {
     ~TDIobjectpnt() {};
     
     double value(double t) { return (tdi->*obs)(t); };
+
+    TDIobservable getobservable() { return obs; };
 };
 
 class timeobject : public Signal {
@@ -46,12 +53,36 @@ class timeobject : public Signal {
     double value(double t) { return t; };
 };
 
+/* Block evaluator for a set of observables of one TDI object, sampled
+   at inittime + i*stime; returned by TDI::getblockevaluator for TDI
+   classes that can do better than evaluating sample by sample. */
+
+class TDIblock {
+ public:
+    virtual ~TDIblock() {};
+
+    // fill buffer with rows first..last-1 (rows of observables)
+
+    virtual void getobs(double *buffer,long first,long last) = 0;
+};
+
 class TDI {
  public:
     TDI() {};
     virtual ~TDI() {};
 
     virtual void reset() {};
+
+    // continuation state of any noises (see lisasim-signal.h), used
+    // by savestate and loadstate below
+
+    virtual void writestate(FILE *file) {};
+    virtual void readstate(FILE *file) {};
+
+    // returns a new block evaluator for these observables, or 0 if
+    // sample-by-sample evaluation is the only option
+
+    virtual TDIblock *getblockevaluator(TDIobservable *obs,int observables,double stime,double inittime) { return 0; };
     
     virtual double alpham(double t);
     TDIobject *alpham() { return new TDIobjectpnt(this,&TDI::alpham); };
@@ -107,11 +138,29 @@ class TDI {
     virtual double X3(double t);
     TDIobject *X3() { return new TDIobjectpnt(this,&TDI::X3); };
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t) { return 0.0; };
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t) { return 0.0; };
+    // the basic observables take their retardations as a DelayChain
+    // (see lisasim-delay.h), of any length; derived classes override
+    // these, and pull in the fixed-argument forms with "using TDI::y"
+
+    virtual double y(int send, int link, int recv, const DelayChain &ret, double t) { return 0.0; };
+    virtual double z(int send, int link, int recv, const DelayChain &ret, double t) { return 0.0; };
+
+    // the fixed-argument forms forward to the DelayChain versions, which
+    // drop the zero (unused) retardations
+
+    double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t) {
+        return y(send,link,recv,DelayChain(ret1,ret2,ret3),t);
+    };
+    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t) {
+        return z(send,link,recv,DelayChain(ret1,ret2,ret3,ret4),t);
+    };
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) { return 0.0; };
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) { return 0.0; };
+    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+        return y(send,link,recv,DelayChain(ret1,ret2,ret3,ret4,ret5,ret6,ret7),t);
+    };
+    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+        return z(send,link,recv,DelayChain(ret1,ret2,ret3,ret4,ret5,ret6,ret7,ret8),t);
+    };
 
     double y123(double t) { return y(1,2,3,0,0,0,0,0,0,0,t); };
     TDIobject *y123() { return new TDIobjectpnt(this,&TDI::y123); };
@@ -147,8 +196,62 @@ class TDI {
     timeobject *t()    { return new timeobject(); };
 };
 
-extern void fastgetobs(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime);
-extern void fastgetobsc(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime);
+/* fastgetobs evaluates the signals at inittime + (firstsample + i)*stime,
+   for i = 0..samples-1; with firstsample = N, it extends a run of N
+   samples exactly, if the signals are in the state they had at its end
+   (they stay so in memory, or may be saved and restored with savestate
+   and loadstate) */
+
+extern void fastgetobs(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample = 0);
+extern void fastgetobsc(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,double inittime,long firstsample = 0);
+
+/* fastgetlockstep evaluates variants sets of signals in lockstep (set v
+   is thesignals[v*observables..(v+1)*observables-1], where observables =
+   signals/variants), all at each time, so that variants built on the
+   same noise objects (e.g., TDInoise, TDIaccurate, and TDIdoppler on
+   different LISA geometries) read the same samples while they are
+   buffered, and noise is generated only once. Each row of buffer holds
+   the variants in order, then their differences from variant 0, for
+   (2*variants - 1)*observables values. */
+
+extern void fastgetlockstep(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,int variants,double inittime,long firstsample = 0);
+
+// a block evaluator for the signals, if they are all observables of a
+// TDI object that has one (see TDI::getblockevaluator); 0 otherwise
+
+extern TDIblock *getblockevaluator(Signal **thesignals,int signals,double stime,double inittime);
+
+// save or restore the state of the signals, and of the TDI objects behind them
+
+extern void savestate(char *filename,Signal **thesignals,int signals);
+extern void loadstate(char *filename,Signal **thesignals,int signals);
+
+/* Named TDI observables, as linear combinations of up to three TDI
+   methods; includes the optimal combinations Am, Em, Tm of Xm, Ym, Zm */
+
+struct TDIcombination {
+    const char *name;
+    double (TDI::*obs[3])(double t);
+    double coeff[3];
+};
+
+// returns 0 if name is not known
+
+extern const TDIcombination *findtdicombination(const char *name);
+
+// parse a comma- or space-separated list of names into combs; returns
+// the number of combinations, or -1 for an unknown name or more than maxcombs
+
+extern int parsetdicombinations(const char *names,const TDIcombination **combs,int maxcombs);
+
+inline double evaltdicombination(TDI *tdi,const TDIcombination *comb,double t) {
+    double acc = 0.0;
+
+    for(int i=0;i<3 && comb->obs[i];i++)
+        acc += comb->coeff[i] * (tdi->*(comb->obs[i]))(t);
+
+    return acc;
+}
 
 class TDIquantize : public TDI {
  private:
@@ -171,21 +274,19 @@ class TDIquantize : public TDI {
     
     virtual ~TDIquantize() {};
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t) {
-    	return quantize(basetdi->y(send, link, recv, ret1, ret2, ret3, t));
-    };
+    using TDI::y;
+    using TDI::z;
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
-    	return quantize(basetdi->y(send, link, recv, ret1, ret2, ret3, ret4, ret5, ret6, ret7, t));
+    virtual double y(int send, int link, int recv, const DelayChain &ret, double t) {
+    	return quantize(basetdi->y(send, link, recv, ret, t));
     };
 
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t) {
-    	return quantize(basetdi->z(send, link, recv, ret1, ret2, ret3, ret4, t));
+    virtual double z(int send, int link, int recv, const DelayChain &ret, double t) {
+    	return quantize(basetdi->z(send, link, recv, ret, t));
     };
 
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
-    	return quantize(basetdi->z(send, link, recv, ret1, ret2, ret3, ret4, ret5, ret6, ret7, ret8, t));
-    };
+    void writestate(FILE *file) { basetdi->writestate(file); };
+    void readstate(FILE *file) { basetdi->readstate(file); };
 };
 
 class SampledTDI : public TDI {
@@ -200,11 +301,14 @@ class SampledTDI : public TDI {
 
     void reset(unsigned long seed = 0);
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t);
+    void writestate(FILE *file);
+    void readstate(FILE *file);
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    using TDI::y;
+    using TDI::z;
+
+    virtual double y(int send, int link, int recv, const DelayChain &ret, double t);
+    virtual double z(int send, int link, int recv, const DelayChain &ret, double t);
 };
 
 class SampledTDIaccurate : public SampledTDI {
@@ -214,8 +318,11 @@ class SampledTDIaccurate : public SampledTDI {
 
     void reset(unsigned long seed = 0);
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    using SampledTDI::y;
+    using SampledTDI::z;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
+    double z(int send, int link, int recv, const DelayChain &ret, double t);
 };
 
 #endif /* _LISASIM_TDI_H_ */
@@ -9,6 +9,8 @@
 
 #include <time.h>
 #include <iostream>
+#include <string.h>
+#include <typeinfo>
 
 // this version takes the parameters of the basic noises and lets us allocate objects as needed
 
@@ -134,6 +136,12 @@ class zLockNoise : public Noise {
 
     double value(double time);
     double value(double tb,double tc);
+
+    // the proof-mass noises are saved by TDInoise; the master laser
+    // noise is only here after locking
+
+    void writestate(FILE *file) { masterc->writestate(file); };
+    void readstate(FILE *file) { masterc->readstate(file); };
 };
 
 inline double zLockNoise::value(double t) {
@@ -176,6 +184,8 @@ class yLockNoise : public Noise {
     double value(double t);
     double value(double tb,double tc);
 
+    void writestate(FILE *file) { masterc->writestate(file); };
+    void readstate(FILE *file) { masterc->readstate(file); };
 };
 
 inline double yLockNoise::value(double t) {
@@ -287,30 +297,63 @@ void TDInoise::reset(unsigned long seed) {
     if(phlisa != lisa) phlisa->reset();
 }
 
+// continuation state of all the noises (including lock wrappers), in
+// the same order as reset()
+
+void TDInoise::writestate(FILE *file) {
+    for(int craft = 1; craft <= 3; craft++) {
+        pm[craft]->writestate(file);
+        pms[craft]->writestate(file);
+    }
+
+    for(int craft1 = 1; craft1 <= 3; craft1++)
+        for(int craft2 = 1; craft2 <= 3; craft2++)
+            if(craft1 != craft2) shot[craft1][craft2]->writestate(file);
+
+    for(int craft = 1; craft <= 3; craft++) {
+        c[craft]->writestate(file);
+        cs[craft]->writestate(file);
+    }
+}
+
+void TDInoise::readstate(FILE *file) {
+    for(int craft = 1; craft <= 3; craft++) {
+        pm[craft]->readstate(file);
+        pms[craft]->readstate(file);
+    }
+
+    for(int craft1 = 1; craft1 <= 3; craft1++)
+        for(int craft2 = 1; craft2 <= 3; craft2++)
+            if(craft1 != craft2) shot[craft1][craft2]->readstate(file);
+
+    for(int craft = 1; craft <= 3; craft++) {
+        c[craft]->readstate(file);
+        cs[craft]->readstate(file);
+    }
+}
+
 // this is a debugging function, which appears in lisasim-swig.i
 
 double retardation(LISA *lisa,int ret1,int ret2,int ret3,int ret4,int ret5,int ret6,int ret7,int ret8,double t) {
+    return retardation(lisa,DelayChain(ret1,ret2,ret3,ret4,ret5,ret6,ret7,ret8),t);
+}
+
+double retardation(LISA *lisa,const DelayChain &ret,double t) {
     lisa->newretardtime(t);
 
-    lisa->retard(ret8); lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     return lisa->retardedtime();
 }
 
-double TDInoise::y(int send, int slink, int recv, int ret1, int ret2, int ret3, double t) {
-    return y(send,slink,recv,ret1,ret2,ret3,0,0,0,0,t);
-}
-
-double TDInoise::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double TDInoise::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
 
     lisa->newretardtime(t);
 
-    lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     double retardedtime = lisa->retardedtime();
 
@@ -337,20 +380,14 @@ double TDInoise::y(int send, int slink, int recv, int ret1, int ret2, int ret3,
         }
     } catch (ExceptionOutOfBounds &e) {
 		std::cerr << "TDInoise::y(" << send << "," << slink << "," << recv
-		          << "," << ret1 << "," << ret2 << "," << ret3 << "," << ret4
-		          << "," << ret5 << "," << ret6 << "," << ret7
-		          << ") : could not get noise (OutOfBounds) at time "
+		          << "," << ret << ") : could not get noise (OutOfBounds) at time "
 		          << t << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
 		
 		throw e;
 	}
 }
 
-double TDInoise::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, double t) {
-    return z(send,slink,recv,ret1,ret2,ret3,ret4,0,0,0,0,t);
-}
-
-double TDInoise::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double TDInoise::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -358,8 +395,7 @@ double TDInoise::z(int send, int slink, int recv, int ret1, int ret2, int ret3,
 
     lisa->newretardtime(t);
 
-    lisa->retard(ret8); lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     double retardedtime = lisa->retardedtime();
 
@@ -375,9 +411,7 @@ double TDInoise::z(int send, int slink, int recv, int ret1, int ret2, int ret3,
         }
     } catch (ExceptionOutOfBounds &e) {
 		std::cerr << "TDInoise::z(" << send << "," << slink << "," << recv
-		          << "," << ret1 << "," << ret2 << "," << ret3 << "," << ret4
-		          << "," << ret5 << "," << ret6 << "," << ret7 << "," << ret8
-		          << ") : could not get noise (OutOfBounds) at time "
+		          << "," << ret << ") : could not get noise (OutOfBounds) at time "
 		          << t << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
 		
 		throw e;
@@ -447,15 +481,14 @@ TDInoise *stdnoise(LISA *mylisa) {
 }
 
 
-double TDIaccurate::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double TDIaccurate::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
 
     lisa->newretardtime(t);
 
-    lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     double retardation = -lisa->retardation();
 
@@ -485,7 +518,7 @@ double TDIaccurate::y(int send, int slink, int recv, int ret1, int ret2, int ret
     }
 }
 
-double TDIaccurate::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double TDIaccurate::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -493,8 +526,7 @@ double TDIaccurate::z(int send, int slink, int recv, int ret1, int ret2, int ret
 
     lisa->newretardtime(t);
 
-    lisa->retard(ret8); lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     double retardation = -lisa->retardation();
 
@@ -528,7 +560,7 @@ double TDIaccurate::z(int send, int slink, int recv, int ret1, int ret2, int ret
     lfs[3] = laserfreqs[5];
 }; */
 
-double TDIdoppler::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double TDIdoppler::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -536,39 +568,9 @@ double TDIdoppler::y(int send, int slink, int recv, int ret1, int ret2, int ret3
     lisa->newretardtime(t);
     double dopplerfactor = 1.0;
 
-    if(ret7 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret7,t));
-        lisa->retard(ret7);
-    }
-
-    if(ret6 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret6,lisa->retardedtime()));
-        lisa->retard(ret6);
-    }
-
-    if(ret5 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret5,lisa->retardedtime()));
-        lisa->retard(ret5);
-    }
-
-    if(ret4 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret4,lisa->retardedtime()));
-        lisa->retard(ret4);
-    }
-
-    if(ret3 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret3,lisa->retardedtime()));
-        lisa->retard(ret3);
-    }
-
-    if(ret2 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret2,lisa->retardedtime()));
-        lisa->retard(ret2);
-    }
-
-    if(ret1 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret1,lisa->retardedtime()));
-        lisa->retard(ret1);
+    for(int i=ret.size()-1;i>=0;i--) {
+        dopplerfactor *= (1 - lisa->dotarmlength(ret[i],lisa->retardedtime()));
+        lisa->retard(ret[i]);
     }
 
     double retardation = -lisa->retardation();
@@ -596,7 +598,7 @@ double TDIdoppler::y(int send, int slink, int recv, int ret1, int ret2, int ret3
     }
 }
 
-double TDIdoppler::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double TDIdoppler::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -605,46 +607,11 @@ double TDIdoppler::z(int send, int slink, int recv, int ret1, int ret2, int ret3
     lisa->newretardtime(t);
     double dopplerfactor = 1.0;
 
-    if(ret8 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret8,t));
-        lisa->retard(ret8);
-    }
-
-    if(ret7 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret7,lisa->retardedtime()));
-        lisa->retard(ret7);
-    }
-
-    if(ret6 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret6,lisa->retardedtime()));
-        lisa->retard(ret6);
-    }
-
-    if(ret5 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret5,lisa->retardedtime()));
-        lisa->retard(ret5);
-    }
-
-    if(ret4 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret4,lisa->retardedtime()));
-        lisa->retard(ret4);
-    }
-
-    if(ret3 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret3,lisa->retardedtime()));
-        lisa->retard(ret3);
+    for(int i=ret.size()-1;i>=0;i--) {
+        dopplerfactor *= (1 - lisa->dotarmlength(ret[i],lisa->retardedtime()));
+        lisa->retard(ret[i]);
     }
 
-    if(ret2 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret2,lisa->retardedtime()));
-        lisa->retard(ret2);
-    }
-
-    if(ret1 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret1,lisa->retardedtime()));
-        lisa->retard(ret1);
-    }
-    
     double retardation = -lisa->retardation();
 
     if( (link == 3 && recv == 1) || (link == 2 && recv == 3) || (link == 1 && recv == 2)) {
@@ -676,7 +643,7 @@ TDIcarrier::TDIcarrier(LISA *mylisa,double *laserfreqs)
     lfs[3] = laserfreqs[5];    
 };
 
-double TDIcarrier::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double TDIcarrier::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -684,39 +651,9 @@ double TDIcarrier::y(int send, int slink, int recv, int ret1, int ret2, int ret3
     lisa->newretardtime(t);
     double dopplerfactor = 1.0;
 
-    if(ret7 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret7,t));
-        lisa->retard(ret7);
-    }
-
-    if(ret6 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret6,lisa->retardedtime()));
-        lisa->retard(ret6);
-    }
-
-    if(ret5 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret5,lisa->retardedtime()));
-        lisa->retard(ret5);
-    }
-
-    if(ret4 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret4,lisa->retardedtime()));
-        lisa->retard(ret4);
-    }
-
-    if(ret3 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret3,lisa->retardedtime()));
-        lisa->retard(ret3);
-    }
-
-    if(ret2 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret2,lisa->retardedtime()));
-        lisa->retard(ret2);
-    }
-
-    if(ret1 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret1,lisa->retardedtime()));
-        lisa->retard(ret1);
+    for(int i=ret.size()-1;i>=0;i--) {
+        dopplerfactor *= (1 - lisa->dotarmlength(ret[i],lisa->retardedtime()));
+        lisa->retard(ret[i]);
     }
 
     if( (link == 3 && recv == 1) || (link == 2 && recv == 3) || (link == 1 && recv == 2)) {
@@ -730,7 +667,7 @@ double TDIcarrier::y(int send, int slink, int recv, int ret1, int ret2, int ret3
     }
 }
 
-double TDIcarrier::z(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t) {
+double TDIcarrier::z(int send, int slink, int recv, const DelayChain &ret, double t) {
     int link = abs(slink);
 
     // this recursive retardation procedure assumes smart TDI...
@@ -739,53 +676,1282 @@ double TDIcarrier::z(int send, int slink, int recv, int ret1, int ret2, int ret3
     lisa->newretardtime(t);
     double dopplerfactor = 1.0;
 
-    if(ret8 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret8,t));
-        lisa->retard(ret8);
+    for(int i=ret.size()-1;i>=0;i--) {
+        dopplerfactor *= (1 - lisa->dotarmlength(ret[i],lisa->retardedtime()));
+        lisa->retard(ret[i]);
+    }
+
+    if( (link == 3 && recv == 1) || (link == 2 && recv == 3) || (link == 1 && recv == 2)) {
+        // cyclic combination
+
+        return dopplerfactor * ( lfs[recv] - lf[recv] );
+    } else {
+        // anticyclic combination
+
+        return dopplerfactor * ( lf[recv] - lfs[recv] );
+    }
+}
+
+// --- StaticTDInoise ---
+
+TDIblock *TDInoise::getblockevaluator(TDIobservable *obs,int observables,double stime,double inittime) {
+    if(lisa->isstatic() && phlisa->isstatic())
+        return new StaticTDInoise(this,obs,observables,stime,inittime);
+    else
+        return 0;
+}
+
+// the eighteen noise slots of a TDInoise, in a fixed order
+
+static int tdinoiseslots(TDInoise *tdi,Noise **slot[18]) {
+    int slots = 0;
+
+    for(int craft=1;craft<=3;craft++) {
+        slot[slots++] = &tdi->pm[craft];
+        slot[slots++] = &tdi->pms[craft];
+        slot[slots++] = &tdi->c[craft];
+        slot[slots++] = &tdi->cs[craft];
+
+        for(int other=1;other<=3;other++)
+            if(other != craft) slot[slots++] = &tdi->shot[craft][other];
+    }
+
+    return slots;
+}
+
+/* Stands in for a TDInoise noise while StaticTDInoise extracts its
+   filters: logs the times of all reads, and returns one if the time
+   is target and active is set, zero otherwise. */
+
+class ProbeNoise : public Noise {
+ public:
+    double *reads;
+    int nreads, maxreads, logging;
+
+    int active;
+    double target;
+
+    ProbeNoise() : nreads(0), maxreads(16), logging(0), active(0), target(0.0) {
+        reads = new double[maxreads];
+    };
+
+    ~ProbeNoise() {
+        delete [] reads;
+    };
+
+    double value(double t) {
+        if(logging) {
+            if(nreads == maxreads) {
+                double *newreads = new double[2*maxreads];
+                for(int i=0;i<nreads;i++) newreads[i] = reads[i];
+
+                delete [] reads;
+                reads = newreads; maxreads *= 2;
+            }
+
+            reads[nreads++] = t;
+        }
+
+        return (active && t == target) ? 1.0 : 0.0;
+    };
+};
+
+StaticTDInoise::StaticTDInoise(TDInoise *tdi,TDIobservable *obs,int obsn,double st,double inittime)
+    : observables(obsn), stime(st), sources(0) {
+    // the eighteen noise slots of TDInoise, replaced by probes while we
+    // find out which noises each observable reads, when, and with what
+    // coefficient (TDInoise is linear in the noises, up to offset[j],
+    // which is nonzero for TDIcarrier)
+
+    Noise **slot[18];
+    int slots = tdinoiseslots(tdi,slot);
+
+    Noise *saved[18];
+    ProbeNoise probe[18];
+
+    for(int s=0;s<slots;s++) {
+        saved[s] = *slot[s];
+        *slot[s] = &probe[s];
+    }
+
+    offset = new double[observables];
+
+    terms = new int[observables];
+    term = new StaticTDIterm*[observables];
+    for(int j=0;j<observables;j++) {
+        terms[j] = 0;
+        term[j] = 0;
+    }
+
+    try {
+        for(int j=0;j<observables;j++) {
+            for(int s=0;s<slots;s++) {
+                probe[s].nreads = 0;
+                probe[s].logging = 1;
+            }
+
+            offset[j] = (tdi->*obs[j])(inittime);
+
+            int reads = 0;
+            for(int s=0;s<slots;s++) {
+                probe[s].logging = 0;
+                reads += probe[s].nreads;
+            }
+
+            term[j] = new StaticTDIterm[reads > 0 ? reads : 1];
+
+            for(int s=0;s<slots;s++) {
+                for(int r=0;r<probe[s].nreads;r++) {
+                    double t = probe[s].reads[r];
+
+                    int seen = 0;
+                    for(int q=0;q<r;q++)
+                        if(probe[s].reads[q] == t) seen = 1;
+                    if(seen) continue;
+
+                    probe[s].active = 1; probe[s].target = t;
+                    double coeff = (tdi->*obs[j])(inittime) - offset[j];
+                    probe[s].active = 0;
+
+                    if(coeff != 0.0) {
+                        term[j][terms[j]].noise = saved[s];
+                        term[j][terms[j]].time = t;
+                        term[j][terms[j]].coeff = coeff;
+
+                        terms[j]++;
+                    }
+                }
+            }
+        }
+    } catch (...) {
+        for(int s=0;s<slots;s++) *slot[s] = saved[s];
+
+        for(int j=0;j<observables;j++) delete [] term[j];
+        delete [] term; delete [] terms; delete [] offset;
+
+        throw;
+    }
+
+    for(int s=0;s<slots;s++) *slot[s] = saved[s];
+
+    // move the reads of interpolated noises whose sampling time divides
+    // stime into sparse filters on their sources (one source per slot
+    // at most); the remaining terms are read directly
+
+    source = new StaticTDIsource[slots];
+
+    int opaque = 0;
+
+    for(int j=0;j<observables;j++) {
+        int kept = 0;
+
+        for(int i=0;i<terms[j];i++) {
+            StaticTDIterm &raw = term[j][i];
+            InterpolatedSignal *interp = raw.noise->getinterpolated();
+
+            long step = 0;
+            if(interp) {
+                double ratio = stime / interp->getsamplingtime();
+                step = long(floor(ratio + 0.5));
+
+                if(step < 1 || fabs(ratio - step) > 1.0e-9 * ratio) step = 0;
+            }
+
+            if(!step) {
+                term[j][kept++] = raw;
+                continue;
+            }
+
+            int k;
+            for(k=0;k<sources;k++)
+                if(source[k].source == interp->getsource() && source[k].step == step) break;
+
+            if(k == sources) {
+                source[k].source = interp->getsource();
+                source[k].step = step;
+
+                source[k].taps = new int[observables];
+                source[k].maxtaps = new int[observables];
+                source[k].index = new long*[observables];
+                source[k].weight = new double*[observables];
+
+                for(int o=0;o<observables;o++) {
+                    source[k].taps[o] = 0;
+                    source[k].maxtaps[o] = 0;
+                    source[k].index[o] = 0;
+                    source[k].weight[o] = 0;
+                }
+
+                source[k].history = 0;
+
+                sources++;
+            }
+
+            long first;
+            double weights[64];
+            int n = interp->getweights(raw.time,first,weights,64);
+
+            for(int w=0;w<n;w++)
+                addtap(source[k],j,first + w,raw.coeff * weights[w]);
+        }
+
+        terms[j] = kept;
+        opaque += kept;
+    }
+
+    // if noises are read directly, they may share sources with the
+    // filters, so we must advance through the sources row by row to
+    // stay within their buffers
+
+    blocklength = opaque ? 1 : 4096;
+    acc = new double[blocklength];
+
+    // drop the taps that cancelled (e.g., laser noise in X), and find
+    // the range of indices read by each source at row 0
+
+    for(int k=0;k<sources;k++) {
+        StaticTDIsource &src = source[k];
+
+        src.lo = 0; src.hi = -1;
+
+        for(int j=0;j<observables;j++) {
+            int kept = 0;
+
+            for(int t=0;t<src.taps[j];t++) {
+                if(src.weight[j][t] == 0.0) continue;
+
+                long index = src.index[j][t];
+
+                if(src.hi < src.lo) {
+                    src.lo = src.hi = index;
+                } else {
+                    if(index < src.lo) src.lo = index;
+                    if(index > src.hi) src.hi = index;
+                }
+
+                src.index[j][kept] = index;
+                src.weight[j][kept] = src.weight[j][t];
+                kept++;
+            }
+
+            src.taps[j] = kept;
+        }
+
+        // the history holds up to a few blocks, and is compacted when full
+
+        src.histlength = 0;
+        src.histfirst = src.lo;
+
+        if(src.hi >= src.lo)
+            src.history = new double[(src.hi - src.lo + 1) + 4 * blocklength * src.step];
     }
+}
 
-    if(ret7 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret7,lisa->retardedtime()));
-        lisa->retard(ret7);
+StaticTDInoise::~StaticTDInoise() {
+    for(int k=0;k<sources;k++) {
+        for(int j=0;j<observables;j++) {
+            delete [] source[k].index[j];
+            delete [] source[k].weight[j];
+        }
+
+        delete [] source[k].taps;
+        delete [] source[k].maxtaps;
+        delete [] source[k].index;
+        delete [] source[k].weight;
+
+        delete [] source[k].history;
     }
 
-    if(ret6 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret6,lisa->retardedtime()));
-        lisa->retard(ret6);
+    delete [] source;
+
+    for(int j=0;j<observables;j++) delete [] term[j];
+    delete [] term;
+    delete [] terms;
+
+    delete [] offset;
+    delete [] acc;
+}
+
+void StaticTDInoise::addtap(StaticTDIsource &src,int obs,long index,double weight) {
+    for(int t=0;t<src.taps[obs];t++) {
+        if(src.index[obs][t] == index) {
+            src.weight[obs][t] += weight;
+            return;
+        }
     }
 
-    if(ret5 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret5,lisa->retardedtime()));
-        lisa->retard(ret5);
+    if(src.taps[obs] == src.maxtaps[obs]) {
+        int newmax = src.maxtaps[obs] ? 2 * src.maxtaps[obs] : 16;
+
+        long *newindex = new long[newmax];
+        double *newweight = new double[newmax];
+
+        for(int t=0;t<src.taps[obs];t++) {
+            newindex[t] = src.index[obs][t];
+            newweight[t] = src.weight[obs][t];
+        }
+
+        delete [] src.index[obs];
+        delete [] src.weight[obs];
+
+        src.index[obs] = newindex;
+        src.weight[obs] = newweight;
+        src.maxtaps[obs] = newmax;
+    }
+
+    src.index[obs][src.taps[obs]] = index;
+    src.weight[obs][src.taps[obs]] = weight;
+    src.taps[obs]++;
+}
+
+void StaticTDInoise::getobs(double *buffer,long first,long last) {
+    for(long n0=first;n0<last;n0+=blocklength) {
+        long n1 = (n0 + blocklength < last) ? n0 + blocklength : last;
+        long rows = n1 - n0;
+
+        // bring the source histories up to date, reading each sample once
+
+        for(int k=0;k<sources;k++) {
+            StaticTDIsource &src = source[k];
+
+            if(!src.history) continue;
+
+            long need0 = src.lo + n0 * src.step;
+            long need1 = src.hi + (n1 - 1) * src.step;
+            long capacity = (src.hi - src.lo + 1) + 4 * blocklength * src.step;
+
+            if(need0 < src.histfirst || need0 > src.histfirst + src.histlength) {
+                // not contiguous with what we have (e.g., rows out of order)
+
+                src.histfirst = need0;
+                src.histlength = 0;
+            } else if(need1 - src.histfirst + 1 > capacity) {
+                long drop = need0 - src.histfirst;
+
+                memmove(src.history,src.history + drop,(src.histlength - drop) * sizeof(double));
+
+                src.histfirst = need0;
+                src.histlength -= drop;
+            }
+
+            for(long i=src.histfirst + src.histlength;i<=need1;i++)
+                src.history[src.histlength++] = (*src.source)[i];
+        }
+
+        for(int j=0;j<observables;j++) {
+            for(long i=0;i<rows;i++) acc[i] = offset[j];
+
+            for(int k=0;k<sources;k++) {
+                StaticTDIsource &src = source[k];
+                long step = src.step;
+
+                for(int t=0;t<src.taps[j];t++) {
+                    double weight = src.weight[j][t];
+                    double *hist = src.history + (src.index[j][t] + n0 * step - src.histfirst);
+
+                    for(long i=0;i<rows;i++)
+                        acc[i] += weight * hist[i * step];
+                }
+            }
+
+            for(int t=0;t<terms[j];t++) {
+                StaticTDIterm &trm = term[j][t];
+
+                for(long i=0;i<rows;i++)
+                    acc[i] += trm.coeff * trm.noise->value(trm.time + (n0 + i) * stime);
+            }
+
+            for(long i=0;i<rows;i++)
+                buffer[(n0 - first + i) * observables + j] = acc[i];
+        }
+    }
+}
+
+// --- EnsembleTDInoise ---
+
+/* The read log shared by the probes of EnsembleTDInoise: with target =
+   -1, reads are logged (slot and time) and return zero; with target =
+   k, the k-th read returns one, and the others zero, so the observable
+   returns the coefficient of that read. */
+
+class EnsembleTDIlog {
+ public:
+    int *slot;
+    double *time;
+    int count, capacity, target, call;
+
+    EnsembleTDIlog() : count(0), capacity(64), target(-1), call(0) {
+        slot = new int[capacity];
+        time = new double[capacity];
+    };
+
+    ~EnsembleTDIlog() {
+        delete [] time;
+        delete [] slot;
+    };
+
+    double read(int s,double t) {
+        if(target == -1) {
+            if(count == capacity) {
+                int *newslot = new int[2*capacity];
+                double *newtime = new double[2*capacity];
+
+                for(int i=0;i<count;i++) {
+                    newslot[i] = slot[i];
+                    newtime[i] = time[i];
+                }
+
+                delete [] slot; delete [] time;
+                slot = newslot; time = newtime; capacity *= 2;
+            }
+
+            slot[count] = s;
+            time[count] = t;
+            count++;
+
+            return 0.0;
+        } else {
+            return (call++ == target) ? 1.0 : 0.0;
+        }
+    };
+};
+
+class EnsembleProbe : public Noise {
+ public:
+    EnsembleTDIlog *log;
+    int slot;
+
+    EnsembleProbe(EnsembleTDIlog *l,int s) : log(l), slot(s) {};
+
+    double value(double t) { return log->read(slot,t); };
+};
+
+static const int ensembleweights = 64;
+
+// kind of laser lock of a noise slot (see TDInoise::lock): 0 (none), 1 (zLockNoise), or 2 (yLockNoise)
+
+static int ensemblelock(Noise *n) {
+    if(dynamic_cast<zLockNoise *>(n)) return 1;
+    if(dynamic_cast<yLockNoise *>(n)) return 2;
+
+    return 0;
+}
+
+/* whether two noises in the same slot are locked alike, and either not
+   interpolated or interpolated with the same weights (same interpolator,
+   sampling time, prebuffer, and normalization) */
+
+static int ensemblematch(Noise *n0,Noise *n1,double inittime) {
+    if(ensemblelock(n0) != ensemblelock(n1)) return 0;
+
+    InterpolatedSignal *i0 = n0->getinterpolated(), *i1 = n1->getinterpolated();
+
+    if(!i0 || !i1) return (!i0 && !i1);
+
+    if(i0->getsamplingtime() != i1->getsamplingtime()) return 0;
+
+    for(int p=0;p<3;p++) {
+        double t = inittime + (0.5 + 0.13 * p) * i0->getsamplingtime();
+
+        long f0, f1;
+        double w0[ensembleweights], w1[ensembleweights];
+
+        int c0 = i0->getweights(t,f0,w0,ensembleweights);
+        int c1 = i1->getweights(t,f1,w1,ensembleweights);
+
+        if(c0 != c1 || f0 != f1) return 0;
+
+        for(int w=0;w<c0;w++)
+            if(w0[w] != w1[w]) return 0;
     }
 
-    if(ret4 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret4,lisa->retardedtime()));
-        lisa->retard(ret4);
+    return 1;
+}
+
+EnsembleTDInoise::EnsembleTDInoise(TDInoise **tdis,int k,TDIobservable *o,int obsn,double st,double it)
+    : tdi(tdis[0]), realizations(k), observables(obsn), stime(st), inittime(it),
+      calls(0), reads(0), coeff(0), first(0), count(0), weights(0), offset(0), acc(0) {
+    // the coefficients of the reads are extracted once, so they must not
+    // change with time (they do for TDIdoppler); the delays are those of
+    // the first realization, so all must share its LISA objects
+
+    int compatible = (realizations > 0 && observables > 0 && dynamic_cast<TDIdoppler *>(tdi) == 0);
+
+    Noise **slot0[18], **rslot[18];
+    int nslots = compatible ? tdinoiseslots(tdi,slot0) : 0;
+
+    for(int r=1;r<realizations && compatible;r++) {
+        if(typeid(*tdis[r]) != typeid(*tdi) || tdis[r]->lisa != tdi->lisa || tdis[r]->phlisa != tdi->phlisa) {
+            compatible = 0;
+            break;
+        }
+
+        tdinoiseslots(tdis[r],rslot);
+
+        for(int s=0;s<nslots && compatible;s++)
+            if(!ensemblematch(*slot0[s],*rslot[s],inittime)) compatible = 0;
     }
 
-    if(ret3 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret3,lisa->retardedtime()));
-        lisa->retard(ret3);
+    if(!compatible) {
+        std::cerr << "EnsembleTDInoise::EnsembleTDInoise(...): need realizations of the same TDInoise class,"
+                  << " other than TDIdoppler, on the same LISA and physical LISA, with the same laser locking"
+                  << " and noise interpolation [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
     }
 
-    if(ret2 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret2,lisa->retardedtime()));
-        lisa->retard(ret2);
+    obs = new TDIobservable[observables];
+    for(int j=0;j<observables;j++) obs[j] = o[j];
+
+    log = new EnsembleTDIlog();
+
+    slots = tdinoiseslots(tdi,slot);
+
+    for(int s=0;s<slots;s++) {
+        slotdata[s].noise = new Noise*[realizations];
+        slotdata[s].interp = 0;
+        slotdata[s].source = 0;
+        slotdata[s].history = 0;
+        slotdata[s].tap = 0;
+        slotdata[s].histfirst = slotdata[s].histlength = slotdata[s].capacity = 0;
+
+        probe[s] = new EnsembleProbe(log,s);
     }
 
-    if(ret1 != 0) {
-        dopplerfactor *= (1 - lisa->dotarmlength(ret1,lisa->retardedtime()));
-        lisa->retard(ret1);
+    for(int r=0;r<realizations;r++) {
+        tdinoiseslots(tdis[r],rslot);
+
+        for(int s=0;s<slots;s++) slotdata[s].noise[r] = *rslot[s];
     }
-    
-    if( (link == 3 && recv == 1) || (link == 2 && recv == 3) || (link == 1 && recv == 2)) {
-        // cyclic combination
 
-        return dopplerfactor * ( lfs[recv] - lf[recv] );
-    } else {
-        // anticyclic combination
+    // interpolated slots (alike in all realizations, as checked above)
+    // are read through their sources
 
-        return dopplerfactor * ( lf[recv] - lfs[recv] );
+    for(int s=0;s<slots;s++) {
+        EnsembleTDIslot &sd = slotdata[s];
+
+        InterpolatedSignal *interp = sd.noise[0]->getinterpolated();
+
+        if(interp) {
+            sd.interp = interp;
+
+            sd.source = new SignalSource*[realizations];
+            for(int r=0;r<realizations;r++)
+                sd.source[r] = sd.noise[r]->getinterpolated()->getsource();
+        }
+    }
+
+    calls = new int[observables];
+    coeff = new double*[observables];
+    for(int j=0;j<observables;j++) {
+        calls[j] = 0;
+        coeff[j] = 0;
+    }
+
+    install();
+
+    try {
+        for(int j=0;j<observables;j++) {
+            extract(j,inittime);
+            reads += calls[j];
+        }
+    } catch (...) {
+        restore();
+        release();
+
+        throw;
+    }
+
+    restore();
+
+    first = new long[reads > 0 ? reads : 1];
+    count = new int[reads > 0 ? reads : 1];
+    weights = new double[(reads > 0 ? reads : 1) * ensembleweights];
+
+    offset = new double[observables];
+    acc = new double[realizations];
+}
+
+EnsembleTDInoise::~EnsembleTDInoise() {
+    release();
+}
+
+void EnsembleTDInoise::release() {
+    delete [] acc;
+    delete [] offset;
+
+    delete [] weights;
+    delete [] count;
+    delete [] first;
+
+    for(int j=0;j<observables;j++) delete [] coeff[j];
+    delete [] coeff;
+    delete [] calls;
+
+    for(int s=0;s<slots;s++) {
+        delete probe[s];
+
+        delete [] slotdata[s].tap;
+        delete [] slotdata[s].history;
+        delete [] slotdata[s].source;
+        delete [] slotdata[s].noise;
+    }
+
+    delete log;
+    delete [] obs;
+}
+
+void EnsembleTDInoise::install() {
+    for(int s=0;s<slots;s++) *slot[s] = probe[s];
+}
+
+void EnsembleTDInoise::restore() {
+    for(int s=0;s<slots;s++) *slot[s] = slotdata[s].noise[0];
+}
+
+// with the probes installed, log the reads of observable j and
+// target each in turn to find its coefficient
+
+void EnsembleTDInoise::extract(int j,double t) {
+    log->target = -1;
+    log->count = 0;
+
+    double off = (tdi->*obs[j])(t);
+
+    calls[j] = log->count;
+    coeff[j] = new double[calls[j] > 0 ? calls[j] : 1];
+
+    for(int c=0;c<calls[j];c++) {
+        log->target = c;
+        log->call = 0;
+
+        coeff[j][c] = (tdi->*obs[j])(t) - off;
+    }
+
+    log->target = -1;
+}
+
+/* Make the history of a slot cover source indices lo..hi, reading
+   each sample of each realization once; it is compacted (dropping the
+   samples before lo) when full, and grown (with tap) if still too
+   short. */
+
+void EnsembleTDInoise::update(EnsembleTDIslot &sd,long lo,long hi) {
+    const int K = realizations;
+
+    if(!sd.history || lo < sd.histfirst || lo > sd.histfirst + sd.histlength) {
+        // not contiguous with what we have (e.g., rows out of order)
+
+        sd.histfirst = lo;
+        sd.histlength = 0;
+    } else if(hi - sd.histfirst + 1 > sd.capacity) {
+        long drop = lo - sd.histfirst;
+
+        memmove(sd.history,sd.history + drop * K,(sd.histlength - drop) * K * sizeof(double));
+
+        sd.histfirst = lo;
+        sd.histlength -= drop;
+    }
+
+    if(hi - sd.histfirst + 1 > sd.capacity) {
+        long newcapacity = (hi - sd.histfirst + 1) + 4096;
+        double *newhistory = new double[newcapacity * K];
+
+        if(sd.histlength > 0)
+            memcpy(newhistory,sd.history,sd.histlength * K * sizeof(double));
+
+        delete [] sd.history;
+        sd.history = newhistory;
+
+        delete [] sd.tap;
+        sd.tap = new double[newcapacity];
+
+        sd.capacity = newcapacity;
+    }
+
+    for(long i=sd.histfirst + sd.histlength;i<=hi;i++) {
+        double *row = sd.history + sd.histlength * K;
+
+        for(int r=0;r<K;r++) row[r] = (*sd.source[r])[i];
+
+        sd.histlength++;
+    }
+}
+
+void EnsembleTDInoise::getobs(double *buffer,long firstrow,long lastrow) {
+    const int K = realizations;
+    const int width = K * observables;
+
+    install();
+
+    try {
+        for(long row=firstrow;row<lastrow;row++) {
+            double t = inittime + row * stime;
+
+            // log the reads of the first realization at this time; the
+            // probes return zero, so the observables return their offset
+
+            log->target = -1;
+            log->count = 0;
+
+            for(int j=0;j<observables;j++) {
+                int before = log->count;
+
+                offset[j] = (tdi->*obs[j])(t);
+
+                if(log->count - before != calls[j]) {
+                    std::cerr << "EnsembleTDInoise::getobs(...): observable " << j << " changed its reads at time "
+                              << t << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+                    ExceptionWrongArguments e;
+                    throw e;
+                }
+            }
+
+            // interpolation weights, once per read, and the range of
+            // source indices needed for each slot
+
+            for(int s=0;s<slots;s++) {
+                slotdata[s].lo = 0;
+                slotdata[s].hi = -1;
+            }
+
+            for(int j=0,r=0;j<observables;j++) {
+                for(int c=0;c<calls[j];c++,r++) {
+                    EnsembleTDIslot &sd = slotdata[log->slot[r]];
+
+                    count[r] = 0;
+                    if(!sd.interp || coeff[j][c] == 0.0) continue;
+
+                    count[r] = sd.interp->getweights(log->time[r],first[r],&weights[r*ensembleweights],ensembleweights);
+
+                    long lo = first[r], hi = first[r] + count[r] - 1;
+
+                    if(sd.hi < sd.lo) {
+                        sd.lo = lo; sd.hi = hi;
+                    } else {
+                        if(lo < sd.lo) sd.lo = lo;
+                        if(hi > sd.hi) sd.hi = hi;
+                    }
+                }
+            }
+
+            for(int s=0;s<slots;s++)
+                if(slotdata[s].interp && slotdata[s].hi >= slotdata[s].lo)
+                    update(slotdata[s],slotdata[s].lo,slotdata[s].hi);
+
+            // accumulate all the realizations at once
+
+            double *out = &buffer[(row - firstrow) * width];
+
+            for(int j=0,r=0;j<observables;j++) {
+                for(int k=0;k<K;k++) acc[k] = offset[j];
+
+                for(int s=0;s<slots;s++)
+                    if(slotdata[s].interp)
+                        for(long i=0;i<=slotdata[s].hi - slotdata[s].lo;i++) slotdata[s].tap[i] = 0.0;
+
+                // merge the weights of reads of the same samples, so
+                // that cancelling terms (e.g., laser noise) cancel exactly
+
+                for(int c=0;c<calls[j];c++,r++) {
+                    double cf = coeff[j][c];
+                    if(cf == 0.0) continue;
+
+                    EnsembleTDIslot &sd = slotdata[log->slot[r]];
+
+                    if(sd.interp) {
+                        const double *w = &weights[r*ensembleweights];
+
+                        for(int i=0;i<count[r];i++)
+                            sd.tap[first[r] + i - sd.lo] += cf * w[i];
+                    } else {
+                        for(int k=0;k<K;k++) acc[k] += cf * sd.noise[k]->value(log->time[r]);
+                    }
+                }
+
+                for(int s=0;s<slots;s++) {
+                    EnsembleTDIslot &sd = slotdata[s];
+                    if(!sd.interp) continue;
+
+                    for(long i=0;i<=sd.hi - sd.lo;i++) {
+                        const double cw = sd.tap[i];
+                        if(cw == 0.0) continue;
+
+                        const double *hist = sd.history + (sd.lo + i - sd.histfirst) * K;
+
+                        for(int k=0;k<K;k++) acc[k] += cw * hist[k];
+                    }
+                }
+
+                for(int k=0;k<K;k++) out[k*observables + j] = acc[k];
+            }
+        }
+    } catch (...) {
+        restore();
+        throw;
+    }
+
+    restore();
+}
+
+void fastgetensemble(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,int realizations,double inittime,long firstsample) {
+    if(realizations < 1 || signals % realizations != 0) {
+        std::cerr << "fastgetensemble(...): cannot split " << signals << " signals into "
+                  << realizations << " realizations [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    checkvalues("fastgetensemble",length,samples,signals);
+
+    int observables = signals / realizations;
+
+    TDInoise **tdis = new TDInoise*[realizations];
+    TDIobservable *obs = new TDIobservable[observables];
+
+    int ok = 1;
+
+    for(int r=0;r<realizations && ok;r++) {
+        for(int j=0;j<observables && ok;j++) {
+            TDIobjectpnt *obj = dynamic_cast<TDIobjectpnt *>(thesignals[r*observables + j]);
+            TDInoise *tdi = obj ? dynamic_cast<TDInoise *>(obj->gettdi()) : 0;
+
+            if(!tdi || (j > 0 && tdi != tdis[r]) || (r > 0 && obj->getobservable() != obs[j])) {
+                ok = 0;
+                break;
+            }
+
+            tdis[r] = tdi;
+            if(r == 0) obs[j] = obj->getobservable();
+        }
+    }
+
+    if(!ok) {
+        std::cerr << "fastgetensemble(...): each realization must give the same observables"
+                  << " of one TDInoise object [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete [] obs;
+        delete [] tdis;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    try {
+        // when every realization has a static geometry, the FIR filters
+        // of StaticTDInoise are faster, one realization at a time
+
+        TDIblock **blocks = new TDIblock*[realizations];
+
+        int allstatic = 1;
+
+        for(int r=0;r<realizations;r++) {
+            try {
+                blocks[r] = allstatic ? tdis[r]->getblockevaluator(obs,observables,stime,inittime) : 0;
+            } catch (...) {
+                for(int q=0;q<r;q++) delete blocks[q];
+                delete [] blocks;
+                throw;
+            }
+
+            if(!blocks[r]) allstatic = 0;
+        }
+
+        if(allstatic) {
+            double *rows = new double[samples * observables];
+
+            for(int r=0;r<realizations;r++) {
+                try {
+                    blocks[r]->getobs(rows,firstsample,firstsample + samples);
+                } catch (...) {
+                    for(int q=0;q<realizations;q++) delete blocks[q];
+                    delete [] blocks;
+                    delete [] rows;
+                    throw;
+                }
+
+                for(long i=0;i<samples;i++)
+                    for(int j=0;j<observables;j++)
+                        buffer[i*signals + r*observables + j] = rows[i*observables + j];
+            }
+
+            delete [] rows;
+        }
+
+        for(int r=0;r<realizations;r++) delete blocks[r];
+        delete [] blocks;
+
+        if(!allstatic) {
+            EnsembleTDInoise block(tdis,realizations,obs,observables,stime,inittime);
+
+            block.getobs(buffer,firstsample,firstsample + samples);
+        }
+    } catch (...) {
+        delete [] obs;
+        delete [] tdis;
+
+        throw;
+    }
+
+    delete [] obs;
+    delete [] tdis;
+}
+
+// --- SpectralTDInoise ---
+
+SpectralTDInoise::SpectralTDInoise(TDInoise *t,char *observablenames,double st,double it,long blocklength,int v,
+                                   double sdproof,double sdshot,double sdlaser,unsigned long seed)
+    : BlockColoredNoise(blocklength), tdi(t), stime(st), inittime(it), vary(v) {
+
+    const TDIcombination *parsed[64];
+
+    observables = parsetdicombinations(observablenames,parsed,64);
+
+    if(observables <= 0 || blocklength < 16 || (blocklength & (blocklength - 1)) != 0 || !(stime > 0.0)) {
+        std::cerr << "SpectralTDInoise::SpectralTDInoise(...): need known observables ('" << observablenames
+                  << "'), a positive stime, and a blocklength that is a power of two (at least 16)"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    // the CSD treats every noise slot as independent, which locked lasers are not
+
+    Noise **slot[18];
+    int slots = tdinoiseslots(tdi,slot);
+
+    for(int s=0;s<slots;s++) {
+        if(ensemblelock(*slot[s])) {
+            std::cerr << "SpectralTDInoise::SpectralTDInoise(...): cannot model laser locking (zLockNoise, yLockNoise)"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+    }
+
+    combs = new const TDIcombination*[observables];
+    for(int j=0;j<observables;j++) combs[j] = parsed[j];
+
+    // noise slots come in sixes per spacecraft (see tdinoiseslots):
+    // proof mass, laser, optical path, two each
+
+    level[0] = sdproof;
+    level[1] = sdlaser;
+    level[2] = sdshot;
+
+    reads = new int[observables];
+    rslot = new int*[observables];
+    rdelay = new double*[observables];
+    rcoeff = new double*[observables];
+    rphase = new double*[observables];
+
+    for(int j=0;j<observables;j++) {
+        reads[j] = 0;
+        rslot[j] = 0; rdelay[j] = 0; rcoeff[j] = 0; rphase[j] = 0;
+    }
+
+    factor = new double[2 * observables * observables * (half + 1)];
+
+    allocateblocks();
+
+    deviates = new WhiteNoiseSource(1024,seed);
+
+    try {
+        extract(inittime);
+        cholesky();
+    } catch (...) {
+        release();
+        throw;
+    }
+
+    start();
+}
+
+SpectralTDInoise::~SpectralTDInoise() {
+    release();
+}
+
+void SpectralTDInoise::release() {
+    delete deviates;
+
+    delete [] factor;
+
+    for(int j=0;j<observables;j++) {
+        delete [] rslot[j];
+        delete [] rdelay[j];
+        delete [] rcoeff[j];
+        delete [] rphase[j];
+    }
+
+    delete [] rphase;
+    delete [] rcoeff;
+    delete [] rdelay;
+    delete [] rslot;
+    delete [] reads;
+
+    delete [] combs;
+}
+
+// find the reads of each observable at time t, with the TDInoise
+// noises replaced by probes (as for EnsembleTDInoise)
+
+void SpectralTDInoise::extract(double t) {
+    Noise **slot[18];
+    int slots = tdinoiseslots(tdi,slot);
+
+    EnsembleTDIlog log;
+    EnsembleProbe *probe[18];
+    Noise *saved[18];
+
+    for(int s=0;s<slots;s++) {
+        probe[s] = new EnsembleProbe(&log,s);
+
+        saved[s] = *slot[s];
+        *slot[s] = probe[s];
+    }
+
+    try {
+        for(int j=0;j<observables;j++) {
+            log.target = -1;
+            log.count = 0;
+
+            double offset = evaltdicombination(tdi,combs[j],t);
+
+            int calls = log.count;
+
+            delete [] rslot[j]; delete [] rdelay[j]; delete [] rcoeff[j]; delete [] rphase[j];
+
+            rslot[j] = new int[calls > 0 ? calls : 1];
+            rdelay[j] = new double[calls > 0 ? calls : 1];
+            rcoeff[j] = new double[calls > 0 ? calls : 1];
+            rphase[j] = new double[4 * (calls > 0 ? calls : 1)];
+
+            reads[j] = 0;
+
+            for(int c=0;c<calls;c++) {
+                log.target = c;
+                log.call = 0;
+
+                double coeff = evaltdicombination(tdi,combs[j],t) - offset;
+
+                if(coeff != 0.0) {
+                    rslot[j][reads[j]] = log.slot[c];
+                    rdelay[j][reads[j]] = t - log.time[c];
+                    rcoeff[j][reads[j]] = coeff;
+
+                    reads[j]++;
+                }
+            }
+        }
+    } catch (...) {
+        for(int s=0;s<slots;s++) {
+            *slot[s] = saved[s];
+            delete probe[s];
+        }
+
+        throw;
+    }
+
+    for(int s=0;s<slots;s++) {
+        *slot[s] = saved[s];
+        delete probe[s];
+    }
+}
+
+/* The transfer function H_js(f) = sum coeff exp(-2 pi i f delay), over
+   the reads of noise s by observable j, into h (observables x 18
+   complex). With exact = 0, the phase factor of each read is advanced
+   from its value at f - df, which saves the trigonometry when sweeping
+   through the frequencies of a block. */
+
+void SpectralTDInoise::transfer(double f,double df,int exact,double *h) {
+    for(int i=0;i<2*18*observables;i++) h[i] = 0.0;
+
+    for(int j=0;j<observables;j++) {
+        for(int r=0;r<reads[j];r++) {
+            double *ph = &rphase[j][4*r];
+
+            if(exact) {
+                double phase = -2.0 * M_PI * f * rdelay[j][r];
+
+                ph[0] = cos(phase); ph[1] = sin(phase);
+                ph[2] = cos(-2.0 * M_PI * df * rdelay[j][r]); ph[3] = sin(-2.0 * M_PI * df * rdelay[j][r]);
+            } else {
+                double re = ph[0]*ph[2] - ph[1]*ph[3];
+
+                ph[1] = ph[0]*ph[3] + ph[1]*ph[2];
+                ph[0] = re;
+            }
+
+            double *hjs = &h[2*(j*18 + rslot[j][r])];
+
+            hjs[0] += rcoeff[j][r] * ph[0];
+            hjs[1] += rcoeff[j][r] * ph[1];
+        }
+    }
+}
+
+/* The CSD at f, C_jk = sum_s S_s(f) H_js(f) conj(H_ks(f)), from the
+   transfer functions h. */
+
+void SpectralTDInoise::csd(double f,const double *h,double *c) {
+    const int n = observables;
+    const double exponent[3] = {-2.0, 0.0, 2.0};
+
+    double psd[3];
+    for(int p=0;p<3;p++) psd[p] = level[p] * pow(f,exponent[p]);
+
+    for(int j=0;j<n;j++) {
+        for(int k=0;k<n;k++) {
+            double re = 0.0, im = 0.0;
+
+            for(int s=0;s<18;s++) {
+                const double *a = &h[2*(j*18 + s)], *b = &h[2*(k*18 + s)];
+                double sp = psd[(s % 6) / 2];
+
+                re += sp * (a[0]*b[0] + a[1]*b[1]);
+                im += sp * (a[1]*b[0] - a[0]*b[1]);
+            }
+
+            c[2*(j*n + k)] = re;
+            c[2*(j*n + k) + 1] = im;
+        }
+    }
+}
+
+/* The Cholesky factors L (C = L L^dagger) of the CSD at the frequencies
+   of the block, scaled so that coloring unit complex deviates gives
+   the right variance per bin (df/2 for a one-sided PSD); directions
+   of (numerically) zero power, where the observables are fully
+   correlated, get zero columns. */
+
+void SpectralTDInoise::cholesky() {
+    const int n = observables;
+    const double df = 1.0 / (2*half * stime);
+
+    double *h = new double[2*18*n];
+    double *c = new double[2*n*n];
+
+    for(long k=0;k<=half;k++) {
+        double *l = &factor[2*n*n*k];
+
+        for(int i=0;i<2*n*n;i++) l[i] = 0.0;
+
+        // no power at DC (the proof-mass PSD diverges) or Nyquist
+
+        if(k == 0 || k == half) continue;
+
+        // recompute the phases exactly every 256 bins, to bound roundoff
+
+        transfer(k * df,df,(k - 1) % 256 == 0,h);
+        csd(k * df,h,c);
+
+        for(int j=0;j<n;j++) {
+            double cjj = 0.5 * df * c[2*(j*n + j)];
+            double d = cjj;
+
+            for(int m=0;m<j;m++) d -= l[2*(j*n + m)]*l[2*(j*n + m)] + l[2*(j*n + m) + 1]*l[2*(j*n + m) + 1];
+
+            if(!(d > 1.0e-12 * cjj)) continue;
+
+            double ljj = sqrt(d);
+            l[2*(j*n + j)] = ljj;
+
+            for(int i=j+1;i<n;i++) {
+                double re = 0.5 * df * c[2*(i*n + j)], im = 0.5 * df * c[2*(i*n + j) + 1];
+
+                for(int m=0;m<j;m++) {
+                    double *a = &l[2*(i*n + m)], *b = &l[2*(j*n + m)];
+
+                    re -= a[0]*b[0] + a[1]*b[1];
+                    im -= a[1]*b[0] - a[0]*b[1];
+                }
+
+                l[2*(i*n + j)] = re / ljj;
+                l[2*(i*n + j) + 1] = im / ljj;
+            }
+        }
+    }
+
+    delete [] c;
+    delete [] h;
+}
+
+void SpectralTDInoise::getcsd(double *buffer,long length,double f,double t) {
+    checkvalues("SpectralTDInoise::getcsd",length,observables*observables,2);
+
+    double *h = new double[2*18*observables];
+
+    extract(t);
+
+    transfer(f,0.0,1,h);
+    csd(f,h,buffer);
+
+    delete [] h;
+}
+
+// color the bins of the next block with the Cholesky factors
+
+void SpectralTDInoise::color() {
+    const int n = observables;
+    const long N = 2*half;
+
+    // complex deviates with unit variance
+
+    const double norm = sqrt(0.5);
+
+    if(vary && block > 0) {
+        extract(inittime + block * half * stime);
+        cholesky();
+    }
+
+    for(long k=1;k<half;k++) {
+        double *l = &factor[2*n*n*k];
+
+        for(int m=0;m<n;m++) {
+            double xr = norm * (*deviates)[deviate++];
+            double xi = norm * (*deviates)[deviate++];
+
+            for(int j=m;j<n;j++) {
+                double *ljm = &l[2*(j*n + m)];
+                double *z = &work[j*2*N];
+
+                z[2*k]     += ljm[0]*xr - ljm[1]*xi;
+                z[2*k + 1] += ljm[0]*xi + ljm[1]*xr;
+            }
+        }
+    }
+}
+
+void SpectralTDInoise::start() {
+    deviate = 0;
+
+    if(vary) {
+        extract(inittime);
+        cholesky();
+    }
+
+    startblocks();
+}
+
+void SpectralTDInoise::reset(unsigned long seed) {
+    deviates->reset(seed);
+
+    start();
+}
+
+void SpectralTDInoise::getobs(double *buffer,long length,long samples) {
+    checkvalues("SpectralTDInoise::getobs",length,samples,observables);
+
+    for(long i=0;i<samples;i++) {
+        const double *u = nextrow();
+
+        for(int j=0;j<observables;j++)
+            buffer[i*observables + j] = u[j];
     }
 }
@@ -19,6 +19,10 @@ class TDInoise : public TDI {
     // set this to one if we are allocating noise objects
 
     int allocated;
+
+    // checks that its realizations share lisa and phlisa
+
+    friend class EnsembleTDInoise;
     
  public:
     // Note: I label shot noises by sending and receiving spacecraft, not by link and receiving
@@ -56,13 +60,22 @@ class TDInoise : public TDI {
 
     void reset(unsigned long seed = 0);
 
-    // basic TDI observables
+    // save and restore the state of all noises, to extend a run
+
+    void writestate(FILE *file);
+    void readstate(FILE *file);
+
+    // basic TDI observables (the fixed-argument forms are inherited from TDI)
+
+    using TDI::y;
+    using TDI::z;
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, double t);
+    virtual double y(int send, int link, int recv, const DelayChain &ret, double t);
+    virtual double z(int send, int link, int recv, const DelayChain &ret, double t);
 
-    virtual double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    virtual double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    // with a static geometry (see LISA::isstatic), returns a StaticTDInoise
+
+    TDIblock *getblockevaluator(TDIobservable *obs,int observables,double stime,double inittime);
 };
 
 
@@ -73,8 +86,11 @@ class TDIaccurate : public TDInoise {
     
     ~TDIaccurate() {};
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    using TDInoise::y;
+    using TDInoise::z;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
+    double z(int send, int link, int recv, const DelayChain &ret, double t);
 };
 
 
@@ -87,8 +103,11 @@ class TDIdoppler : public TDInoise {
         
     ~TDIdoppler() {};
     
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    using TDInoise::y;
+    using TDInoise::z;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
+    double z(int send, int link, int recv, const DelayChain &ret, double t);
 };
 
 class TDIcarrier : public TDInoise {
@@ -100,10 +119,242 @@ class TDIcarrier : public TDInoise {
 
     ~TDIcarrier() {};
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
-    double z(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, int ret8, double t);
+    using TDInoise::y;
+    using TDInoise::z;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
+    double z(int send, int link, int recv, const DelayChain &ret, double t);
+};
+
+/* A sampled noise source read by StaticTDInoise: for observable j,
+   taps[j] weights applied to the source samples at index[j] (for row
+   0; the indices advance by step samples per row). The samples needed
+   by the current block are copied to history, starting at histfirst. */
+
+struct StaticTDIsource {
+    SignalSource *source;
+    long step;
+
+    int *taps, *maxtaps;
+    long **index;
+    double **weight;
+
+    long lo, hi;
+
+    double *history;
+    long histfirst, histlength;
+};
+
+// a noise read directly at time + row*stime, with coefficient coeff
+
+struct StaticTDIterm {
+    Noise *noise;
+    double time, coeff;
+};
+
+
+/** Block evaluator of TDInoise observables for static geometries. With
+    constant armlengths, every observable is a fixed linear combination
+    of the noises read at fixed delays. The combination is extracted
+    once, by replacing the noises with probes that log their reads, and
+    then answering one read at a time. Noises interpolated from sampled
+    sources (PowerLawNoise, SampledSignal, CachedSignal) with a
+    sampling time that divides stime become sparse FIR filters on their
+    samples, since the fractional delays (and so the interpolation
+    weights) are the same for every row; other noises are read directly
+    at the fixed delays. Results agree with sample-by-sample evaluation
+    to roundoff, and use the same noise realizations. */
+
+class StaticTDInoise : public TDIblock {
+ private:
+    int observables;
+    double stime;
+
+    double *offset;
+
+    int sources;
+    StaticTDIsource *source;
+
+    int *terms;
+    StaticTDIterm **term;
+
+    long blocklength;
+    double *acc;
+
+    void addtap(StaticTDIsource &src,int obs,long index,double weight);
+
+ public:
+    StaticTDInoise(TDInoise *tdi,TDIobservable *obs,int observables,double stime,double inittime);
+    ~StaticTDInoise();
+
+    void getobs(double *buffer,long first,long last);
+};
+
+
+/* One of the eighteen TDInoise noise slots in an EnsembleTDInoise: the
+   noise of each realization and, if they are all interpolated alike,
+   their sources with the samples read recently, in structure-of-arrays
+   layout (history[(index - histfirst)*realizations + k]). */
+
+struct EnsembleTDIslot {
+    Noise **noise;
+
+    InterpolatedSignal *interp;
+    SignalSource **source;
+
+    double *history;
+    long histfirst, histlength, capacity;
+
+    // source indices lo..hi read at the current row, and the merged
+    // weights of one observable on them
+
+    long lo, hi;
+    double *tap;
 };
 
+class EnsembleTDIlog;
+
+/** Block evaluator of TDInoise observables for an ensemble of
+    realizations: TDInoise objects of the same class, on the same LISA
+    and physical LISA objects, that differ only by their noises (which
+    must be locked alike, and interpolated alike if at all; otherwise
+    the constructor throws ExceptionWrongArguments). The first
+    realization is read through probes that log, at each time, which
+    noises are read when (the delays); the coefficients of the reads
+    are extracted once (they must not depend on time, as for TDInoise
+    and TDIaccurate, but not TDIdoppler). For noises interpolated from
+    sampled sources, the interpolation weights are computed once per
+    read and applied to the samples of all realizations at once, which
+    are kept side by side so that the inner loops run over
+    realizations; other noises are read one realization at a time.
+    Rows hold the observables of each realization in turn. Results
+    agree with sample-by-sample evaluation to roundoff. */
+
+class EnsembleTDInoise : public TDIblock {
+ private:
+    TDInoise *tdi;
+    int realizations, observables;
+
+    TDIobservable *obs;
+    double stime, inittime;
+
+    // the noise slots of the first realization, where the probes go
+
+    int slots;
+    Noise **slot[18];
+    EnsembleTDIslot slotdata[18];
+
+    EnsembleTDIlog *log;
+    Noise *probe[18];
+
+    // reads and their coefficients, per observable
+
+    int *calls, reads;
+    double **coeff;
+
+    // per-read interpolation windows for the current row
+
+    long *first;
+    int *count;
+    double *weights;
+
+    double *offset, *acc;
+
+    void extract(int j,double t);
+    void update(EnsembleTDIslot &sd,long lo,long hi);
+
+    void install();
+    void restore();
+
+    void release();
+
+ public:
+    EnsembleTDInoise(TDInoise **tdis,int realizations,TDIobservable *obs,int observables,double stime,double inittime);
+    ~EnsembleTDInoise();
+
+    void getobs(double *buffer,long first,long last);
+};
+
+/* fastgetensemble evaluates realizations sets of the same observables
+   of TDInoise objects (set k is thesignals[k*observables..(k+1)*observables-1],
+   where observables = signals/realizations) with an EnsembleTDInoise,
+   filling buffer as fastgetobs would for the same signals; with a
+   static geometry, it uses a StaticTDInoise for each realization. */
+
+extern void fastgetensemble(double *buffer,long length,long samples,double stime,Signal **thesignals,int signals,int realizations,double inittime,long firstsample = 0);
+
+
+/** Gaussian TDI noise synthesized directly from its cross-spectral
+    density (CSD), without generating the eighteen TDInoise noises. The
+    CSD matrix of the observables (any of findtdicombination) is built
+    from the TDI structure of tdi (read once through probes, as for
+    StaticTDInoise: which noises are read, with what delays and
+    coefficients) and from the one-sided PSDs of the TDInoise noises,
+    sdproof/f^2, sdshot f^2, and sdlaser; so the geometry's unequal
+    armlengths, and laser-noise residuals, are included. Each block of
+    blocklength samples (a power of two) is colored in the frequency
+    domain with the Cholesky factor of the CSD at each frequency, and
+    consecutive blocks overlap by half, with sine windows whose squares
+    add to one, so the stream is continuous (see BlockColoredNoise).
+    With vary set, the CSD is
+    recomputed for every block with the armlengths at its center, which
+    follows slowly varying armlengths; otherwise it is computed once at
+    inittime. Frequencies below 1/(blocklength stime) are not
+    represented. Every noise is taken as independent, so a TDInoise
+    with locked lasers (zLockNoise or yLockNoise, see lock()) is
+    rejected with ExceptionWrongArguments. */
+
+class SpectralTDInoise : public BlockColoredNoise {
+ private:
+    TDInoise *tdi;
+
+    const TDIcombination **combs;
+
+    double stime, inittime;
+    int vary;
+
+    double level[3];
+
+    // reads of each observable at the current time: noise slot, delay,
+    // coefficient, and phase factor (and its step) at the current frequency
+
+    int *reads;
+    int **rslot;
+    double **rdelay, **rcoeff, **rphase;
+
+    // Cholesky factors of the CSD for bins 0..half, n x n complex each
+
+    double *factor;
+
+    WhiteNoiseSource *deviates;
+    long deviate;
+
+    void extract(double t);
+    void transfer(double f,double df,int exact,double *h);
+    void csd(double f,const double *h,double *c);
+    void cholesky();
+
+    void start();
+    void color();
+
+    void release();
+
+ public:
+    SpectralTDInoise(TDInoise *tdi,char *observables,double stime,double inittime = 0.0,long blocklength = 65536,int vary = 0,
+                     double sdproof = 2.5e-48,double sdshot = 1.8e-37,double sdlaser = 1.1e-26,unsigned long seed = 0);
+    ~SpectralTDInoise();
+
+    /// Fill csd (observables x observables complex, as re,im pairs) with the one-sided CSD at frequency f and time t.
+    void getcsd(double *csd,long length,double f,double t);
+
+    /// Fill buffer with the next samples rows of observables.
+    void getobs(double *buffer,long length,long samples);
+
+    /// Restart the stream at inittime, with a new seed (0 for the global seed).
+    void reset(unsigned long seed = 0);
+};
+
+
 // return approx lighttime, for estimation of noise buffer size
 
 extern double lighttime(LISA *lisa);
@@ -119,5 +370,6 @@ extern Noise *stdlasernoise(LISA *lisa,double stlaser,double sdlaser,int interp
 extern TDInoise *stdnoise(LISA *mylisa);
 
 extern double retardation(LISA *lisa,int ret1,int ret2,int ret3,int ret4,int ret5,int ret6,int ret7,int ret8,double t);
+extern double retardation(LISA *lisa,const DelayChain &ret,double t);
 
 #endif /* _LISASIM_TDINOISE_H_ */
@@ -63,15 +63,10 @@ double TDIsignal::Phi(int link,double t) {
     return accpsi;
 }
 
-double TDIsignal::y(int send, int slink, int recv, int ret1, int ret2, int ret3, double t) {
-    return y(send,slink,recv,ret1,ret2,ret3,0,0,0,0,t);
-}
-
-double TDIsignal::y(int send, int slink, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t) {
+double TDIsignal::y(int send, int slink, int recv, const DelayChain &ret, double t) {
     lisa->newretardtime(t);
 
-    lisa->retard(ret7); lisa->retard(ret6); lisa->retard(ret5);
-    lisa->retard(ret4); lisa->retard(ret3); lisa->retard(ret2); lisa->retard(ret1);
+    lisa->retard(ret);
 
     double retardedtime = lisa->retardedtime();
 
@@ -35,8 +35,9 @@ class TDIsignal : public TDI {
     double N(double t);
     double O(double t);
 
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, double t);
-    double y(int send, int link, int recv, int ret1, int ret2, int ret3, int ret4, int ret5, int ret6, int ret7, double t);
+    using TDI::y;
+
+    double y(int send, int link, int recv, const DelayChain &ret, double t);
 
     double Phi(int slink,double t);
 };
@@ -175,6 +175,45 @@
    delete [] $1;
 }
 
+// Map a Python sequence into an array of ints (used for DelayChain);
+// pass also the number of elements
+
+%typemap(in) (int *intarray, int intnum) {
+	int i;
+	
+	// check that we are really getting a sequence (list or tuple)
+	
+	if (!PySequence_Check($input)) {
+		PyErr_SetString(PyExc_TypeError,"Expecting a sequence");
+		return NULL;
+	}
+	
+	int dim = PySequence_Size($input);
+	int *temp = new int[dim];
+	
+	// convert each element
+	
+	for (i = 0; i < dim; i++) {
+		PyObject *o = PySequence_GetItem($input,i);
+
+		if(!PyInt_Check(o)) {
+			delete [] temp;
+			PyErr_SetString(PyExc_ValueError,"Expecting a sequence of ints");
+			return NULL;
+		}
+
+		temp[i] = PyInt_AsLong(o);
+	}
+	
+	// return pointer to the array
+	
+	$1 = temp;
+	$2 = dim;}
+
+%typemap(freearg) (int *intarray, int intnum)  {
+   delete [] $1;
+}
+
 %typemap(in) (Signal **thesignals, int signals) {
   int i;
 
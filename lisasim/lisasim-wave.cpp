@@ -89,6 +89,20 @@ void Wave::putwave(Tensor &h, double t) {
   }
 }
 
+void Wave::gethp(double *buffer,long length,double *times,long samples) {
+  checkvalues("Wave::gethp",length,samples);
+
+  for(long i=0;i<samples;i++)
+    buffer[i] = hp(times[i]);
+}
+
+void Wave::gethc(double *buffer,long length,double *times,long samples) {
+  checkvalues("Wave::gethc",length,samples);
+
+  for(long i=0;i<samples;i++)
+    buffer[i] = hc(times[i]);
+}
+
 // static methods to return the basic ep and ec tensors for a given sky
 // position
 
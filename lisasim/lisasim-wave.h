@@ -63,6 +63,11 @@ class Wave : public WaveObject {
     virtual double hp(double t) = 0;
     virtual double hc(double t) = 0;
 
+    // hp(times[i]), hc(times[i]) for i = 0..samples-1 (see checkvalues in lisasim-signal.h)
+
+    void gethp(double *buffer,long length,double *times,long samples);
+    void gethc(double *buffer,long length,double *times,long samples);
+
     void putk(Vector &k);
     void putwave(Tensor &h, double t);
 
@@ -131,6 +136,28 @@ class SimpleMonochromatic : public Wave {
 };
 
 
+// --- HeterodyneWave ---
+
+/* Pure plus (pol = 0) or cross (pol = 1) wave, with cosine (quad = 0)
+   or sine (quad = 1) time dependence at frequency freq, and psi = 0;
+   the TDI responses to the cosine and sine waves are the real and
+   imaginary parts of the response to exp(2 pi i freq t), which gives
+   the complex envelope of the response (used by FStatistic and
+   GalacticConfusion). */
+
+class HeterodyneWave : public Wave {
+ private:
+    double w;
+    int pol, quad;
+
+ public:
+    HeterodyneWave(double freq,int p,int q,double b,double l) : Wave(b,l,0.0), w(2.0*M_PI*freq), pol(p), quad(q) {};
+
+    double hp(double t) { return pol ? 0.0 : (quad ? sin(w*t) : cos(w*t)); };
+    double hc(double t) { return pol ? (quad ? sin(w*t) : cos(w*t)) : 0.0; };
+};
+
+
 // --- GaussianPulse ---
 
 class GaussianPulse : public Wave {
@@ -0,0 +1,250 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-whiten.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+
+#include <math.h>
+#include <string.h>
+
+
+// --- ARNoiseModel ---
+
+// autocorrelation R_k = int_0^fN S(f) cos(2 pi f k deltat) df,
+// by the trapezoidal rule over the rows (f,S) below Nyquist
+
+ARNoiseModel::ARNoiseModel(double *psd,long length,double dt,int ord)
+    : deltat(dt), order(ord) {
+
+    if(length % 2 != 0 || length < 4 || order < 1) {
+        std::cerr << "ARNoiseModel::ARNoiseModel(...): need a two-column PSD array with at least two rows"
+                  << " and a positive order [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    long rows = length / 2;
+    double nyquistf = 0.5 / deltat;
+
+    double *autocorr = new double[order + 1];
+
+    for(int k=0;k<=order;k++) {
+        double acc = 0.0;
+
+        for(long i=0;i<rows-1;i++) {
+            double f0 = psd[2*i], f1 = psd[2*i+2];
+
+            if(f0 >= nyquistf) break;
+
+            acc += 0.5 * (f1 - f0) * (psd[2*i+1] * cos(2.0*M_PI*f0*k*deltat) +
+                                      psd[2*i+3] * cos(2.0*M_PI*f1*k*deltat));
+        }
+
+        autocorr[k] = acc;
+    }
+
+    fit(autocorr);
+
+    delete [] autocorr;
+}
+
+ARNoiseModel::ARNoiseModel(char *observable,double dt,int ord,double proofnoise,double opticalnoise,double armlength)
+    : deltat(dt), order(ord) {
+
+    if(order < 1) {
+        std::cerr << "ARNoiseModel::ARNoiseModel(...): need a positive order"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    // midpoint rule on a grid fine enough for the highest lag
+
+    long bins = 16 * order > 4096 ? 16 * order : 4096;
+    double df = 0.5 / deltat / bins;
+
+    double *autocorr = new double[order + 1];
+    for(int k=0;k<=order;k++) autocorr[k] = 0.0;
+
+    for(long i=0;i<bins;i++) {
+        double f = (i + 0.5) * df;
+        double s = tdipsd(observable,f,proofnoise,opticalnoise,armlength) * df;
+
+        for(int k=0;k<=order;k++)
+            autocorr[k] += s * cos(2.0*M_PI*f*k*deltat);
+    }
+
+    fit(autocorr);
+
+    delete [] autocorr;
+}
+
+ARNoiseModel::~ARNoiseModel() {
+    delete [] a;
+}
+
+// Levinson-Durbin recursion; the zero-lag autocorrelation is loaded
+// slightly to keep the fit well conditioned for PSDs with deep nulls
+
+void ARNoiseModel::fit(double *autocorr) {
+    a = new double[order + 1];
+
+    double *tmp = new double[order + 1];
+
+    double r0 = autocorr[0] * (1.0 + 1.0e-10);
+
+    if(!(r0 > 0.0)) {
+        std::cerr << "ARNoiseModel::fit(...): PSD has no power below Nyquist"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete [] tmp;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    a[0] = 1.0;
+    for(int k=1;k<=order;k++) a[k] = 0.0;
+
+    double err = r0;
+
+    for(int m=1;m<=order;m++) {
+        double acc = autocorr[m];
+        for(int k=1;k<m;k++) acc += a[k] * autocorr[m-k];
+
+        double refl = -acc / err;
+
+        for(int k=1;k<m;k++) tmp[k] = a[k] + refl * a[m-k];
+        for(int k=1;k<m;k++) a[k] = tmp[k];
+
+        a[m] = refl;
+
+        err *= (1.0 - refl*refl);
+    }
+
+    sigma = sqrt(err);
+
+    delete [] tmp;
+}
+
+double ARNoiseModel::psd(double f) {
+    double re = 0.0, im = 0.0;
+
+    for(int k=0;k<=order;k++) {
+        re += a[k] * cos(2.0*M_PI*f*k*deltat);
+        im -= a[k] * sin(2.0*M_PI*f*k*deltat);
+    }
+
+    return 2.0 * deltat * sigma * sigma / (re*re + im*im);
+}
+
+Filter *ARNoiseModel::whitening() {
+    double *w = new double[order + 1];
+
+    for(int k=0;k<=order;k++) w[k] = a[k] / sigma;
+
+    Filter *ret = new FIRFilter(w,order + 1);
+
+    delete [] w;
+
+    return ret;
+}
+
+// IIRFilter computes y_n = sum_i a_i x_{n-i} + sum_{j>0} b_j y_{n-j}
+
+Filter *ARNoiseModel::recoloring() {
+    double s[1] = {sigma};
+    double *b = new double[order + 1];
+
+    b[0] = 0.0;
+    for(int k=1;k<=order;k++) b[k] = -a[k];
+
+    Filter *ret = new IIRFilter(s,1,b,order + 1);
+
+    delete [] b;
+
+    return ret;
+}
+
+// equal-arm expressions from Estabrook, Tinto, and Armstrong,
+// Phys. Rev. D 62, 042002 (2000), with x = 2 pi f L
+
+double ARNoiseModel::tdipsd(char *observable,double f,double proofnoise,double opticalnoise,double armlength) {
+    double x = 2.0 * M_PI * f * armlength;
+
+    double spm = proofnoise / (f*f);
+    double sop = opticalnoise * f*f;
+
+    double sx = (8.0*pow(sin(2.0*x),2) + 32.0*pow(sin(x),2)) * spm + 16.0*pow(sin(x),2) * sop;
+    double sxy = -4.0 * sin(x) * sin(2.0*x) * (sop + 4.0*spm);
+
+    if(!strcmp(observable,"Xm") || !strcmp(observable,"Ym") || !strcmp(observable,"Zm")) {
+        return sx;
+    } else if(!strcmp(observable,"X1") || !strcmp(observable,"X2") || !strcmp(observable,"X3")) {
+        return 4.0 * pow(sin(2.0*x),2) * sx;
+    } else if(!strcmp(observable,"alpham") || !strcmp(observable,"betam") || !strcmp(observable,"gammam")) {
+        return (8.0*pow(sin(1.5*x),2) + 16.0*pow(sin(0.5*x),2)) * spm + 6.0 * sop;
+    } else if(!strcmp(observable,"zetam")) {
+        return 24.0*pow(sin(0.5*x),2) * spm + 6.0 * sop;
+    } else if(!strcmp(observable,"Am") || !strcmp(observable,"Em")) {
+        return sx - sxy;
+    } else if(!strcmp(observable,"Tm")) {
+        return sx + 2.0*sxy;
+    } else {
+        std::cerr << "ARNoiseModel::tdipsd(...): unknown observable " << observable
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+}
+
+
+// --- BlockFilter ---
+
+BlockFilter::BlockFilter(long length,Filter *flt,int col,int cols)
+    : filter(flt), x(length), y(length), column(col), columns(cols), current(0) {
+
+    if(col < 0 || col >= cols) {
+        std::cerr << "BlockFilter::BlockFilter(...): invalid column " << col << " of " << cols
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+
+    // the history must reach back over the whole filter
+
+    if(length <= flt->getorder()) {
+        std::cerr << "BlockFilter::BlockFilter(...): history length " << length << " must exceed the filter order "
+                  << flt->getorder() << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionWrongArguments e;
+        throw e;
+    }
+}
+
+void BlockFilter::reset() {
+    x.reset();
+    y.reset();
+
+    current = 0;
+}
+
+void BlockFilter::apply(double *block,long length) {
+    for(long i=column;i<length;i+=columns,current++) {
+        x.set(current,block[i]);
+
+        double out = filter->getvalue(x,y,current);
+
+        y.set(current,out);
+        block[i] = out;
+    }
+}
@@ -0,0 +1,100 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_WHITEN_H_
+#define _LISASIM_WHITEN_H_
+
+#include "lisasim-signal.h"
+
+/** Autoregressive model of a noise PSD, used to build streaming
+    whitening and recoloring filters. The autocorrelation of the
+    sampled noise is computed from the one-sided PSD, and fitted with
+    an AR(order) process x_n = -sum_k a_k x_{n-k} + sigma e_n
+    (Levinson-Durbin). The whitening filter e_n = (x_n + sum_k a_k
+    x_{n-k}) / sigma is FIR; the recoloring filter is its exact inverse,
+    an all-pole IIR, which is stable because the Levinson-Durbin
+    predictor is minimum phase. Whitened data has unit variance (as
+    WhiteNoiseSource). The PSD can be given as a two-column array
+    (f, S(f)), or as the analytic equal-arm TDI noise (Estabrook,
+    Tinto, and Armstrong 2000) for the standard proof-mass and
+    optical-path noises. */
+
+class ARNoiseModel {
+ private:
+    double deltat;
+
+    int order;
+    double *a;
+    double sigma;
+
+    void fit(double *autocorr);
+
+ public:
+    /// PSD tabulated as rows (f,S), as returned by spect.
+    ARNoiseModel(double *psd,long length,double deltat,int order);
+
+    /// Analytic PSD of TDI observable (Xm, Ym, Zm, X1, X2, X3, alpham, betam, gammam, zetam, Am, Em, Tm).
+    ARNoiseModel(char *observable,double deltat,int order,double proofnoise = 2.5e-48,double opticalnoise = 1.8e-37,double armlength = 16.6782);
+
+    ~ARNoiseModel();
+
+    int getorder() { return order; };
+    double getsigma() { return sigma; };
+
+    /// One-sided PSD of the fitted AR model.
+    double psd(double f);
+
+    /// New whitening (FIR) and recoloring (IIR) filters, for use with SignalFilter or BlockFilter.
+    Filter *whitening();
+    Filter *recoloring();
+
+    /// Analytic one-sided PSD of a TDI observable, as used by the second constructor.
+    static double tdipsd(char *observable,double f,double proofnoise = 2.5e-48,double opticalnoise = 1.8e-37,double armlength = 16.6782);
+};
+
+
+/* Past inputs or outputs of a BlockFilter, presented as a SignalSource
+   so that any Filter can run on them */
+
+class HistorySource : public SignalSource {
+ private:
+    RingBuffer buffer;
+
+ public:
+    HistorySource(long len) : buffer(len) {};
+
+    void reset(unsigned long seed = 0) { buffer.reset(); };
+
+    double operator[](long pos) { return buffer[pos]; };
+    void set(long pos,double value) { buffer[pos] = value; };
+};
+
+
+/** Apply a Filter to successive blocks of samples, in place, keeping
+    the filter state across blocks, so that arbitrarily long streams
+    (e.g., successive getobs blocks) can be processed in bounded memory.
+    The history length must exceed the filter order (see
+    Filter::getorder), or the constructor throws. For 2D arrays of
+    observables (one per column), only column "column" of "columns" is
+    filtered. */
+
+class BlockFilter {
+ private:
+    Filter *filter;
+    HistorySource x, y;
+
+    int column, columns;
+    long current;
+
+ public:
+    BlockFilter(long length,Filter *flt,int column = 0,int columns = 1);
+
+    void reset();
+
+    void apply(double *block,long length);
+};
+
+#endif /* _LISASIM_WHITEN_H_ */
@@ -0,0 +1,952 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#include "lisasim-xmlsim.h"
+#include "lisasim-except.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+static double walltime() {
+    struct timeval tv;
+    gettimeofday(&tv,0);
+
+    return tv.tv_sec + 1.0e-6 * tv.tv_usec;
+}
+
+// append item to an array that is resized as count reaches powers of two
+
+template<class T> static void append(T *&array,int &count,T item) {
+    if((count & (count - 1)) == 0) {
+        T *bigger = new T[count ? 2*count : 1];
+        for(int i=0;i<count;i++) bigger[i] = array[i];
+
+        delete [] array;
+        array = bigger;
+    }
+
+    array[count++] = item;
+}
+
+static char *copystring(const char *s,long n) {
+    char *ret = new char[n+1];
+
+    memcpy(ret,s,n);
+    ret[n] = 0;
+
+    return ret;
+}
+
+
+// --- a minimal XML reader, enough for lisaXML ---
+
+class XMLElement {
+ public:
+    char *tag, *text;
+    long textlength;
+
+    int attributes, children;
+    char **name, **value;
+    XMLElement **child;
+
+    XMLElement(char *t)
+        : tag(t), text(copystring("",0)), textlength(0), attributes(0), children(0), name(0), value(0), child(0) {};
+
+    ~XMLElement() {
+        for(int i=0;i<children;i++) delete child[i];
+        delete [] child;
+
+        for(int i=0;i<attributes;i++) {
+            delete [] value[i];
+            delete [] name[i];
+        }
+        delete [] value;
+        delete [] name;
+
+        delete [] text;
+        delete [] tag;
+    };
+
+    const char *getattribute(const char *attr) {
+        for(int i=0;i<attributes;i++)
+            if(!strcmp(name[i],attr)) return value[i];
+
+        return 0;
+    };
+
+    int is(const char *t,const char *type = 0) {
+        if(strcmp(tag,t)) return 0;
+        if(!type) return 1;
+
+        const char *mytype = getattribute("Type");
+        return mytype && !strcmp(mytype,type);
+    };
+
+    void addtext(const char *s,long n) {
+        char *longer = new char[textlength + n + 1];
+
+        memcpy(longer,text,textlength);
+        memcpy(longer + textlength,s,n);
+        longer[textlength + n] = 0;
+
+        delete [] text;
+        text = longer;
+        textlength += n;
+    };
+};
+
+class XMLParser {
+ private:
+    const char *start, *p;
+
+    void fail(const char *what) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): malformed XML (" << what << ") at byte " << (p - start)
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    };
+
+    void skipspace() {
+        while(*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++;
+    };
+
+    void skippast(const char *end) {
+        const char *found = strstr(p,end);
+        if(!found) fail("unterminated markup");
+
+        p = found + strlen(end);
+    };
+
+    char *readname() {
+        const char *s = p;
+        while(*p && !strchr(" \t\n\r=/>",*p)) p++;
+
+        if(p == s) fail("missing name");
+        return copystring(s,p - s);
+    };
+
+    // decode the predefined entities (others are kept as they are)
+
+    char *decode(const char *s,long n) {
+        static const char *entities[5][2] = {{"&lt;","<"},{"&gt;",">"},{"&amp;","&"},{"&quot;","\""},{"&apos;","'"}};
+
+        char *ret = new char[n+1];
+        long j = 0;
+
+        for(long i=0;i<n;) {
+            int e;
+            for(e=0;e<5;e++) {
+                long len = strlen(entities[e][0]);
+
+                if(i + len <= n && !strncmp(s+i,entities[e][0],len)) {
+                    ret[j++] = entities[e][1][0];
+                    i += len;
+                    break;
+                }
+            }
+
+            if(e == 5) ret[j++] = s[i++];
+        }
+
+        ret[j] = 0;
+        return ret;
+    };
+
+    XMLElement *element() {
+        p++;    // '<'
+
+        XMLElement *el = new XMLElement(readname());
+
+        try {
+            for(;;) {
+                skipspace();
+
+                if(!strncmp(p,"/>",2)) {
+                    p += 2;
+                    return el;
+                } else if(*p == '>') {
+                    p++;
+                    break;
+                } else if(!*p) {
+                    fail("unterminated tag");
+                }
+
+                char *attr = readname();
+
+                skipspace();
+                if(*p != '=') {
+                    delete [] attr;
+                    fail("attribute without value");
+                }
+                p++;
+                skipspace();
+
+                char quote = *p;
+                const char *s = p;
+
+                if(quote == '"' || quote == '\'')
+                    for(s = ++p;*p && *p != quote;p++);
+
+                if((quote != '"' && quote != '\'') || !*p) {
+                    delete [] attr;
+                    fail("unquoted or unterminated attribute");
+                }
+
+                int count = el->attributes;
+                append(el->name,count,attr);
+                append(el->value,el->attributes,decode(s,p - s));
+                p++;
+            }
+
+            // content
+
+            for(;;) {
+                if(!*p) {
+                    fail("unterminated element");
+                } else if(!strncmp(p,"</",2)) {
+                    p += 2;
+                    char *endtag = readname();
+                    int match = !strcmp(endtag,el->tag);
+                    delete [] endtag;
+
+                    if(!match) fail("mismatched end tag");
+
+                    skipspace();
+                    if(*p != '>') fail("malformed end tag");
+                    p++;
+
+                    return el;
+                } else if(!strncmp(p,"<!--",4)) {
+                    skippast("-->");
+                } else if(!strncmp(p,"<![CDATA[",9)) {
+                    const char *s = p + 9;
+                    skippast("]]>");
+                    el->addtext(s,p - 3 - s);
+                } else if(!strncmp(p,"<?",2)) {
+                    skippast("?>");
+                } else if(*p == '<') {
+                    XMLElement *c = element();
+                    append(el->child,el->children,c);
+                } else {
+                    const char *s = p;
+                    while(*p && *p != '<') p++;
+
+                    char *t = decode(s,p - s);
+                    el->addtext(t,strlen(t));
+                    delete [] t;
+                }
+            }
+        } catch (...) {
+            delete el;
+            throw;
+        }
+    };
+
+ public:
+    XMLParser(const char *buffer) : start(buffer), p(buffer) {};
+
+    XMLElement *parse() {
+        // skip the prolog (XML declaration, comments, DOCTYPE)
+
+        for(;;) {
+            skipspace();
+
+            if(!strncmp(p,"<?",2)) {
+                skippast("?>");
+            } else if(!strncmp(p,"<!--",4)) {
+                skippast("-->");
+            } else if(!strncmp(p,"<!",2)) {
+                int depth = 0;
+
+                for(;*p;p++) {
+                    if(*p == '[') depth++;
+                    else if(*p == ']') depth--;
+                    else if(*p == '>' && depth == 0) break;
+                }
+
+                if(!*p) fail("unterminated DOCTYPE");
+                p++;
+            } else if(*p == '<') {
+                return element();
+            } else {
+                fail("no root element");
+            }
+        }
+    };
+};
+
+
+// --- the Params of an XSIL object, with the conversions of convertunit.py ---
+
+// numbers: read n space-separated doubles, and nothing else
+
+static int readnumbers(const char *text,double *x,int n) {
+    char *end;
+
+    for(int i=0;i<n;i++) {
+        x[i] = strtod(text,&end);
+        if(end == text) return 0;
+
+        text = end;
+    }
+
+    while(*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r') text++;
+
+    return *text == 0;
+}
+
+class XMLParams {
+ private:
+    XMLElement *outer, *inner;
+    const char *object;
+    int &errors;
+
+    XMLElement *find(const char *name) {
+        XMLElement *elements[2] = {inner, outer};
+
+        // the Params of a nested TimeSeries take precedence
+
+        for(int e=0;e<2;e++) {
+            if(!elements[e]) continue;
+
+            for(int i=elements[e]->children-1;i>=0;i--) {
+                XMLElement *c = elements[e]->child[i];
+                const char *cname = c->getattribute("Name");
+
+                if(c->is("Param") && cname && !strcmp(cname,name)) return c;
+            }
+        }
+
+        return 0;
+    };
+
+    // convert the value of param to unit; handles Degree/DMS/HMS to
+    // Radian, and assumes the right unit when none is given
+
+    int convert(XMLElement *param,const char *unit,double &x) {
+        const char *unitin = param->getattribute("Unit");
+
+        if(!unitin || !strcmp(unitin,unit)) {
+            return readnumbers(param->text,&x,1);
+        } else if(!strcmp(unit,"Radian")) {
+            double v[3];
+
+            if(!strcmp(unitin,"Degree") && readnumbers(param->text,v,1)) {
+                x = (M_PI/180.0) * v[0];
+                return 1;
+            } else if(!strcmp(unitin,"DMS") && readnumbers(param->text,v,3)) {
+                x = (M_PI/180.0) * (v[0] + v[1]/60.0 + v[2]/3600.0);
+                return 1;
+            } else if(!strcmp(unitin,"HMS") && readnumbers(param->text,v,3)) {
+                x = (15.0*M_PI/180.0) * (v[0] + v[1]/60.0 + v[2]/3600.0);
+                return 1;
+            }
+        }
+
+        complain("cannot read value/unit of parameter",param->getattribute("Name"));
+        return 0;
+    };
+
+ public:
+    XMLParams(XMLElement *el,XMLElement *nested,const char *name,int &err)
+        : outer(el), inner(nested), object(name), errors(err) {};
+
+    void complain(const char *what,const char *name) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): " << what << " " << name << " in object " << object
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        errors++;
+    };
+
+    int has(const char *name) { return find(name) != 0; };
+
+    double get(const char *name,const char *unit) {
+        double x = 0.0;
+        XMLElement *param = find(name);
+
+        if(!param) complain("missing parameter",name);
+        else if(!convert(param,unit,x)) x = 0.0;
+
+        return x;
+    };
+
+    double get(const char *name,const char *unit,double def) {
+        return has(name) ? get(name,unit) : def;
+    };
+
+    // string parameters, without leading and trailing space (0 if missing)
+
+    char *getstring(const char *name) {
+        XMLElement *param = find(name);
+        if(!param) return 0;
+
+        const char *s = param->text;
+        while(*s && strchr(" \t\n\r",*s)) s++;
+
+        long n = strlen(s);
+        while(n > 0 && strchr(" \t\n\r",s[n-1])) n--;
+
+        return copystring(s,n);
+    };
+
+    // SLPolarization from Polarization, ThetaInclination from
+    // Inclination, ecliptic from equatorial coordinates
+
+    double getslpolarization() {
+        if(has("SLPolarization")) return get("SLPolarization","Radian");
+
+        double x = get("Polarization","Radian");
+        return x != 0.0 ? 2.0*M_PI - x : 0.0;
+    };
+
+    double getthetainclination() {
+        if(has("ThetaInclination")) return get("ThetaInclination","Radian");
+
+        double x = get("Inclination","Radian");
+        return x < M_PI ? M_PI - x : 3.0*M_PI - x;
+    };
+
+    void getecliptic(double &beta,double &lambda) {
+        if(has("EclipticLatitude") || !has("RightAscension")) {
+            beta = get("EclipticLatitude","Radian");
+            lambda = get("EclipticLongitude","Radian");
+        } else {
+            double alpha = get("RightAscension","Radian");
+            double delta = get("Declination","Radian");
+
+            // J2000 epoch
+
+            double epsilon = (M_PI/180.0) * 23.439291;
+
+            beta = asin(cos(epsilon) * sin(delta) - sin(epsilon) * cos(delta) * sin(alpha));
+
+            double coslambda = cos(alpha) * cos(delta) / cos(beta);
+            double sinlambda = (sin(delta) - cos(epsilon) * sin(beta)) / (sin(epsilon) * cos(beta));
+
+            lambda = atan2(sinlambda,coslambda);
+            if(lambda < 0.0) lambda += 2.0*M_PI;
+        }
+    };
+
+    // InterpolatorLength, or Interpolator and InterpolatorWindow;
+    // def is used if neither is given, unless required
+
+    int getinterplen(int def,int required) {
+        if(has("InterpolatorLength")) return int(get("InterpolatorLength","1"));
+
+        char *interp = getstring("Interpolator");
+        int ret = def;
+
+        if(!interp) {
+            if(required) complain("missing parameter","InterpolatorLength (or Interpolator)");
+        } else if(!strcmp(interp,"NearestNeighbor")) {
+            ret = 0;
+        } else if(!strcmp(interp,"LinearExtrapolator")) {
+            ret = -1;
+        } else if(!strcmp(interp,"Linear")) {
+            ret = 1;
+        } else if(!strcmp(interp,"Lagrange")) {
+            ret = int(get("InterpolatorWindow","1"));
+            if(ret < 2) complain("need InterpolatorWindow > 1 for","Lagrange");
+        } else {
+            complain("unknown interpolator",interp);
+        }
+
+        delete [] interp;
+        return ret;
+    };
+};
+
+
+// --- simulation specs, checked before anything is built ---
+
+static const char *noisenames[18] = {"pm1","pm1s","pm2","pm2s","pm3","pm3s",
+                                     "pdm3","pd3","pdm1","pd1","pdm2","pd2",
+                                     "C1","C1s","C2","C2s","C3","C3s"};
+
+struct XMLNoiseSpec {
+    int slot;
+    double cadence, prebuffer, psd, exponent;
+    int interplen;
+    unsigned long seed;
+};
+
+struct XMLSourceSpec {
+    int sampled;
+
+    double frequency, phase, inclination, amplitude;
+    double beta, lambda, pol;
+
+    // SampledPlaneWave only
+
+    char *filename;
+    long length, records;
+    int hp, hc, swap;
+    double cadence, prebuffer, norm;
+    int interplen;
+};
+
+static const char *objectname(XMLElement *el) {
+    const char *name = el->getattribute("Name");
+    return name ? name : "(unnamed)";
+}
+
+static void readlisa(XMLElement *el,int &type,double *par,int &errors) {
+    XMLParams params(el,0,objectname(el),errors);
+
+    if(el->is("XSIL","PseudoLISA")) {
+        // InitialEta/InitialXi/ArmSwitch, or InitialPosition/InitialRotation (with ArmSwitch = -1)
+
+        type = 1;
+
+        if(params.has("InitialEta")) {
+            par[0] = params.get("InitialEta","Radian");
+            par[1] = params.get("InitialXi","Radian");
+        } else {
+            double initpos = params.get("InitialPosition","Radian");
+            double initrot = params.get("InitialRotation","Radian");
+
+            par[0] = initpos;
+            par[1] = initrot - initpos + 1.5*M_PI;
+        }
+
+        par[2] = params.get("ArmSwitch","1",-1.0);
+        par[3] = params.get("TimeOffset","Second");
+    } else {
+        type = 0;
+
+        par[0] = params.get("Armlength1","Second",Lstd);
+        par[1] = params.get("Armlength2","Second",Lstd);
+        par[2] = params.get("Armlength3","Second",Lstd);
+    }
+}
+
+static void readnoise(XMLElement *el,XMLNoiseSpec &spec,int &errors) {
+    const char *name = objectname(el);
+    XMLParams params(el,0,name,errors);
+
+    spec.slot = -1;
+    for(int i=0;i<18;i++)
+        if(!strcmp(name,noisenames[i])) spec.slot = i;
+
+    if(spec.slot < 0) params.complain("unknown noise name",name);
+
+    spec.cadence = params.get("Cadence","Second");
+    spec.prebuffer = params.get("TimeOffset","Second");
+    spec.psd = params.get("PowerSpectralDensity","(f/Hz)^n/Hz");
+
+    char *type = params.getstring("SpectralType");
+    spec.exponent = 0.0;
+
+    if(!type)                                  params.complain("missing parameter","SpectralType");
+    else if(!strcmp(type,"WhiteFrequency"))    spec.exponent = 0.0;
+    else if(!strcmp(type,"WhitePhase"))        spec.exponent = 2.0;
+    else if(!strcmp(type,"WhiteAcceleration")) spec.exponent = -2.0;
+    else if(!strcmp(type,"RedAcceleration"))   spec.exponent = -4.0;
+    else                                       spec.exponent = params.get("SpectralType","1");
+
+    delete [] type;
+
+    if(spec.exponent != 0.0 && spec.exponent != 2.0 && spec.exponent != -2.0 && spec.exponent != -4.0)
+        params.complain("unsupported SpectralType for","PseudoRandomNoise");
+
+    spec.interplen = params.getinterplen(1,1);
+    spec.seed = (unsigned long)(params.get("PseudoRandomSeed","1"));
+
+    if(params.has("Cadence") && spec.cadence <= 0.0) params.complain("need positive","Cadence");
+    if(params.has("TimeOffset") && spec.prebuffer < 0.0) params.complain("need nonnegative","TimeOffset");
+    if(params.has("PowerSpectralDensity") && spec.psd < 0.0) params.complain("need nonnegative","PowerSpectralDensity");
+}
+
+static void readsource(XMLElement *el,XMLSourceSpec &spec,const char *directory,int &errors) {
+    const char *name = objectname(el);
+
+    spec.sampled = el->is("XSIL","SampledPlaneWave");
+    spec.filename = 0;
+
+    // a SampledPlaneWave takes parameters also from its first TimeSeries
+
+    XMLElement *series = 0, *array = 0;
+
+    if(spec.sampled) {
+        for(int i=0;i<el->children && !series;i++)
+            if(el->child[i]->is("XSIL","TimeSeries")) series = el->child[i];
+
+        if(series)
+            for(int i=0;i<series->children && !array;i++)
+                if(series->child[i]->is("Array")) array = series->child[i];
+    }
+
+    XMLParams params(el,series,name,errors);
+
+    params.getecliptic(spec.beta,spec.lambda);
+    spec.pol = params.getslpolarization();
+
+    if(!spec.sampled) {
+        char *type = params.getstring("SourceType");
+
+        if(!type)
+            params.complain("need SourceType for","PlaneWave");
+        else if(strcmp(type,"GalacticBinary") && strcmp(type,"SimpleBinary"))
+            params.complain("unsupported SourceType",type);
+
+        delete [] type;
+
+        spec.frequency = params.get("Frequency","Hertz");
+        spec.phase = params.get("InitialPhase","Radian");
+        spec.inclination = params.getthetainclination();
+        spec.amplitude = params.get("Amplitude","1");
+
+        if(params.has("Frequency") && spec.frequency <= 0.0) params.complain("need positive","Frequency");
+    } else {
+        spec.cadence = params.get("Cadence","Second");
+        spec.prebuffer = params.has("Prebuffer") ? params.get("Prebuffer","Second") : -params.get("TimeOffset","Second");
+        spec.norm = params.get("Normalization","1",1.0);
+        spec.interplen = params.getinterplen(1,0);
+
+        if(params.has("Cadence") && spec.cadence <= 0.0) params.complain("need positive","Cadence");
+
+        // the Array: Dims Length and Records, and a remote binary Stream of "hp,hc" (in some order)
+
+        spec.length = spec.records = 0;
+        spec.hp = spec.hc = -1;
+
+        XMLElement *stream = 0;
+
+        if(array) {
+            for(int i=0;i<array->children;i++) {
+                XMLElement *c = array->child[i];
+                const char *cname = c->getattribute("Name");
+                double x;
+
+                if(c->is("Dim") && cname && readnumbers(c->text,&x,1)) {
+                    if(!strcmp(cname,"Length"))  spec.length = long(x);
+                    if(!strcmp(cname,"Records")) spec.records = long(x);
+                } else if(c->is("Stream")) {
+                    stream = c;
+                }
+            }
+
+            // find hp and hc among the comma-separated names
+
+            const char *vars = array->getattribute("Name");
+
+            for(int v=0;vars && *vars;v++) {
+                while(*vars == ' ' || *vars == ',') vars++;
+
+                long n = strcspn(vars,", ");
+                if(n == 2 && !strncmp(vars,"hp",2)) spec.hp = v;
+                if(n == 2 && !strncmp(vars,"hc",2)) spec.hc = v;
+
+                vars += n;
+                while(*vars == ' ') vars++;
+                if(*vars == ',') vars++;
+            }
+        }
+
+        const char *type = stream ? stream->getattribute("Type") : 0;
+        const char *encoding = stream ? stream->getattribute("Encoding") : 0;
+
+        if(!stream || !type || strcmp(type,"Remote") || !encoding || !strstr(encoding,"Binary")) {
+            params.complain("need a remote binary Stream in","TimeSeries");
+        } else if(spec.length <= 0 || spec.hp < 0 || spec.hc < 0 || spec.hp >= spec.records || spec.hc >= spec.records) {
+            params.complain("need Length, Records, and hp,hc columns in","TimeSeries");
+        } else {
+            const char *file = stream->text;
+            while(*file && strchr(" \t\n\r",*file)) file++;
+
+            long n = strlen(file);
+            while(n > 0 && strchr(" \t\n\r",file[n-1])) n--;
+
+            // relative to the directory of the XML file
+
+            spec.filename = new char[strlen(directory) + n + 2];
+            if(*directory && *file != '/') sprintf(spec.filename,"%s/",directory);
+            else spec.filename[0] = 0;
+            strncat(spec.filename,file,n);
+
+            int little = 1;
+            int nativelittle = *(char *)&little;
+
+            spec.swap = (strstr(encoding,"BigEndian") && nativelittle) || (strstr(encoding,"LittleEndian") && !nativelittle);
+        }
+    }
+}
+
+// read the hp and hc columns of a SampledPlaneWave into new arrays
+
+static void readsampled(XMLSourceSpec &spec,double *&hp,double *&hc) {
+    FILE *file = fopen(spec.filename,"rb");
+
+    long count = spec.length * spec.records;
+    double *data = new double[count];
+
+    if(!file || fread(data,sizeof(double),count,file) != size_t(count)) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): cannot read " << count << " doubles from "
+                  << spec.filename << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        if(file) fclose(file);
+        delete [] data;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    fclose(file);
+
+    if(spec.swap) {
+        for(long i=0;i<count;i++) {
+            char *b = (char *)&data[i];
+
+            for(int j=0;j<4;j++) {
+                char c = b[j]; b[j] = b[7-j]; b[7-j] = c;
+            }
+        }
+    }
+
+    hp = new double[spec.length];
+    hc = new double[spec.length];
+
+    for(long i=0;i<spec.length;i++) {
+        hp[i] = data[i*spec.records + spec.hp];
+        hc[i] = data[i*spec.records + spec.hc];
+    }
+
+    delete [] data;
+}
+
+
+// --- XMLSimulation ---
+
+XMLSimulation::XMLSimulation(char *filename)
+    : lisa(0), noises(0), noise(0), nosignal(0), sources(0), wave(0), sampled(0), wavearray(0),
+      tdinoise(0), tdisignal(0), parsetime(0.0), buildtime(0.0) {
+
+    double start = walltime();
+
+    FILE *file = fopen(filename,"rb");
+
+    if(!file) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): cannot open " << filename
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    fseek(file,0,SEEK_END);
+    long size = ftell(file);
+    fseek(file,0,SEEK_SET);
+
+    char *buffer = new char[size + 1];
+    buffer[fread(buffer,1,size,file)] = 0;
+    fclose(file);
+
+    XMLElement *root = 0;
+
+    try {
+        XMLParser parser(buffer);
+        root = parser.parse();
+    } catch (...) {
+        delete [] buffer;
+        throw;
+    }
+
+    delete [] buffer;
+
+    if(!root->is("XSIL")) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): " << filename << " is not a LISA XSIL file"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        delete root;
+
+        ExceptionFileError e;
+        throw e;
+    }
+
+    // data files are relative to the directory of the XML file
+
+    const char *slash = strrchr(filename,'/');
+    char *directory = copystring(filename,slash ? slash - filename : 0);
+
+    try {
+        parsetime = walltime() - start;
+        build(root,directory);
+    } catch (...) {
+        delete [] directory;
+        delete root;
+
+        release();
+        throw;
+    }
+
+    delete [] directory;
+    delete root;
+}
+
+void XMLSimulation::build(XMLElement *root,const char *directory) {
+    double start = walltime();
+    int errors = 0;
+
+    // collect and check everything first
+
+    int lisatype = -1;
+    double lisapar[4] = {0.0, 0.0, 0.0, 0.0};
+
+    XMLNoiseSpec *noisespec = 0;
+    XMLSourceSpec *sourcespec = 0;
+
+    for(int i=0;i<root->children;i++) {
+        XMLElement *section = root->child[i];
+
+        for(int j=0;j<section->children;j++) {
+            XMLElement *el = section->child[j];
+
+            if(section->is("XSIL","LISAData") && (el->is("XSIL","PseudoLISA") || el->is("XSIL","OriginalLISA"))) {
+                readlisa(el,lisatype,lisapar,errors);
+            } else if(section->is("XSIL","NoiseData") && el->is("XSIL","PseudoRandomNoise")) {
+                XMLNoiseSpec spec;
+                readnoise(el,spec,errors);
+                append(noisespec,noises,spec);
+            } else if(section->is("XSIL","SourceData") && (el->is("XSIL","PlaneWave") || el->is("XSIL","SampledPlaneWave"))) {
+                XMLSourceSpec spec;
+                readsource(el,spec,directory,errors);
+                append(sourcespec,sources,spec);
+            }
+        }
+    }
+
+    if(lisatype < 0) {
+        std::cerr << "XMLSimulation::XMLSimulation(...): no PseudoLISA or OriginalLISA in LISAData"
+                  << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+        errors++;
+    }
+
+    try {
+        if(errors) {
+            std::cerr << "XMLSimulation::XMLSimulation(...): " << errors << " problem(s) in the simulation description"
+                      << " [" << __FILE__ << ":" << __LINE__ << "]." << std::endl;
+
+            ExceptionWrongArguments e;
+            throw e;
+        }
+
+        // sampled waveforms are read before building, since they may fail too
+
+        sampled = new double*[2*sources];
+        for(int s=0;s<2*sources;s++) sampled[s] = 0;
+
+        for(int s=0;s<sources;s++)
+            if(sourcespec[s].sampled) readsampled(sourcespec[s],sampled[2*s],sampled[2*s+1]);
+
+        parsetime += walltime() - start;
+
+        // now build
+
+        start = walltime();
+
+        if(lisatype == 1)
+            lisa = new EccentricInclined(lisapar[0],lisapar[1],lisapar[2],lisapar[3]);
+        else
+            lisa = new OriginalLISA(lisapar[0],lisapar[1],lisapar[2]);
+
+        // noises with the same name are summed (the SumSignals are kept after the noises)
+
+        nosignal = new NoSignal();
+
+        Noise *slot[18];
+        for(int k=0;k<18;k++) slot[k] = nosignal;
+
+        noise = new Signal*[2*noises];
+        int built = 0;
+
+        for(int n=0;n<noises;n++) {
+            XMLNoiseSpec &spec = noisespec[n];
+
+            Signal *thisnoise = new PowerLawNoise(spec.cadence,spec.prebuffer,spec.psd,spec.exponent,spec.interplen,spec.seed);
+            noise[built++] = thisnoise;
+
+            if(slot[spec.slot] != nosignal) {
+                thisnoise = new SumSignal(slot[spec.slot],thisnoise);
+                noise[built++] = thisnoise;
+            }
+
+            slot[spec.slot] = thisnoise;
+        }
+
+        for(int n=built;n<2*noises;n++) noise[n] = 0;
+
+        tdinoise = new TDInoise(lisa,&slot[0],&slot[6],&slot[12]);
+
+        if(sources > 0) {
+            wave = new Wave*[sources];
+            for(int s=0;s<sources;s++) wave[s] = 0;
+
+            for(int s=0;s<sources;s++) {
+                XMLSourceSpec &spec = sourcespec[s];
+
+                if(spec.sampled)
+                    wave[s] = new NoiseWave(sampled[2*s],sampled[2*s+1],spec.length,spec.cadence,spec.prebuffer,
+                                            spec.norm,0,spec.interplen,spec.beta,spec.lambda,spec.pol);
+                else
+                    wave[s] = new SimpleBinary(spec.frequency,spec.phase,spec.inclination,spec.amplitude,
+                                               spec.beta,spec.lambda,spec.pol);
+            }
+
+            wavearray = new WaveArray(wave,sources);
+            tdisignal = new TDIsignal(lisa,wavearray);
+        }
+
+        buildtime = walltime() - start;
+    } catch (...) {
+        for(int s=0;s<sources;s++) delete [] sourcespec[s].filename;
+        delete [] sourcespec;
+        delete [] noisespec;
+
+        throw;
+    }
+
+    for(int s=0;s<sources;s++) delete [] sourcespec[s].filename;
+    delete [] sourcespec;
+    delete [] noisespec;
+}
+
+XMLSimulation::~XMLSimulation() {
+    release();
+}
+
+void XMLSimulation::release() {
+    delete tdisignal;
+    delete wavearray;
+
+    if(wave)
+        for(int s=0;s<sources;s++) delete wave[s];
+    delete [] wave;
+
+    if(sampled)
+        for(int s=0;s<2*sources;s++) delete [] sampled[s];
+    delete [] sampled;
+
+    delete tdinoise;
+
+    // SumSignals come after their terms, so delete backwards
+
+    if(noise)
+        for(int n=2*noises-1;n>=0;n--) delete noise[n];
+    delete [] noise;
+
+    delete nosignal;
+    delete lisa;
+
+    tdisignal = 0; wavearray = 0; wave = 0; sampled = 0;
+    tdinoise = 0; noise = 0; nosignal = 0; lisa = 0;
+}
@@ -0,0 +1,71 @@
+/* $Id$
+ * $Date$
+ * $Author$
+ * $Revision$
+ */
+
+#ifndef _LISASIM_XMLSIM_H_
+#define _LISASIM_XMLSIM_H_
+
+#include "lisasim-lisa.h"
+#include "lisasim-signal.h"
+#include "lisasim-wave.h"
+#include "lisasim-tdinoise.h"
+#include "lisasim-tdisignal.h"
+
+class XMLElement;
+
+/** Native loader for lisaXML simulation descriptions: reads the
+    subset understood by readXML.getLISAGeometry, getLISANoise,
+    getTDInoise, and getLISASources (PseudoLISA or OriginalLISA in
+    LISAData; PseudoRandomNoise in NoiseData, named pm1, pm1s, ...,
+    pd1, pdm1, ..., C1, C1s, ..., with noises of the same name summed;
+    GalacticBinary/SimpleBinary PlaneWaves and SampledPlaneWaves with
+    remote binary data in SourceData), and builds the LISA, noise,
+    wave, and TDI objects directly. Parameters follow the conventions
+    (and unit and parameter conversions) of lisaxml.py. The whole
+    description is checked before anything is built: all problems are
+    reported, and then ExceptionWrongArguments is thrown (ExceptionFileError
+    for unreadable or malformed files). The loader owns everything it
+    builds. */
+
+class XMLSimulation {
+ private:
+    LISA *lisa;
+
+    int noises;
+    Signal **noise;
+    NoSignal *nosignal;
+
+    int sources;
+    Wave **wave;
+    double **sampled;
+    WaveArray *wavearray;
+
+    TDInoise *tdinoise;
+    TDIsignal *tdisignal;
+
+    double parsetime, buildtime;
+
+    void build(XMLElement *root,const char *directory);
+    void release();
+
+ public:
+    XMLSimulation(char *filename);
+    ~XMLSimulation();
+
+    /// The LISA geometry, TDInoise (undefined noises are NoSignal), and TDIsignal for the sources (0 if none).
+    LISA *getlisa() { return lisa; };
+    TDInoise *gettdinoise() { return tdinoise; };
+    TDIsignal *gettdisignal() { return tdisignal; };
+
+    /// Number of PseudoRandomNoise elements and sources read.
+    int getnoises() { return noises; };
+    int getsources() { return sources; };
+
+    /// Wall-clock seconds spent reading and checking the file, and building the objects.
+    double getparsetime() { return parsetime; };
+    double getbuildtime() { return buildtime; };
+};
+
+#endif /* _LISASIM_XMLSIM_H_ */
@@ -11,10 +11,23 @@
 #include "lisasim-tdi.h"
 #include "lisasim-tdinoise.h"
 #include "lisasim-tdisignal.h"
+#include "lisasim-background.h"
+#include "lisasim-fstat.h"
+#include "lisasim-parallel.h"
+#include "lisasim-inject.h"
+#include "lisasim-stream.h"
+#include "lisasim-narrowband.h"
+#include "lisasim-spectrum.h"
+#include "lisasim-xmlsim.h"
+#include "lisasim-ranging.h"
+#include "lisasim-phasemeter.h"
 #include "lisasim-lisa.h"
+#include "lisasim-orbit.h"
 #include "lisasim-tens.h"
 #include "lisasim-retard.h"
+#include "lisasim-delay.h"
 #include "lisasim-signal.h"
+#include "lisasim-whiten.h"
 #include "lisasim-except.h"
 
 #endif /* _LISASIM_H_ */
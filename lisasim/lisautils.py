@@ -219,10 +219,15 @@ def checkobs(observables):
             
     return retobs
 
-def getobsc(snum,stime,observables,zerotime=0.0,forcepython=0):
-    return getobs(snum,stime,observables,zerotime,display=1,forcepython=forcepython)
+def getobsc(snum,stime,observables,zerotime=0.0,forcepython=0,firstsample=0):
+    return getobs(snum,stime,observables,zerotime,display=1,forcepython=forcepython,firstsample=firstsample)
 
-def getobs(snum,stime,observables,zerotime=0.0,display=0,forcepython=0):
+# with firstsample = N, getobs returns samples N..N+snum-1 of the run
+# that starts at zerotime; if the observables are still in the state
+# left by a run of N samples (or were restored with loadstate), this
+# extends that run exactly, without recomputing it
+
+def getobs(snum,stime,observables,zerotime=0.0,display=0,forcepython=0,firstsample=0):
     if len(numpy.shape(observables)) == 0:
         obsobj = checkobs([observables])
                 
@@ -230,17 +235,17 @@ def getobs(snum,stime,observables,zerotime=0.0,display=0,forcepython=0):
             array = numpy.zeros(snum,dtype='d')
 
             if display:
-                lisaswig.fastgetobsc(array,snum,stime,obsobj,zerotime)
+                lisaswig.fastgetobsc(array,snum,stime,obsobj,zerotime,firstsample)
             else:
-                lisaswig.fastgetobs(array,snum,stime,obsobj,zerotime)
+                lisaswig.fastgetobs(array,snum,stime,obsobj,zerotime,firstsample)
         else:
             if display:
-                return getobscount(snum,stime,observables,zerotime)
+                return getobscount(snum,stime,observables,zerotime,firstsample)
             else:
                 array = numpy.zeros(snum,dtype='d')
             
                 for i in numpy.arange(0,snum):
-                    array[i] = observables(zerotime+i*stime)
+                    array[i] = observables(zerotime+(firstsample+i)*stime)
     else:
         obsobj = checkobs(observables)
 
@@ -249,21 +254,46 @@ def getobs(snum,stime,observables,zerotime=0.0,display=0,forcepython=0):
             array = numpy.zeros((snum,obslen),dtype='d')
 
             if display:
-                lisaswig.fastgetobsc(array,snum,stime,obsobj,zerotime)
+                lisaswig.fastgetobsc(array,snum,stime,obsobj,zerotime,firstsample)
             else:
-                lisaswig.fastgetobs(array,snum,stime,obsobj,zerotime)
+                lisaswig.fastgetobs(array,snum,stime,obsobj,zerotime,firstsample)
         else:
             if display:
-                return getobscount(snum,stime,observables,zerotime)
+                return getobscount(snum,stime,observables,zerotime,firstsample)
             else:
                 obslen = numpy.shape(observables)[0]
                 array = numpy.zeros((snum,obslen),dtype='d')
             
                 for i in numpy.arange(0,snum):
                     for j in xrange(0,obslen):
-                        array[i,j] = observables[j](zerotime+i*stime)
+                        array[i,j] = observables[j](zerotime+(firstsample+i)*stime)
     return array
 
+# extend a run computed with getobs, keeping the same objects alive
+
+def extendobs(array,snum,stime,observables,zerotime=0.0,display=0):
+    more = getobs(snum,stime,observables,zerotime,display,firstsample=len(array))
+
+    return numpy.concatenate((array,more))
+
+# save and restore the state of the observables (and of the TDI objects
+# behind them) at the end of a run, to extend it in another session with
+# objects built with the same parameters: after
+#   loadstate(filename,observables)
+# getobs(snum,stime,observables,zerotime,firstsample=N) continues a run of N samples
+
+def savestate(filename,observables):
+    if len(numpy.shape(observables)) == 0:
+        observables = [observables]
+
+    lisaswig.savestate(filename,checkobs(observables))
+
+def loadstate(filename,observables):
+    if len(numpy.shape(observables)) == 0:
+        observables = [observables]
+
+    lisaswig.loadstate(filename,checkobs(observables))
+
 # used by getobsc (hoping time.time() will work on all platforms...)
 
 import sys
@@ -290,7 +320,7 @@ def dotime(i,snum,inittime,lasttime):
 
 # the next version, getobsc, will display a countdown to completion
 
-def getobscount(snum,stime,observables,zerotime=0.0):
+def getobscount(snum,stime,observables,zerotime=0.0,firstsample=0):
     fullinittime = time()
     inittime = int(fullinittime)
     lasttime = 0
@@ -302,7 +332,7 @@ def getobscount(snum,stime,observables,zerotime=0.0):
         if len(numpy.shape(observables)) == 0:
             array = numpy.zeros(snum,dtype='d')
             for i in numpy.arange(0,snum):
-                array[i] = observables(zerotime+i*stime)
+                array[i] = observables(zerotime+(firstsample+i)*stime)
                 if i % 1024 == 0:
                     lasttime = dotime(i,snum,inittime,lasttime)
         else:
@@ -310,11 +340,11 @@ def getobscount(snum,stime,observables,zerotime=0.0):
             array = numpy.zeros((snum,obslen),dtype='d')
             for i in numpy.arange(0,snum):
                 for j in xrange(0,obslen):
-                    array[i,j] = observables[j](zerotime+i*stime)
+                    array[i,j] = observables[j](zerotime+(firstsample+i)*stime)
                 if i % 1024 == 0:
                     lasttime = dotime(i,snum,inittime,lasttime)
     except IndexError:
-        print "lisautils::getobsc: I have trouble accessing time ", zerotime+i*stime,
+        print "lisautils::getobsc: I have trouble accessing time ", zerotime+(firstsample+i)*stime,
         print "; you may try to reset your objects and repeat..."
 
         raise
@@ -506,6 +536,8 @@ def noiseproduct(signal1,signal2,noise,stime,npatches):
 
 import os
 import os.path
+import tempfile
+import hashlib
 
 datadir = os.path.join(os.path.dirname(__file__),'data')
 
@@ -568,3 +600,40 @@ def stdSampledLISA(interp=1):
     
     return makeSampledLISA(os.path.join(datadir,'positions.txt'),interp)
 
+
+def makeEphemerisLISA(filename,cache=True):
+    """Returns an EphemerisLISA object (Hermite-interpolated positions,
+    velocities, and light-times) for the ASCII orbit file filename
+    (formatted as for getLISApositions, optionally with velocities in
+    km/s in columns 11-19), looked up also in the synthLISA data
+    directory. With cache=True, the parsed ephemeris is kept in binary
+    form next to the file (or in the temporary directory, under a name
+    derived from the absolute path of the file, if that is not
+    writable) and reused while it is newer than the file and was made
+    from it; cache may also give the binary filename, or be None to
+    disable it."""
+
+    if not os.path.isfile(filename):
+        filename = os.path.join(datadir,filename)
+
+    if cache == True:
+        cache = os.path.splitext(filename)[0] + '.ephem'
+
+        if not os.access(os.path.dirname(os.path.abspath(cache)),os.W_OK):
+            # files with the same basename in different directories get different caches
+            tag = hashlib.md5(os.path.abspath(filename)).hexdigest()[:16]
+            base = os.path.splitext(os.path.basename(filename))[0]
+
+            cache = os.path.join(tempfile.gettempdir(),'%s-%s.ephem' % (base,tag))
+
+    if cache:
+        return lisaswig.EphemerisLISA(filename,cache)
+    else:
+        return lisaswig.EphemerisLISA(filename)
+
+
+def stdEphemerisLISA(cache=True):
+    """Calls makeEphemerisLISA with the standard file given by stdLISApositions()."""
+
+    return makeEphemerisLISA(os.path.join(datadir,'positions.txt'),cache)
+
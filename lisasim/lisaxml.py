@@ -451,6 +451,7 @@ class lisaXML(writeXML):
         self.comments = comments
         
         self.binaryfiles = 0
+        self.spectrumfiles = 0
         self.theLISAData = []
         self.theNoiseData = []
         self.theSourceData = []
@@ -777,21 +778,27 @@ class lisaXML(writeXML):
             # defaulting to remote storage
             # determine binary filename (base filename + ordinal + '.bin')
 
-            binaryfilename = (re.sub('\.xml$','',self.filename) +
-                              '-' + str(self.binaryfiles) + '.bin')
-            self.binaryfiles += 1
+            # data already on disk (see TDISpectraFromFile) is only referenced
+
+            if isinstance(data,fileData):
+                self.coupletag('Stream',{'Type': 'Remote','Encoding': encoding},
+                                        data.basename)
+            else:
+                binaryfilename = (re.sub('\.xml$','',self.filename) +
+                                  '-' + str(self.binaryfiles) + '.bin')
+                self.binaryfiles += 1
 
-            self.coupletag('Stream',{'Type': 'Remote','Encoding': encoding},
-                                    os.path.basename(binaryfilename))
+                self.coupletag('Stream',{'Type': 'Remote','Encoding': encoding},
+                                        os.path.basename(binaryfilename))
 
-            bfile = open(binaryfilename, 'w')
+                bfile = open(binaryfilename, 'w')
 
-            if len(data) != length:
-                bfile.write(data[0:length].tostring())
-            else:
-                bfile.write(data.tostring())
+                if len(data) != length:
+                    bfile.write(data[0:length].tostring())
+                else:
+                    bfile.write(data.tostring())
                 
-            bfile.close()
+                bfile.close()
         elif 'Text' in encoding:
             # defaulting to inline storage
         
@@ -923,6 +930,51 @@ class lisaXML(writeXML):
    
         self.theTDIData.append(FrequencySeries)
 
+    def TDISpectraFromFile(self,infile,stime,description,records=0,length=0,memory=2**28,comments=''):
+        """Add a FrequencySeries object to a lisaXML file object,
+        computed out of core (see outofcorefft) from the observables in
+        the binary file 'infile', sampled with cadence 'stime' (in
+        seconds): rows of 'records' doubles, back to back as written
+        for a binary TimeSeries or by writebinary (possibly appended
+        in chunks), or in StreamServer frames ('records' may then be 0).
+        The first 'length' rows (all if 0) are zero-padded to the next
+        power of two, N; the spectrum, for frequencies k/(N*stime) with
+        k = 0..N/2, is written directly to the binary file
+        file-spectrum-0.bin (file-spectrum-1.bin, etc.) if the main XML
+        file is file.xml, using about 'memory' bytes. Each row holds the
+        frequency and the real and imaginary parts of the transform of
+        each record, so 'description' should list 1 + 2*records names
+        (e.g., 'f,Xr,Xi,Yr,Yi,Zr,Zi'); 'comments' is added to the
+        FrequencySeries entry."""
+
+        binaryfilename = (re.sub('\.xml$','',self.filename) +
+                          '-spectrum-' + str(self.spectrumfiles) + '.bin')
+        self.spectrumfiles += 1
+
+        N = synthlisa.outofcorefft(infile,length,records,binaryfilename,stime,memory)
+
+        rows = N/2 + 1
+        width = os.path.getsize(binaryfilename) / (8 * rows)
+
+        FrequencySeries = typeFrequencySeries()
+
+        FrequencySeries.data = fileData(binaryfilename,os.path.basename(binaryfilename),
+                                        rows,width,'Binary',0)
+        FrequencySeries.dim = 2
+        FrequencySeries.alength = rows
+        FrequencySeries.records = width
+        FrequencySeries.length = rows
+
+        FrequencySeries.deltaf = 1.0 / (N * stime)
+        FrequencySeries.minf = 0.0
+        FrequencySeries.maxf = (rows - 1) * FrequencySeries.deltaf
+
+        FrequencySeries.description = description
+        FrequencySeries.encoding = 'Binary'
+        FrequencySeries.comments = comments
+
+        self.theTDIData.append(FrequencySeries)
+
     def writeFrequencySeries(self,FrequencySeries):
         # write out the FrequencySeries defined in FrequencySeries
         
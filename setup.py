@@ -28,6 +28,7 @@ synthlisa_prefix = ''
 numpy_prefix = ''
 swig_bin = 'swig'
 gsl_prefix = ''
+mpilib_prefix = ''
 make_clib = False
 
 # At the moment, this setup script does not deal with --home.
@@ -45,6 +46,8 @@ for arg in sys.argv:
         gsl_prefix = arg.split('=', 1)[1]
     elif arg.startswith('--with-swig='):
         swig_bin = arg.split('=', 1)[1]
+    elif arg.startswith('--with-mpi='):
+        mpilib_prefix = arg.split('=', 1)[1]
     elif arg.startswith('--make-clib'):
         make_clib = True
     else:
@@ -333,6 +336,16 @@ else:
 
 installincludes = [re.sub('lisasim/','',hfile) for hfile in header_files]
 
+# native MPI support for fastgetobsp (--with-mpi=<prefix>)
+
+if mpilib_prefix:
+    mpi_macros = [('SYNTHLISA_MPI',None)]
+    mpi_includes = [mpilib_prefix + '/include']
+    mpi_libdirs = [mpilib_prefix + '/lib']
+    mpi_libraries = ['mpi']
+else:
+    mpi_macros, mpi_includes, mpi_libdirs, mpi_libraries = [], [], [], []
+
 # do the actual setup
 
 setup(name = 'synthLISA',
@@ -363,7 +376,11 @@ setup(name = 'synthLISA',
 
       ext_modules = [Extension('synthlisa/_lisaswig',
                                source_files,
-                               include_dirs = [numpy_hfiles],
+                               include_dirs = [numpy_hfiles] + mpi_includes,
+                               define_macros = mpi_macros,
+                               library_dirs = mpi_libdirs,
+                               # pthread for the StreamServer worker thread
+                               libraries = mpi_libraries + ['pthread'],
                                depends = header_files
                                )] + contribs
       )